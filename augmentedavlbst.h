@@ -0,0 +1,389 @@
+#ifndef AUGMENTEDAVLBST_H
+#define AUGMENTEDAVLBST_H
+
+#include <iostream>
+#include <exception>
+#include <cstdlib>
+#include <limits>
+#include <algorithm>
+#include "avlbst.h"
+
+/**
+* Monoids for AugmentedAVLTree. A monoid provides a Summary type, an
+* identity() summary, lift() to summarize a single item, and an associative
+* combine() that summarizes two adjacent runs of items, left run first.
+*/
+template <typename T>
+struct SumMonoid
+{
+    typedef T Summary;
+    static Summary identity() { return T(); }
+    template<typename Item>
+    static Summary lift(const Item& item) { return item.second; }
+    static Summary combine(const Summary& a, const Summary& b) { return a + b; }
+};
+
+template <typename T>
+struct MinMonoid
+{
+    typedef T Summary;
+    static Summary identity() { return std::numeric_limits<T>::max(); }
+    template<typename Item>
+    static Summary lift(const Item& item) { return item.second; }
+    static Summary combine(const Summary& a, const Summary& b) { return std::min(a, b); }
+};
+
+template <typename T>
+struct MaxMonoid
+{
+    typedef T Summary;
+    static Summary identity() { return std::numeric_limits<T>::lowest(); }
+    template<typename Item>
+    static Summary lift(const Item& item) { return item.second; }
+    static Summary combine(const Summary& a, const Summary& b) { return std::max(a, b); }
+};
+
+struct CountMonoid
+{
+    typedef size_t Summary;
+    static Summary identity() { return 0; }
+    template<typename Item>
+    static Summary lift(const Item&) { return 1; }
+    static Summary combine(const Summary& a, const Summary& b) { return a + b; }
+};
+
+/**
+* An AVL node that also stores the Monoid summary of its whole subtree.
+*/
+template <typename Key, typename Value, typename Monoid>
+class AugmentedAVLNode : public AVLNode<Key, Value>
+{
+public:
+    typedef typename Monoid::Summary Summary;
+
+    AugmentedAVLNode(const Key& key, const Value& value, AVLNode<Key, Value>* parent);
+    virtual ~AugmentedAVLNode();
+
+    const Summary& getSummary() const;
+    void setSummary(const Summary& summary);
+    void updateSummary(); // Recomputes the summary from the children's and this item, unless it is a tombstone
+    static Summary summaryOf(const Node<Key, Value>* node); // identity() for NULL
+
+protected:
+    Summary summary_;
+};
+
+/*
+  -------------------------------------------------
+  Begin implementations for the AugmentedAVLNode class.
+  -------------------------------------------------
+*/
+
+template<class Key, class Value, class Monoid>
+AugmentedAVLNode<Key, Value, Monoid>::AugmentedAVLNode(const Key& key, const Value& value, AVLNode<Key, Value>* parent) :
+    AVLNode<Key, Value>(key, value, parent), summary_(Monoid::lift(this->item_))
+{
+
+}
+
+template<class Key, class Value, class Monoid>
+AugmentedAVLNode<Key, Value, Monoid>::~AugmentedAVLNode()
+{
+
+}
+
+template<class Key, class Value, class Monoid>
+const typename Monoid::Summary& AugmentedAVLNode<Key, Value, Monoid>::getSummary() const
+{
+    return summary_;
+}
+
+template<class Key, class Value, class Monoid>
+void AugmentedAVLNode<Key, Value, Monoid>::setSummary(const Summary& summary)
+{
+    summary_ = summary;
+}
+
+template<class Key, class Value, class Monoid>
+void AugmentedAVLNode<Key, Value, Monoid>::updateSummary()
+{
+    Summary own = this->tombstone_ ? Monoid::identity() : Monoid::lift(this->item_);
+    summary_ = Monoid::combine(Monoid::combine(summaryOf(this->left_), own), summaryOf(this->right_));
+}
+
+template<class Key, class Value, class Monoid>
+typename Monoid::Summary AugmentedAVLNode<Key, Value, Monoid>::summaryOf(const Node<Key, Value>* node)
+{
+    if (node == nullptr) {
+        return Monoid::identity();
+    }
+    return static_cast<const AugmentedAVLNode<Key, Value, Monoid>*>(node)->summary_;
+}
+
+/*
+  -----------------------------------------------
+  End implementations for the AugmentedAVLNode class.
+  -----------------------------------------------
+*/
+
+/**
+* An AVL tree that keeps a Monoid summary in every node, so the summary of
+* any key range can be assembled from O(log n) subtree summaries.
+*
+* Summaries are kept current through insert, remove, extract, rebalance,
+* copy, merge and build_parallel, and a tombstone left by lazy deletion
+* counts as identity(). Values changed in place through operator[], an iterator
+* or parallel_for_each are not seen; re-insert the key instead.
+*/
+template <class Key, class Value, class Monoid>
+class AugmentedAVLTree : public AVLTree<Key, Value>
+{
+public:
+    typedef typename Monoid::Summary Summary;
+
+    using AVLTree<Key, Value>::insert;
+    virtual void insert (const std::pair<const Key, Value> &new_item);
+    void merge(AugmentedAVLTree& other); // See BinarySearchTree::merge
+
+    Summary aggregate(const Key& lo, const Key& hi) const; // Summary of the keys in [lo, hi)
+    Summary summary() const; // Summary of the whole tree
+
+protected:
+    typedef AugmentedAVLNode<Key, Value, Monoid> ANode;
+
+    virtual AVLNode<Key, Value>* createNode (const Key& key, const Value& value, AVLNode<Key, Value>* parent) const;
+    virtual Node<Key, Value>* cloneNode (const Node<Key, Value>* src, Node<Key, Value>* parent) const;
+    virtual void afterRebuild();
+    virtual Node<Key, Value>* linkNode (Node<Key, Value>* n);
+    virtual void nodeSwap( AVLNode<Key,Value>* n1, AVLNode<Key,Value>* n2);
+    virtual void removeFix (Node<Key, Value>* n, int diff);
+    virtual void markTombstone (Node<Key, Value>* n, bool dead);
+    virtual void rotateRight (Node<Key, Value>* g);
+    virtual void rotateLeft (Node<Key, Value>* g);
+
+    static void refresh (Node<Key, Value>* n); // Recomputes n's summary, NULL is ignored
+    static void refreshUpward (Node<Key, Value>* n); // Recomputes n and all its ancestors
+    static void refreshAll (Node<Key, Value>* n); // Recomputes every summary below n
+    static Summary lift (const Node<Key, Value>* n); // identity() for a tombstone
+};
+
+/*
+------------------------------------------------
+Begin implementations for the AugmentedAVLTree class.
+------------------------------------------------
+*/
+
+/**
+* The inserted (or overwritten) node and everything above it may have a
+* stale summary; rotations along the way already fixed the nodes they moved
+* off that path.
+*/
+template<class Key, class Value, class Monoid>
+void AugmentedAVLTree<Key, Value, Monoid>::insert (const std::pair<const Key, Value> &new_item)
+{
+    AVLTree<Key, Value>::insert(new_item);
+    refreshUpward(this->internalFind(new_item.first));
+}
+
+/**
+* The node's summary still describes the subtree it was extracted with, so
+* it is reset to its own item before the rotations can read it.
+*/
+template<class Key, class Value, class Monoid>
+Node<Key, Value>* AugmentedAVLTree<Key, Value, Monoid>::linkNode (Node<Key, Value>* n)
+{
+    static_cast<ANode*>(n)->setSummary(lift(n));
+    Node<Key, Value>* existing = AVLTree<Key, Value>::linkNode(n);
+    if (existing == nullptr) {
+        refreshUpward(n);
+    }
+    return existing;
+}
+
+/**
+* Called by AVLTree::unlinkNode with the parent of the unlinked node. Every
+* rotation on the way up leaves the nodes it moved on n's ancestor path or
+* with up-to-date children, so one pass from n to the root finishes the job.
+*/
+template<class Key, class Value, class Monoid>
+void AugmentedAVLTree<Key, Value, Monoid>::removeFix (Node<Key, Value>* n, int diff)
+{
+    AVLTree<Key, Value>::removeFix(n, diff);
+    refreshUpward(n);
+}
+
+template<class Key, class Value, class Monoid>
+void AugmentedAVLTree<Key, Value, Monoid>::markTombstone (Node<Key, Value>* n, bool dead)
+{
+    AVLTree<Key, Value>::markTombstone(n, dead);
+    refreshUpward(n);
+}
+
+template<class Key, class Value, class Monoid>
+void AugmentedAVLTree<Key, Value, Monoid>::rotateRight (Node<Key, Value>* g)
+{
+    AVLTree<Key, Value>::rotateRight(g);
+    refresh(g);
+    refresh(g->parent_);
+}
+
+template<class Key, class Value, class Monoid>
+void AugmentedAVLTree<Key, Value, Monoid>::rotateLeft (Node<Key, Value>* g)
+{
+    AVLTree<Key, Value>::rotateLeft(g);
+    refresh(g);
+    refresh(g->parent_);
+}
+
+/**
+* Recomputes the lower of the two swapped nodes first.
+*/
+template<class Key, class Value, class Monoid>
+void AugmentedAVLTree<Key, Value, Monoid>::nodeSwap( AVLNode<Key,Value>* n1, AVLNode<Key,Value>* n2)
+{
+    AVLTree<Key, Value>::nodeSwap(n1, n2);
+    Node<Key, Value>* above = n2;
+    while (above != nullptr && above != n1) {
+        above = above->parent_;
+    }
+    if (above == n1) {
+        refresh(n2);
+        refresh(n1);
+    }
+    else {
+        refresh(n1);
+        refresh(n2);
+    }
+}
+
+template<class Key, class Value, class Monoid>
+void AugmentedAVLTree<Key, Value, Monoid>::afterRebuild()
+{
+    AVLTree<Key, Value>::afterRebuild();
+    refreshAll(this->root_);
+}
+
+/**
+* Both trees must use the same Monoid, since the merged nodes carry its
+* summaries; afterRebuild() recomputes them all.
+*/
+template<class Key, class Value, class Monoid>
+void AugmentedAVLTree<Key, Value, Monoid>::merge(AugmentedAVLTree<Key, Value, Monoid>& other)
+{
+    this->mergeFrom(other);
+}
+
+template<class Key, class Value, class Monoid>
+AVLNode<Key, Value>* AugmentedAVLTree<Key, Value, Monoid>::createNode(const Key& key, const Value& value, AVLNode<Key, Value>* parent) const
+{
+    return new ANode(key, value, parent);
+}
+
+/**
+* The copied subtree has the same items, so its summary carries over.
+*/
+template<class Key, class Value, class Monoid>
+Node<Key, Value>* AugmentedAVLTree<Key, Value, Monoid>::cloneNode(const Node<Key, Value>* src, Node<Key, Value>* parent) const
+{
+    Node<Key, Value>* node = AVLTree<Key, Value>::cloneNode(src, parent);
+    static_cast<ANode*>(node)->setSummary(ANode::summaryOf(src));
+    return node;
+}
+
+/**
+* Finds the highest node inside [lo, hi), then walks down its left subtree
+* along lo and its right subtree along hi. Every whole subtree that falls
+* inside the range on the way contributes its stored summary, and the
+* pieces are combined in key order.
+*/
+template<class Key, class Value, class Monoid>
+typename Monoid::Summary AugmentedAVLTree<Key, Value, Monoid>::aggregate(const Key& lo, const Key& hi) const
+{
+    Node<Key, Value>* split = this->root_;
+    while (split != nullptr) {
+        if (split->getKey() < lo) {
+            split = split->right_;
+        }
+        else if (!(split->getKey() < hi)) {
+            split = split->left_;
+        }
+        else {
+            break;
+        }
+    }
+    if (split == nullptr) {
+        return Monoid::identity();
+    }
+
+    Summary leftPart = Monoid::identity();
+    for (Node<Key, Value>* n = split->left_; n != nullptr; ) {
+        if (n->getKey() < lo) {
+            n = n->right_;
+        }
+        else {
+            leftPart = Monoid::combine(Monoid::combine(lift(n), ANode::summaryOf(n->right_)), leftPart);
+            n = n->left_;
+        }
+    }
+    Summary rightPart = Monoid::identity();
+    for (Node<Key, Value>* n = split->right_; n != nullptr; ) {
+        if (n->getKey() < hi) {
+            rightPart = Monoid::combine(rightPart, Monoid::combine(ANode::summaryOf(n->left_), lift(n)));
+            n = n->right_;
+        }
+        else {
+            n = n->left_;
+        }
+    }
+    return Monoid::combine(Monoid::combine(leftPart, lift(split)), rightPart);
+}
+
+template<class Key, class Value, class Monoid>
+typename Monoid::Summary AugmentedAVLTree<Key, Value, Monoid>::summary() const
+{
+    return ANode::summaryOf(this->root_);
+}
+
+template<class Key, class Value, class Monoid>
+void AugmentedAVLTree<Key, Value, Monoid>::refresh(Node<Key, Value>* n)
+{
+    if (n != nullptr) {
+        static_cast<ANode*>(n)->updateSummary();
+    }
+}
+
+template<class Key, class Value, class Monoid>
+void AugmentedAVLTree<Key, Value, Monoid>::refreshUpward(Node<Key, Value>* n)
+{
+    for (; n != nullptr; n = n->parent_) {
+        static_cast<ANode*>(n)->updateSummary();
+    }
+}
+
+template<class Key, class Value, class Monoid>
+void AugmentedAVLTree<Key, Value, Monoid>::refreshAll(Node<Key, Value>* n)
+{
+    if (n == nullptr) {
+        return;
+    }
+    refreshAll(n->left_);
+    refreshAll(n->right_);
+    static_cast<ANode*>(n)->updateSummary();
+}
+
+template<class Key, class Value, class Monoid>
+typename Monoid::Summary AugmentedAVLTree<Key, Value, Monoid>::lift(const Node<Key, Value>* n)
+{
+    if (n->isTombstone()) {
+        return Monoid::identity();
+    }
+    return Monoid::lift(n->item_);
+}
+
+/*
+----------------------------------------------
+End implementations for the AugmentedAVLTree class.
+----------------------------------------------
+*/
+
+#endif
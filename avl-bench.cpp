@@ -0,0 +1,54 @@
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include "avlbst.h"
+#include "bench-util.h"
+
+using namespace std;
+
+// Usage: avl-bench [num_keys]
+
+void report(const char* phase, double ms, AVLTree<int, int>& tree, int n)
+{
+    cout << phase << setw(9) << ms * 1e6 / n << "  " << setw(13)
+         << (double) tree.rotationCount() / n << endl;
+    tree.resetRotationCount();
+}
+
+int main(int argc, char *argv[])
+{
+    int n = (int) benchArg(argc, argv, 1, 1000000);
+
+    vector<int> keys = makeShuffledKeys(n, 1);
+    vector<int> order = makeShuffledKeys(n, 2);
+
+    cout << n << " keys" << endl;
+    cout << fixed << setprecision(3);
+    cout << "phase            ns/op  rotations/op" << endl;
+
+    AVLTree<int, int> tree;
+    BenchTimer timer;
+    for (int i = 0; i < n; ++i) {
+        tree.insert(std::make_pair(keys[i], i));
+    }
+    report("random insert ", timer.elapsedMs(), tree, n);
+
+    timer.reset();
+    for (int i = 0; i < n; ++i) {
+        tree.remove(order[i]);
+    }
+    report("random remove ", timer.elapsedMs(), tree, n);
+
+    timer.reset();
+    for (int i = 0; i < n; ++i) {
+        tree.insert(std::make_pair(i, i));
+    }
+    report("sorted insert ", timer.elapsedMs(), tree, n);
+
+    timer.reset();
+    for (int i = 0; i < n; ++i) {
+        tree.remove(i);
+    }
+    report("sorted remove ", timer.elapsedMs(), tree, n);
+    return 0;
+}
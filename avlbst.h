@@ -28,6 +28,10 @@ public:
     void setBalance (int8_t balance);
     void updateBalance(int8_t diff);
 
+    // Set while a lazily removed node waits for AVLTree::compact()
+    virtual bool isTombstone() const override;
+    void setTombstone(bool dead);
+
     // Getters for parent, left, and right. These need to be redefined since they
     // return pointers to AVLNodes - not plain Nodes. See the Node class in bst.h
     // for more information.
@@ -37,6 +41,7 @@ public:
 
 protected:
     int8_t balance_;    // effectively a signed char
+    bool tombstone_;    // fits in the padding after balance_
 };
 
 /*
@@ -51,7 +56,7 @@ protected:
 */
 template<class Key, class Value>
 AVLNode<Key, Value>::AVLNode(const Key& key, const Value& value, AVLNode<Key, Value> *parent) :
-    Node<Key, Value>(key, value, parent), balance_(0)
+    Node<Key, Value>(key, value, parent), balance_(0), tombstone_(false)
 {
 
 }
@@ -92,6 +97,18 @@ void AVLNode<Key, Value>::updateBalance(int8_t diff)
     balance_ += diff;
 }
 
+template<class Key, class Value>
+bool AVLNode<Key, Value>::isTombstone() const
+{
+    return tombstone_;
+}
+
+template<class Key, class Value>
+void AVLNode<Key, Value>::setTombstone(bool dead)
+{
+    tombstone_ = dead;
+}
+
 /**
 * An overridden function for getting the parent since a static_cast is necessary to make sure
 * that our node is a AVLNode.
@@ -132,23 +149,229 @@ template <class Key, class Value>
 class AVLTree : public BinarySearchTree<Key, Value>
 {
 public:
+    AVLTree();
     virtual void insert (const std::pair<const Key, Value> &new_item); // TODO
     virtual void remove(const Key& key);  // TODO
+    using BinarySearchTree<Key, Value>::insert;
+    void merge(AVLTree& other); // See BinarySearchTree::merge
+    size_t rotationCount() const; // Single rotations since construction or the last reset
+    void resetRotationCount();
+
+    // Lazy deletion: remove() only marks the node as a tombstone, which
+    // lookups, iterators and traversals skip. remove() never compacts, as
+    // that is O(n); once tombstones make up more than maxTombstoneRatio of
+    // the nodes, needsCompaction() says so and the caller runs compact()
+    // when a pause suits it. Turning the mode off compacts right away.
+    void setLazyDelete(bool enabled, double maxTombstoneRatio = 0.25);
+    void compact(); // Rebuilds the tree from its live nodes in one pass
+    bool needsCompaction() const; // More tombstones than maxTombstoneRatio allows
+    size_t tombstoneCount() const;
+
+    // Replaces the contents with the pairs in [first, last), which need not
+    // be sorted; for repeated keys the last one wins, as with insert.
+    // threads == 0 means std::thread::hardware_concurrency().
+    template<typename InputIt>
+    void build_parallel(InputIt first, InputIt last, unsigned threads = 0);
 protected:
     virtual void nodeSwap( AVLNode<Key,Value>* n1, AVLNode<Key,Value>* n2);
 
     // Add helper functions here
     virtual void insertFix (Node<Key,Value>* p, Node<Key,Value>* n);
     virtual void removeFix (Node<Key, Value>* n, int diff);
-    //virtual void rotateRight (Node<Key, Value>* g, Node<Key,Value>* p, Node<Key,Value>* n);
-    //virtual void rotateLeft (Node<Key, Value>* g, Node<Key,Value>* p, Node<Key,Value>* n);
     virtual void rotateRight (Node<Key, Value>* g);
     virtual void rotateLeft (Node<Key, Value>* g);
+    virtual void afterRebuild();
+    virtual Node<Key, Value>* linkNode (Node<Key, Value>* n);
+    virtual void unlinkNode (Node<Key, Value>* n);
+    virtual void markTombstone (Node<Key, Value>* n, bool dead); // Also keeps tombstones_ in step
+    void leafAdded (Node<Key, Value>* p); // p just got a new leaf child
+    int resetBalances (Node<Key, Value>* n); // Recomputes balances below n, returns its height
+    virtual AVLNode<Key, Value>* createNode (const Key& key, const Value& value, AVLNode<Key, Value>* parent) const;
+    virtual Node<Key, Value>* cloneNode (const Node<Key, Value>* src, Node<Key, Value>* parent) const;
+    AVLNode<Key, Value>* buildBalanced (const std::pair<Key, Value>* items, size_t count,
+                                        AVLNode<Key, Value>* parent, unsigned threads);
+    static int balancedHeight (size_t count); // Height of a buildBalanced tree of count nodes
+
+    size_t rotations_;
+    bool lazyDelete_;
+    double maxTombstoneRatio_;
 };
 
+template<class Key, class Value>
+AVLTree<Key, Value>::AVLTree() : rotations_(0), lazyDelete_(false), maxTombstoneRatio_(0.25)
+{
+}
+
+/**
+* Takes an AVLTree so that trees with other node types cannot be merged
+* in; the base merge relinks other's nodes as they are.
+*/
+template<class Key, class Value>
+void AVLTree<Key, Value>::merge(AVLTree<Key, Value>& other)
+{
+    this->mergeFrom(other);
+}
+
+template<class Key, class Value>
+size_t AVLTree<Key, Value>::rotationCount() const
+{
+    return rotations_;
+}
+
+template<class Key, class Value>
+void AVLTree<Key, Value>::resetRotationCount()
+{
+    rotations_ = 0;
+}
+
+template<class Key, class Value>
+void AVLTree<Key, Value>::setLazyDelete(bool enabled, double maxTombstoneRatio)
+{
+    lazyDelete_ = enabled;
+    maxTombstoneRatio_ = maxTombstoneRatio;
+    if (!enabled){
+        compact();
+    }
+}
+
+/**
+* Collects the nodes in key order, frees the tombstones and links the rest
+* into a balanced tree, all in O(n). Live nodes are not moved, so their
+* iterators and cache entries stay valid.
+*/
+template<class Key, class Value>
+void AVLTree<Key, Value>::compact()
+{
+    if (this->tombstones_ == 0){
+        return;
+    }
+    std::vector<Node<Key, Value>*> nodes;
+    nodes.reserve(this->size_);
+    this->collectNodes(this->root_, nodes);
+    this->dropTombstones(nodes);
+    this->rebuildFrom(nodes);
+}
+
+template<class Key, class Value>
+bool AVLTree<Key, Value>::needsCompaction() const
+{
+    return this->tombstones_ > maxTombstoneRatio_ * this->size_;
+}
+
+template<class Key, class Value>
+size_t AVLTree<Key, Value>::tombstoneCount() const
+{
+    return this->tombstones_;
+}
+
+template<class Key, class Value>
+void AVLTree<Key, Value>::markTombstone(Node<Key, Value>* n, bool dead)
+{
+    static_cast<AVLNode<Key,Value>*>(n)->setTombstone(dead);
+    if (dead){
+        ++this->tombstones_;
+    }
+    else{
+        --this->tombstones_;
+    }
+}
+
+/**
+* Sorts and dedupes the input in parallel, then builds a perfectly balanced
+* tree over it with the subtrees handed out to worker threads. Like every
+* other bulk rebuild it ends in afterRebuild(), so derived trees can redo
+* their per-node data.
+*/
+template<class Key, class Value>
+template<typename InputIt>
+void AVLTree<Key, Value>::build_parallel(InputIt first, InputIt last, unsigned threads)
+{
+    this->clear();
+    std::vector<std::pair<Key, Value> > items(first, last);
+    unsigned t = this->workerCount(threads, items.size());
+    this->sortAndDedupe(items, t);
+    if (items.empty()){
+        return;
+    }
+    t = this->workerCount(t, items.size());
+    this->root_ = buildBalanced(&items[0], items.size(), nullptr, t);
+    this->size_ = items.size();
+    afterRebuild();
+}
+
+/**
+* Builds a tree over count sorted items with the middle one on top. Both
+* halves differ in size by at most one, so every balance follows from the
+* sizes alone. With more than one thread the left half is built on a new
+* thread, and each half gets its share of the remaining threads.
+*/
+template<class Key, class Value>
+AVLNode<Key, Value>* AVLTree<Key, Value>::buildBalanced(const std::pair<Key, Value>* items, size_t count,
+                                                         AVLNode<Key, Value>* parent, unsigned threads)
+{
+    if (count == 0){
+        return nullptr;
+    }
+    size_t mid = count / 2;
+    AVLNode<Key, Value>* node = createNode(items[mid].first, items[mid].second, parent);
+    AVLNode<Key, Value>* left = nullptr;
+    AVLNode<Key, Value>* right = nullptr;
+    if (threads > 1){
+        unsigned leftThreads = threads / 2;
+        std::thread worker([&]() {
+            left = buildBalanced(items, mid, node, leftThreads);
+        });
+        right = buildBalanced(items + mid + 1, count - mid - 1, node, threads - leftThreads);
+        worker.join();
+    }
+    else{
+        left = buildBalanced(items, mid, node, 1);
+        right = buildBalanced(items + mid + 1, count - mid - 1, node, 1);
+    }
+    node->setLeft(left);
+    node->setRight(right);
+    node->setBalance(balancedHeight(count - mid - 1) - balancedHeight(mid));
+    return node;
+}
+
+/**
+* Allocates every node the tree creates, so derived trees can use a node
+* type that carries extra data.
+*/
+template<class Key, class Value>
+AVLNode<Key, Value>* AVLTree<Key, Value>::createNode(const Key& key, const Value& value, AVLNode<Key, Value>* parent) const
+{
+    return new AVLNode<Key, Value>(key, value, parent);
+}
+
+/**
+* A copied node keeps its balance, since the copy has the same shape, and
+* a tombstone stays one.
+*/
+template<class Key, class Value>
+Node<Key, Value>* AVLTree<Key, Value>::cloneNode(const Node<Key, Value>* src, Node<Key, Value>* parent) const
+{
+    AVLNode<Key, Value>* node = createNode(src->getKey(), src->getValue(), static_cast<AVLNode<Key, Value>*>(parent));
+    node->setBalance(static_cast<const AVLNode<Key, Value>*>(src)->getBalance());
+    node->setTombstone(src->isTombstone());
+    return node;
+}
+
+template<class Key, class Value>
+int AVLTree<Key, Value>::balancedHeight(size_t count)
+{
+    int height = 0;
+    while (count != 0){
+        ++height;
+        count >>= 1;
+    }
+    return height;
+}
+
 /*
  * Recall: If key is already in the tree, you should 
  * overwrite the current value with the updated value.
+ * A tombstone for the key comes back to life with it.
  */
 template<class Key, class Value>
 void AVLTree<Key, Value>::insert (const std::pair<const Key, Value> &new_item)
@@ -156,7 +379,8 @@ void AVLTree<Key, Value>::insert (const std::pair<const Key, Value> &new_item)
     //If empty set n as root
 
     if (this->root_ == nullptr){
-        this->root_ = new AVLNode<Key, Value>(new_item.first, new_item.second, nullptr);
+        this->root_ = createNode(new_item.first, new_item.second, nullptr);
+        ++this->size_;
     }
     // insert n by walking to a leaf and inserting the new node as its child
     else{
@@ -164,11 +388,14 @@ void AVLTree<Key, Value>::insert (const std::pair<const Key, Value> &new_item)
         while(true){
             if (temp->getKey() == new_item.first){
                 temp->setValue(new_item.second);
+                if (temp->isTombstone()){
+                    markTombstone(temp, false);
+                }
                 return;
             }
             else if (temp->getKey() < new_item.first){
                 if (temp->right_ == nullptr){
-                    AVLNode<Key, Value>* newNode = new AVLNode<Key, Value>(new_item.first, new_item.second, static_cast<AVLNode<Key,Value>*>(temp));
+                    AVLNode<Key, Value>* newNode = createNode(new_item.first, new_item.second, static_cast<AVLNode<Key,Value>*>(temp));
                     temp->setRight(newNode);
                     break;
                 }
@@ -176,138 +403,143 @@ void AVLTree<Key, Value>::insert (const std::pair<const Key, Value> &new_item)
             }
             else{
                 if (temp->left_ == nullptr){
-                    AVLNode<Key, Value>* newNode = new AVLNode<Key, Value>(new_item.first, new_item.second, static_cast<AVLNode<Key,Value>*>(temp));
+                    AVLNode<Key, Value>* newNode = createNode(new_item.first, new_item.second, static_cast<AVLNode<Key,Value>*>(temp));
                     temp->setLeft(newNode);
                     break;
                 }
                 temp = temp->left_;
             }
         }
-        //If -1 now = 0
-        if (static_cast<AVLNode<Key,Value>*>(temp)->getBalance() == -1){
-            static_cast<AVLNode<Key,Value>*>(temp)->setBalance(0);
+        ++this->size_;
+        leafAdded(temp);
+    }
+}
+
+/**
+* Hangs an extracted node back in as a leaf, with the same fix-up insert does.
+* A tombstone with the same key is unlinked and freed to make room.
+*/
+template<class Key, class Value>
+Node<Key, Value>* AVLTree<Key, Value>::linkNode (Node<Key, Value>* n)
+{
+    Node<Key, Value>* parent;
+    Node<Key, Value>* existing = this->findSlot(n->getKey(), parent);
+    if (existing != nullptr){
+        if (!existing->isTombstone()){
+            return existing;
         }
-        //If +1 now = 0. Done!
-        else if(static_cast<AVLNode<Key,Value>*>(temp)->getBalance() == 1){
-            static_cast<AVLNode<Key,Value>*>(temp)->setBalance(0);
+        unlinkNode(existing);
+        --this->tombstones_;
+        delete existing;
+        this->findSlot(n->getKey(), parent);
+    }
+    static_cast<AVLNode<Key,Value>*>(n)->setBalance(0);
+    static_cast<AVLNode<Key,Value>*>(n)->setTombstone(false);
+    ++this->size_;
+    n->setParent(parent);
+    if (parent == nullptr){
+        this->root_ = n;
+        return nullptr;
+    }
+    if (n->getKey() < parent->getKey()){
+        parent->setLeft(n);
+    }
+    else{
+        parent->setRight(n);
+    }
+    leafAdded(parent);
+    return nullptr;
+}
+
+/**
+* Updates p, which just got a new leaf child, and fixes the tree above it
+* if p's subtree grew.
+*/
+template<class Key, class Value>
+void AVLTree<Key, Value>::leafAdded (Node<Key, Value>* p)
+{
+    AVLNode<Key,Value>* ap = static_cast<AVLNode<Key,Value>*>(p);
+    //If -1 now = 0
+    if (ap->getBalance() == -1){
+        ap->setBalance(0);
+    }
+    //If +1 now = 0. Done!
+    else if(ap->getBalance() == 1){
+        ap->setBalance(0);
+    }
+    // If 0 update b(p)
+    else{
+        if (p->left_ != nullptr){
+            ap->setBalance(-1);
+            insertFix(p, p->left_);
         }
-        // If 0 update b(p)
-        else{
-            if (temp->left_ != nullptr){
-                static_cast<AVLNode<Key,Value>*>(temp)->setBalance(-1);
-                insertFix(temp, temp->left_);
-            }
-            else if (temp->right_ != nullptr){
-                static_cast<AVLNode<Key,Value>*>(temp)->setBalance(1);
-                insertFix(temp, temp->right_);
-            }
+        else if (p->right_ != nullptr){
+            ap->setBalance(1);
+            insertFix(p, p->right_);
         }
     }
 }
 
+/**
+* Walks up from p, whose subtree just grew on n's side, until a balance
+* absorbs the growth or a single (or double) rotation restores the old
+* height. At most one rotation site is ever needed on insert.
+*/
 template<class Key, class Value>
 void AVLTree<Key, Value>::insertFix (Node<Key,Value>* p, Node<Key,Value>* n){
-	//If p is nullptr or parent(p) is nullptr, return
-	if (p == nullptr || p->getParent() == nullptr){
-			return;
-	}
-	//Let g = parent(p)
-	Node<Key, Value>* g = p->getParent();
-
-	if (p == g->left_){
-
-			static_cast<AVLNode<Key,Value>*>(g)->updateBalance(-1);
-			//b(g) == 0, return
-			if (static_cast<AVLNode<Key,Value>*>(g)->getBalance() == 0){
-					return;
-			}
-			// b(g) == -1, insertFix(g, p) // recurse
-			else if (static_cast<AVLNode<Key,Value>*>(g)->getBalance() == -1){
-					insertFix(g, p);
-			}
-			// b(g) == -2
-			else if (static_cast<AVLNode<Key,Value>*>(g)->getBalance() == -2){
-
-					if (n == p->left_){
-	
-							rotateRight(g);
-							static_cast<AVLNode<Key,Value>*>(p)->setBalance(0);
-							static_cast<AVLNode<Key,Value>*>(g)->setBalance(0);
-					}
-
-					else{
-							rotateLeft(p);
-							rotateRight(g);
-							
-							if (static_cast<AVLNode<Key,Value>*>(n)->getBalance() == -1){
-									static_cast<AVLNode<Key,Value>*>(p)->setBalance(0);
-									static_cast<AVLNode<Key,Value>*>(g)->setBalance(1);
-									static_cast<AVLNode<Key,Value>*>(n)->setBalance(0);
-							}
-							else if (static_cast<AVLNode<Key,Value>*>(n)->getBalance() == 0){
-									static_cast<AVLNode<Key,Value>*>(p)->setBalance(0);
-									static_cast<AVLNode<Key,Value>*>(g)->setBalance(0);
-									static_cast<AVLNode<Key,Value>*>(n)->setBalance(0);
-							}
-							else{
-									static_cast<AVLNode<Key,Value>*>(p)->setBalance(-1);
-									static_cast<AVLNode<Key,Value>*>(g)->setBalance(0);
-									static_cast<AVLNode<Key,Value>*>(n)->setBalance(0);
-							}
-					}
-			}
-	}
-
-
-	else if (p == g->right_){
-
-			static_cast<AVLNode<Key,Value>*>(g)->updateBalance(1);
-
-		if (static_cast<AVLNode<Key,Value>*>(g)->getBalance() == 0){
-					return;
-			}
-
-		else if (static_cast<AVLNode<Key,Value>*>(g)->getBalance() == 1){
-					insertFix(g, p);
-			}
-
-		else if (static_cast<AVLNode<Key,Value>*>(g)->getBalance() == 2){
-
-					if (n == p->right_){
-							rotateLeft(g);
-							static_cast<AVLNode<Key,Value>*>(p)->setBalance(0);
-							static_cast<AVLNode<Key,Value>*>(g)->setBalance(0);
-					}
-					else{
-							rotateRight(p);
-							rotateLeft(g);
-							if (static_cast<AVLNode<Key,Value>*>(n)->getBalance() == 1){
-									static_cast<AVLNode<Key,Value>*>(p)->setBalance(0);
-									static_cast<AVLNode<Key,Value>*>(g)->setBalance(-1);
-									static_cast<AVLNode<Key,Value>*>(n)->setBalance(0);
-							}
-							else if (static_cast<AVLNode<Key,Value>*>(n)->getBalance() == 0){
-									static_cast<AVLNode<Key,Value>*>(p)->setBalance(0);
-									static_cast<AVLNode<Key,Value>*>(g)->setBalance(0);
-									static_cast<AVLNode<Key,Value>*>(n)->setBalance(0);
-							}
-							else{
-									static_cast<AVLNode<Key,Value>*>(p)->setBalance(1);
-									static_cast<AVLNode<Key,Value>*>(g)->setBalance(0);
-									static_cast<AVLNode<Key,Value>*>(n)->setBalance(0);
-							}
-					}
-			}
-	}
-}
-
-
-
+    while (p != nullptr){
+        Node<Key, Value>* g = p->parent_;
+        if (g == nullptr){
+            return;
+        }
+        AVLNode<Key,Value>* ag = static_cast<AVLNode<Key,Value>*>(g);
+        int8_t diff = (p == g->left_) ? -1 : 1;
+        ag->updateBalance(diff);
+        if (ag->getBalance() == 0){
+            return;
+        }
+        if (ag->getBalance() == diff){
+            n = p;
+            p = g;
+            continue;
+        }
 
+        // b(g) == 2 * diff
+        AVLNode<Key,Value>* ap = static_cast<AVLNode<Key,Value>*>(p);
+        AVLNode<Key,Value>* an = static_cast<AVLNode<Key,Value>*>(n);
+        bool outer = (diff == -1) ? (n == p->left_) : (n == p->right_);
+        if (outer){
+            if (diff == -1){
+                rotateRight(g);
+            }
+            else{
+                rotateLeft(g);
+            }
+            ap->setBalance(0);
+            ag->setBalance(0);
+        }
+        else{
+            if (diff == -1){
+                rotateLeft(p);
+                rotateRight(g);
+            }
+            else{
+                rotateRight(p);
+                rotateLeft(g);
+            }
+            int8_t bn = an->getBalance();
+            ap->setBalance(bn == -diff ? diff : 0);
+            ag->setBalance(bn == diff ? -diff : 0);
+            an->setBalance(0);
+        }
+        return;
+    }
+}
 
 /*
  * Recall: The writeup specifies that if a node has 2 children you
  * should swap with the predecessor and then remove.
+ * In lazy mode the node is only marked, and compact() frees it later.
  */
 template<class Key, class Value>
 void AVLTree<Key, Value>:: remove(const Key& key)
@@ -330,14 +562,29 @@ void AVLTree<Key, Value>:: remove(const Key& key)
             temp = temp->left_;
         }
     }
-    if (temp == nullptr){
+    if (temp == nullptr || temp->isTombstone()){
         //node not in tree, ignore
         return;
     }
-    if (temp->left_ != nullptr && temp->right_ != nullptr){
-        AVLTree<Key, Value>::nodeSwap(static_cast<AVLNode<Key,Value>*>(temp), static_cast<AVLNode<Key,Value>*>(this->predecessor(temp)));
+    this->evictCached(key);
+    if (lazyDelete_){
+        markTombstone(temp, true);
+        return;
+    }
+    unlinkNode(temp);
+    delete temp;// delete only after updating pointers
+}
+
+/**
+* Swaps n with its predecessor if it has two children, splices it out and
+* fixes the balances on the way up.
+*/
+template<class Key, class Value>
+void AVLTree<Key, Value>::unlinkNode(Node<Key, Value>* n)
+{
+    if (n->left_ != nullptr && n->right_ != nullptr){
+        this->nodeSwap(static_cast<AVLNode<Key,Value>*>(n), static_cast<AVLNode<Key,Value>*>(this->predecessor(n)));
     }
-    Node<Key, Value>*& n = temp;
     Node<Key, Value>* p = n->getParent();
     int diff = 0;
     if (p != nullptr){
@@ -345,29 +592,30 @@ void AVLTree<Key, Value>:: remove(const Key& key)
         if (n == p->left_){
             diff = 1;
            if (n->left_ != nullptr){
-               p->left_ = n->left_;
+               p->setLeft(n->left_);
                n->left_->parent_ = p;
            }
            else if (n->right_ != nullptr){
-               p->left_ = n->right_;
+               p->setLeft(n->right_);
                n->right_->parent_ = p;
            }
            else{
-               p->left_ = nullptr;
+               p->setLeft(nullptr);
            }
         }
         else if (n == p->right_){
             diff = -1;
             
             if (n->left_ != nullptr){
-               p->right_ = n->left_;
+               p->setRight(n->left_);
+               n->left_->parent_ = p;
            }
            else if (n->right_ != nullptr){
-               p->right_ = n->right_;
+               p->setRight(n->right_);
                n->right_->parent_ = p;
            }
            else{
-               p->right_ = nullptr;
+               p->setRight(nullptr);
            }
         }
     }
@@ -375,209 +623,167 @@ void AVLTree<Key, Value>:: remove(const Key& key)
     
     else{
         if (n->left_ != nullptr){
-            this->root_ = n->left_;
+            this->setRoot(n->left_);
             n->left_->parent_ = nullptr;
             static_cast<AVLNode<Key,Value>*>(n->left_)->setBalance(0);
         }
         else if (n->right_ != nullptr){
-            this->root_ = n->right_;
+            this->setRoot(n->right_);
             n->right_->parent_ = nullptr;
             static_cast<AVLNode<Key,Value>*>(n->right_)->setBalance(0);
         }
         else{
-            this->root_ = nullptr;
+            this->setRoot(nullptr);
         }
     }
-        delete n;// delete only after updating pointers
 
+        --this->size_;
         // fix tree
         removeFix(p, diff);
 }
 
 
+/**
+* Rotates g's left child up into g's place, rewiring the three parent/child
+* links involved directly.
+*/
 template<class Key, class Value>
 void AVLTree<Key, Value>::rotateRight (Node<Key,Value>* g){
-    if (g == this->root_){
-        this->root_ = g->left_;
-        g->left_->setParent(nullptr);
-        Node<Key, Value>* temp = g->left_->right_;
-        g->left_->setRight(g);
-        g->setParent(g->left_);
-        g->setLeft(temp);
-        if (temp!= nullptr){
-            temp->setParent(g);
-        }
-
+    Node<Key, Value>* c = g->left_;
+    Node<Key, Value>* p = g->parent_;
+    g->setLeft(c->right_);
+    if (c->right_ != nullptr){
+        c->right_->parent_ = g;
+    }
+    c->setRight(g);
+    g->parent_ = c;
+    c->parent_ = p;
+    if (p == nullptr){
+        this->setRoot(c);
+    }
+    else if (p->left_ == g){
+        p->setLeft(c);
     }
     else{
-        BinarySearchTree<Key, Value>::nodeSwap(g, g->left_);
-        Node<Key, Value>* temp = g->left_;
-        g->left_ = g->right_;
-        g->right_ = g->parent_->right_;
-        if (g->right_ != nullptr){
-            g->right_->parent_ = g;
-        }
-        g->parent_->right_ = g;
-        g->parent_->left_ = temp;
-        if (temp != nullptr){
-            temp->parent_ = g->parent_;
-        }
+        p->setRight(c);
     }
+    ++rotations_;
 }
 
+/**
+* Mirror image of rotateRight.
+*/
 template<class Key, class Value>
 void AVLTree<Key, Value>::rotateLeft (Node<Key,Value>* g){
-    if (g == this->root_){
-        this->root_ = g->right_;
-        g->right_->setParent(nullptr);
-        Node<Key, Value>* temp = g->right_->left_;
-        g->right_->setLeft(g);
-        g->setParent(g->right_);
-        g->setRight(temp);
-        if (temp!= nullptr){
-            temp->setParent(g);
-        }
-
+    Node<Key, Value>* c = g->right_;
+    Node<Key, Value>* p = g->parent_;
+    g->setRight(c->left_);
+    if (c->left_ != nullptr){
+        c->left_->parent_ = g;
+    }
+    c->setLeft(g);
+    g->parent_ = c;
+    c->parent_ = p;
+    if (p == nullptr){
+        this->setRoot(c);
+    }
+    else if (p->left_ == g){
+        p->setLeft(c);
     }
     else{
-        BinarySearchTree<Key, Value>::nodeSwap(g, g->right_);
-        Node<Key, Value>* temp = g->right_;
-        g->right_ = g->left_;
-        g->left_ = g->parent_->left_;
-        if (g->left_ != nullptr){
-            g->left_->parent_ = g;
-        }
-        g->parent_->left_ = g;
-        g->parent_->right_ = temp;
-        if (temp != nullptr){
-            temp->parent_ = g->parent_;
-        }
+        p->setRight(c);
     }
+    ++rotations_;
 }
 
+/**
+* Walks up from n, whose subtree on the side given by diff (+1 when the left
+* side shrank, -1 for the right) just lost a level. Stops as soon as a node
+* keeps its height: either its balance only moves to +-1 or a rotation
+* around a balanced child leaves the height unchanged.
+*/
 template<class Key, class Value>
 void AVLTree<Key, Value>::removeFix(Node<Key, Value>* n, int diff){
-    
-    // return if n == nullptr
-    if (n == nullptr){
-        return;
-    }
-    int ndiff = 0;
-    Node<Key, Value>* p = n->getParent();
-
-    if (p != nullptr){
-        if (p->left_ == n){
-            ndiff = 1;
+    while (n != nullptr){
+        Node<Key, Value>* p = n->parent_;
+        int ndiff = 0;
+        if (p != nullptr){
+            ndiff = (p->left_ == n) ? 1 : -1;
         }
-        else{
-            ndiff = -1;
+        AVLNode<Key,Value>* an = static_cast<AVLNode<Key,Value>*>(n);
+        int b = an->getBalance() + diff;
+        if (b == -1 || b == 1){
+            an->setBalance(b);
+            return;
+        }
+        if (b == 0){
+            an->setBalance(0);
+            n = p;
+            diff = ndiff;
+            continue;
         }
-    }
-	// make the appropriate rotations for each of the cases eg. zigzig 
-        if (((int) static_cast<AVLNode<Key,Value>*>(n)->getBalance()) + diff == -2){
-
-            Node<Key, Value>* c = n->left_;
-
-            if (static_cast<AVLNode<Key,Value>*>(c)->getBalance() == -1){
 
+        // b == 2 * sign: the heavy child c is on the side of sign
+        int sign = (b < 0) ? -1 : 1;
+        AVLNode<Key,Value>* c = static_cast<AVLNode<Key,Value>*>(sign < 0 ? n->left_ : n->right_);
+        int bc = c->getBalance();
+        if (bc == -sign){
+            // Zig-zag: c's inner child g ends up on top
+            AVLNode<Key,Value>* g = static_cast<AVLNode<Key,Value>*>(sign < 0 ? c->right_ : c->left_);
+            int bg = g->getBalance();
+            if (sign < 0){
+                rotateLeft(c);
                 rotateRight(n);
-                static_cast<AVLNode<Key,Value>*>(n)->setBalance(0);
-                static_cast<AVLNode<Key,Value>*>(c)->setBalance(0);
-                removeFix(p, ndiff);
             }
-            
-            else if (static_cast<AVLNode<Key,Value>*>(c)->getBalance() == 0){
-                rotateRight(n);
-                static_cast<AVLNode<Key,Value>*>(n)->setBalance(-1);
-                static_cast<AVLNode<Key,Value>*>(c)->setBalance(1);
-                return;
+            else{
+                rotateRight(c);
+                rotateLeft(n);
             }
-            else if (static_cast<AVLNode<Key,Value>*>(c)->getBalance() == 1){
-                Node<Key, Value>* g = c->right_;
-                rotateLeft(c);
+            an->setBalance(bg == sign ? -sign : 0);
+            c->setBalance(bg == -sign ? sign : 0);
+            g->setBalance(0);
+        }
+        else{
+            if (sign < 0){
                 rotateRight(n);
-                if (static_cast<AVLNode<Key,Value>*>(g)->getBalance() == 1){
-                    static_cast<AVLNode<Key,Value>*>(n)->setBalance(0);
-                    static_cast<AVLNode<Key,Value>*>(c)->setBalance(-1);
-                    static_cast<AVLNode<Key,Value>*>(g)->setBalance(0);
-                }
-                else if (static_cast<AVLNode<Key,Value>*>(g)->getBalance() == 0){
-                    static_cast<AVLNode<Key,Value>*>(n)->setBalance(0);
-                    static_cast<AVLNode<Key,Value>*>(c)->setBalance(0);
-                    static_cast<AVLNode<Key,Value>*>(g)->setBalance(0);
-                }
-                else if (static_cast<AVLNode<Key,Value>*>(g)->getBalance() == -1){
-                    static_cast<AVLNode<Key,Value>*>(n)->setBalance(1);
-                    static_cast<AVLNode<Key,Value>*>(c)->setBalance(0);
-                    static_cast<AVLNode<Key,Value>*>(g)->setBalance(0);
-                }
-                return;
             }
-        }
-        
-        else if (((int) static_cast<AVLNode<Key,Value>*>(n)->getBalance()) + diff == -1){
-            static_cast<AVLNode<Key,Value>*>(n)->setBalance(-1);
-            return;
-        }
-        else if (((int) static_cast<AVLNode<Key,Value>*>(n)->getBalance()) + diff == 0){
-            static_cast<AVLNode<Key,Value>*>(n)->setBalance(0);
-            removeFix(p, ndiff);
-        }
-    
-
-        else if (((int) static_cast<AVLNode<Key,Value>*>(n)->getBalance()) + diff == 2){
-            Node<Key, Value>* c = n->right_;
-
-
-            if (static_cast<AVLNode<Key,Value>*>(c)->getBalance() == 1){
-                // rotateRight(n)
+            else{
                 rotateLeft(n);
-                static_cast<AVLNode<Key,Value>*>(n)->setBalance(0);
-                static_cast<AVLNode<Key,Value>*>(c)->setBalance(0);
-                removeFix(p, ndiff);
             }
-            
-
-            else if (static_cast<AVLNode<Key,Value>*>(c)->getBalance() == 0){
-
-                rotateLeft(n);
-                static_cast<AVLNode<Key,Value>*>(n)->setBalance(1);
-                static_cast<AVLNode<Key,Value>*>(c)->setBalance(-1);
-                return;
+            if (bc == 0){
+                an->setBalance(sign);
+                c->setBalance(-sign);
+                return; // height unchanged
             }
+            an->setBalance(0);
+            c->setBalance(0);
+        }
+        n = p;
+        diff = ndiff;
+    }
+}
 
-            else if (static_cast<AVLNode<Key,Value>*>(c)->getBalance() == -1){
+/**
+* Recomputes every balance factor after the base class rebuilt the tree,
+* since its rotations do not know about them. The tree it builds is always
+* a valid AVL tree.
+*/
+template<class Key, class Value>
+void AVLTree<Key, Value>::afterRebuild()
+{
+    resetBalances(this->root_);
+}
 
-                Node<Key, Value>* g = c->left_;
-                rotateRight(c);
-                rotateLeft(n);
-                if (static_cast<AVLNode<Key,Value>*>(g)->getBalance() == -1){
-                    static_cast<AVLNode<Key,Value>*>(n)->setBalance(0);
-                    static_cast<AVLNode<Key,Value>*>(c)->setBalance(1);
-                    static_cast<AVLNode<Key,Value>*>(g)->setBalance(0);
-                }
-                else if (static_cast<AVLNode<Key,Value>*>(g)->getBalance() == 0){
-                    static_cast<AVLNode<Key,Value>*>(n)->setBalance(0);
-                    static_cast<AVLNode<Key,Value>*>(c)->setBalance(0);
-                    static_cast<AVLNode<Key,Value>*>(g)->setBalance(0);
-                }
-                else if (static_cast<AVLNode<Key,Value>*>(g)->getBalance() == 1){
-                    static_cast<AVLNode<Key,Value>*>(n)->setBalance(-1);
-                    static_cast<AVLNode<Key,Value>*>(c)->setBalance(0);
-                    static_cast<AVLNode<Key,Value>*>(g)->setBalance(0);
-                }
-                return;
-            }
-        }
-        
-        else if (((int) static_cast<AVLNode<Key,Value>*>(n)->getBalance()) + diff == 1){
-            static_cast<AVLNode<Key,Value>*>(n)->setBalance(1);
-            return;
-        }
-        else if (((int) static_cast<AVLNode<Key,Value>*>(n)->getBalance()) + diff == 0){
-            static_cast<AVLNode<Key,Value>*>(n)->setBalance(0);
-            removeFix(p, ndiff);
-        }
+template<class Key, class Value>
+int AVLTree<Key, Value>::resetBalances(Node<Key, Value>* n)
+{
+    if (n == nullptr){
+        return 0;
+    }
+    int leftHeight = resetBalances(n->left_);
+    int rightHeight = resetBalances(n->right_);
+    static_cast<AVLNode<Key,Value>*>(n)->setBalance(rightHeight - leftHeight);
+    return 1 + std::max(leftHeight, rightHeight);
 }
 
 template<class Key, class Value>
@@ -0,0 +1,57 @@
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include "avlbst.h"
+#include "bench-util.h"
+
+using namespace std;
+
+// Usage: batch-bench [num_keys] [num_lookups]
+// The interleaving only pays off once the tree is far bigger than the
+// caches, hence the 10M key default.
+
+int main(int argc, char *argv[])
+{
+    int n = (int) benchArg(argc, argv, 1, 10000000);
+    size_t lookups = (size_t) benchArg(argc, argv, 2, 4000000);
+
+    vector<int> keys = makeShuffledKeys(n, 1);
+    vector<int> trace = makeUniformTrace(n, lookups, 2);
+
+    AVLTree<int, int> tree;
+    for (size_t i = 0; i < keys.size(); ++i) {
+        tree.insert(std::make_pair(keys[i], keys[i]));
+    }
+    keys.clear();
+
+    cout << n << " keys, " << lookups << " uniform lookups" << endl;
+    cout << fixed << setprecision(1);
+    cout << "method           time(ms)  Mlookups/s" << endl;
+
+    long checksum = 0;
+    BenchTimer timer;
+    for (size_t i = 0; i < trace.size(); ++i) {
+        checksum += tree.find(trace[i])->second;
+    }
+    double ms = timer.elapsedMs();
+    cout << "find             " << setw(8) << ms << "  " << setw(10) << lookups / ms / 1000.0 << endl;
+
+    size_t batchSizes[] = { 64, 256, 512 };
+    for (size_t b = 0; b < sizeof(batchSizes) / sizeof(batchSizes[0]); ++b) {
+        size_t batch = batchSizes[b];
+        vector<AVLTree<int, int>::iterator> out(batch);
+        timer.reset();
+        for (size_t start = 0; start < trace.size(); start += batch) {
+            size_t count = std::min(batch, trace.size() - start);
+            tree.find_batch(&trace[start], count, &out[0]);
+            for (size_t i = 0; i < count; ++i) {
+                checksum += out[i]->second;
+            }
+        }
+        ms = timer.elapsedMs();
+        cout << "find_batch(" << setw(3) << batch << ")  " << setw(8) << ms << "  "
+             << setw(10) << lookups / ms / 1000.0 << endl;
+    }
+    cout << "(checksum " << checksum << ")" << endl;
+    return 0;
+}
@@ -0,0 +1,99 @@
+#ifndef BENCH_UTIL_H
+#define BENCH_UTIL_H
+
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <random>
+#include <vector>
+#include <algorithm>
+
+/**
+* Small helpers shared by the *-bench drivers: a wall clock timer and
+* generators for the key sets and lookup traces they replay.
+*/
+
+class BenchTimer
+{
+public:
+    BenchTimer() : start_(std::chrono::steady_clock::now()) {}
+    void reset() { start_ = std::chrono::steady_clock::now(); }
+    double elapsedMs() const
+    {
+        return std::chrono::duration<double, std::milli>(
+            std::chrono::steady_clock::now() - start_).count();
+    }
+private:
+    std::chrono::steady_clock::time_point start_;
+};
+
+/**
+* Returns the keys 0..n-1 in a random order.
+*/
+inline std::vector<int> makeShuffledKeys(int n, unsigned seed)
+{
+    std::vector<int> keys(n);
+    for (int i = 0; i < n; ++i) {
+        keys[i] = i;
+    }
+    std::mt19937 rng(seed);
+    std::shuffle(keys.begin(), keys.end(), rng);
+    return keys;
+}
+
+/**
+* Returns count keys drawn uniformly from 0..n-1.
+*/
+inline std::vector<int> makeUniformTrace(int n, size_t count, unsigned seed)
+{
+    std::mt19937 rng(seed);
+    std::uniform_int_distribution<int> dist(0, n - 1);
+    std::vector<int> trace(count);
+    for (size_t i = 0; i < count; ++i) {
+        trace[i] = dist(rng);
+    }
+    return trace;
+}
+
+/**
+* Returns count keys from 0..n-1 following a Zipf distribution with
+* exponent s. Ranks are mapped through a random permutation so the hot
+* keys are scattered over the key space instead of being adjacent.
+*/
+inline std::vector<int> makeZipfTrace(int n, size_t count, double s, unsigned seed)
+{
+    std::vector<double> cdf(n);
+    double total = 0;
+    for (int i = 0; i < n; ++i) {
+        total += 1.0 / std::pow(i + 1.0, s);
+        cdf[i] = total;
+    }
+    std::vector<int> rankToKey = makeShuffledKeys(n, seed + 1);
+    std::mt19937 rng(seed);
+    std::uniform_real_distribution<double> dist(0.0, total);
+    std::vector<int> trace(count);
+    for (size_t i = 0; i < count; ++i) {
+        size_t rank = std::lower_bound(cdf.begin(), cdf.end(), dist(rng)) - cdf.begin();
+        if (rank >= cdf.size()) {
+            rank = cdf.size() - 1;
+        }
+        trace[i] = rankToKey[rank];
+    }
+    return trace;
+}
+
+/**
+* Reads argv[index] as a positive integer, or returns fallback.
+*/
+inline long benchArg(int argc, char* argv[], int index, long fallback)
+{
+    if (argc > index) {
+        long v = std::atol(argv[index]);
+        if (v > 0) {
+            return v;
+        }
+    }
+    return fallback;
+}
+
+#endif
@@ -1,10 +1,40 @@
 #include <iostream>
 #include <map>
+#include <fstream>
+#include <chrono>
+#include <vector>
+#include <thread>
 #include "bst.h"
 #include "avlbst.h"
+#include "splaybst.h"
+#include "rbbst.h"
+#include "treapbst.h"
+#include "compactavlbst.h"
+#include "stackavlbst.h"
+#include "threadedavlbst.h"
+#include "augmentedavlbst.h"
+#include "intervalbst.h"
+#include "multiavlbst.h"
+#include "merkleavlbst.h"
+#include "durableavlbst.h"
+#include "epochavlbst.h"
+#include "lockfreebst.h"
+#include "orderedcache.h"
 
 using namespace std;
 
+// A clock the test moves by hand, for cache expiry
+struct ManualClock
+{
+    typedef std::chrono::milliseconds duration;
+    typedef duration::rep rep;
+    typedef duration::period period;
+    typedef std::chrono::time_point<ManualClock> time_point;
+    static const bool is_steady = true;
+    static time_point now() { return time_point(duration(ms)); }
+    static long ms;
+};
+long ManualClock::ms = 0;
 
 int main(int argc, char *argv[])
 {
@@ -26,6 +56,24 @@ int main(int argc, char *argv[])
     cout << "Erasing b" << endl;
     bt.remove('b');
 
+    // Sorted inserts stay shallow with self-healing on
+    BinarySearchTree<char,int> ht;
+    ht.setSelfHealing(true);
+    for(char c = 'a'; c <= 'g'; ++c) {
+        ht.insert(std::make_pair(c, c - 'a'));
+    }
+    cout << "\nSelf-healing Binary Search Tree:" << endl;
+    ht.print();
+
+    // A skewed tree can be reshaped in place
+    BinarySearchTree<char,int> sk;
+    for(char c = 'a'; c <= 'g'; ++c) {
+        sk.insert(std::make_pair(c, c - 'a'));
+    }
+    cout << "\nSkewed tree balanced: " << sk.isBalanced() << endl;
+    sk.rebalance();
+    cout << "After rebalance: " << sk.isBalanced() << endl;
+
     // AVL Tree Tests
     AVLTree<char,int> at;
     at.insert(std::make_pair('a',1));
@@ -44,5 +92,414 @@ int main(int argc, char *argv[])
     cout << "Erasing b" << endl;
     at.remove('b');
 
+    // Sorted inserts force a rotation once the tree leans two levels
+    at.insert(std::make_pair('c',3));
+    at.insert(std::make_pair('d',4));
+    cout << "Rotations so far: " << at.rotationCount() << endl;
+
+    // Turning on self-healing reshapes the tree; AVL balances must follow
+    AVLTree<int,int> healed;
+    for(int i = 0; i < 20; ++i) {
+        healed.insert(std::make_pair(i, i));
+    }
+    healed.setSelfHealing(true);
+    for(int i = 20; i < 60; ++i) {
+        healed.insert(std::make_pair(i, i));
+    }
+    for(int i = 0; i < 60; i += 3) {
+        healed.remove(i);
+    }
+    cout << "Self-healing AVLTree balanced: " << healed.isBalanced() << endl;
+
+    // Unsorted input with a repeated key; the later pair wins
+    AVLTree<char,int> pb;
+    std::pair<char,int> unsorted[] = { std::make_pair('c',3), std::make_pair('a',1),
+                                       std::make_pair('b',2), std::make_pair('a',4) };
+    pb.build_parallel(unsorted, unsorted + 4, 2);
+    cout << "Built in parallel:" << endl;
+    for(AVLTree<char,int>::iterator it = pb.begin(); it != pb.end(); ++it) {
+        cout << it->first << " " << it->second << endl;
+    }
+
+    // A copy has the same shape; merge moves the other tree's items in
+    AVLTree<char,int> copy(pb);
+    AVLTree<char,int> more;
+    more.insert(std::make_pair('b',5));
+    more.insert(std::make_pair('d',6));
+    copy.merge(more);
+    cout << "Merged copy:" << endl;
+    for(AVLTree<char,int>::iterator it = copy.begin(); it != copy.end(); ++it) {
+        cout << it->first << " " << it->second << endl;
+    }
+
+    // Other tree types do not merge in; through a base reference it throws
+    RBTree<char,int> redBlack;
+    redBlack.insert(std::make_pair('z',26));
+    BinarySearchTree<char,int>& asBase = copy;
+    try {
+        asBase.merge(redBlack);
+    }
+    catch (std::invalid_argument& e) {
+        cout << "RBTree not merged: " << e.what() << endl;
+    }
+    try {
+        asBase = redBlack;
+    }
+    catch (std::invalid_argument& e) {
+        cout << "RBTree not assigned: " << e.what() << endl;
+    }
+
+    // A node moves to another tree as is, without being reallocated
+    AVLTree<char,int>::node_type moved = copy.extract('b');
+    more.insert(std::move(moved));
+    cout << "Moved b over, value " << more.find('b')->second << endl;
+    BinarySearchTree<char,int>::node_type foreign = redBlack.extract('z');
+    try {
+        asBase.insert(std::move(foreign));
+    }
+    catch (std::invalid_argument& e) {
+        cout << "RBTree node not inserted: " << e.what() << ", handle kept " << !foreign.empty() << endl;
+    }
+
+    // Erasing by iterator and by predicate
+    copy.erase(copy.begin());
+    size_t evens = copy.erase_if([](const std::pair<const char,int>& item) { return item.second % 2 == 0; });
+    cout << "Erased a and " << evens << " even value(s), " << copy.begin()->first << " is left" << endl;
+
+    // Lazy deletion leaves tombstones until the tree is compacted
+    more.insert(std::make_pair('e',7));
+    more.setLazyDelete(true);
+    more.remove('b');
+    cout << "Tombstones " << more.tombstoneCount() << ", first live key " << more.begin()->first
+         << ", compaction due " << more.needsCompaction() << endl;
+    more.compact();
+    cout << "After compact " << more.tombstoneCount() << endl;
+
+    // Repeated lookups of the same key are served from the hot-key cache
+    at.enableLookupCache(16);
+    for(int i = 0; i < 3; ++i) {
+        at.find('a');
+    }
+    cout << "Cache hits " << at.lookupCacheHits() << ", misses " << at.lookupCacheMisses() << endl;
+
+    // Several keys looked up in one call
+    std::vector<char> wanted;
+    wanted.push_back('a');
+    wanted.push_back('b');
+    std::vector<AVLTree<char,int>::iterator> found;
+    at.find_batch(wanted, found);
+    for(size_t i = 0; i < wanted.size(); ++i) {
+        cout << wanted[i] << (found[i] != at.end() ? " found" : " not found") << endl;
+    }
+
+    // Whole-tree sum and a bump of every value, split across two threads
+    struct ValueOf { int operator()(const std::pair<const char,int>& item) const { return item.second; } };
+    struct Plus { int operator()(int a, int b) const { return a + b; } };
+    struct Bump { void operator()(std::pair<const char,int>& item) const { item.second += 10; } };
+    cout << "Sum of values: " << at.parallel_reduce(0, ValueOf(), Plus(), 2) << endl;
+    at.parallel_for_each(Bump(), 2);
+    cout << "After bump: " << at.parallel_reduce(0, ValueOf(), Plus(), 2) << endl;
+
+    // Range sums from per-subtree summaries
+    AugmentedAVLTree<char,int,SumMonoid<int> > sum;
+    sum.insert(std::make_pair('a',1));
+    sum.insert(std::make_pair('b',2));
+    sum.insert(std::make_pair('c',3));
+    sum.insert(std::make_pair('d',4));
+    cout << "Sum of [b, d): " << sum.aggregate('b', 'd') << endl;
+    sum.remove('c');
+    cout << "After erasing c: " << sum.aggregate('b', 'd') << endl;
+    AVLTree<char,int>& sumAsAVL = sum;
+    sumAsAVL.build_parallel(unsorted, unsorted + 4, 2);
+    cout << "Sum after build_parallel: " << sum.summary() << endl;
+
+    // Interval Tree Tests
+    IntervalTree<int,char> ivt;
+    ivt.insert(1, 5, 'x');
+    ivt.insert(3, 4, 'y');
+    ivt.insert(6, 9, 'z');
+    std::vector<IntervalTree<int,char>::iterator> hits;
+    ivt.overlapping(4, 7, hits);
+    cout << "Overlapping [4, 7):" << endl;
+    for(size_t i = 0; i < hits.size(); ++i) {
+        cout << hits[i]->first << " " << hits[i]->second << endl;
+    }
+
+    // Replicas with the same items match whatever order they were built in
+    MerkleAVLTree<int,int> replicaA, replicaB;
+    for(int i = 0; i < 8; ++i) {
+        replicaA.insert(std::make_pair(i, i * i));
+        replicaB.insert(std::make_pair(7 - i, (7 - i) * (7 - i)));
+    }
+    cout << "Replicas match: " << replicaA.matches(replicaB) << endl;
+    replicaB.insert(std::make_pair(3, 0));
+    replicaB.remove(6);
+    std::vector<int> differing;
+    replicaA.diff(replicaB, differing);
+    cout << "Differing keys:";
+    for(size_t i = 0; i < differing.size(); ++i) {
+        cout << " " << differing[i];
+    }
+    cout << endl;
+
+    // A logged tree comes back after a restart
+    std::remove("bst-test-wal.log");
+    std::remove("bst-test-wal.ckpt");
+    {
+        DurableAVLTree<int,int> logged;
+        logged.open("bst-test-wal", 4);
+        logged.insert(std::make_pair(1, 10));
+        logged.insert(std::make_pair(2, 20));
+        logged.checkpoint();
+        logged.remove(1);
+        logged.insert(std::make_pair(3, 30));
+    }
+    {
+        DurableAVLTree<int,int> recovered;
+        recovered.open("bst-test-wal");
+        cout << "Recovered:";
+        for(DurableAVLTree<int,int>::iterator it = recovered.begin(); it != recovered.end(); ++it) {
+            cout << " " << it->first << "=" << it->second;
+        }
+        cout << endl;
+    }
+    // A record with an empty payload counts as torn and is cut off
+    {
+        std::ofstream log("bst-test-wal.log", std::ios::binary | std::ios::app);
+        uint32_t header[2] = { 0, 2166136261u }; // size 0 and the checksum of no bytes
+        log.write(reinterpret_cast<const char*>(header), sizeof(header));
+    }
+    {
+        DurableAVLTree<int,int> reopened;
+        reopened.open("bst-test-wal");
+        reopened.insert(std::make_pair(4, 40));
+    }
+    {
+        DurableAVLTree<int,int> recovered;
+        recovered.open("bst-test-wal");
+        cout << "Recovered past an empty record:";
+        for(DurableAVLTree<int,int>::iterator it = recovered.begin(); it != recovered.end(); ++it) {
+            cout << " " << it->first << "=" << it->second;
+        }
+        cout << endl;
+    }
+    // clear, the erase family and node handles are logged as well
+    {
+        DurableAVLTree<int,int> logged;
+        logged.open("bst-test-wal", 4);
+        logged.clear();
+        for(int k = 1; k <= 8; ++k) {
+            logged.insert(std::make_pair(k, k * 10));
+        }
+        logged.erase(logged.find(1));
+        logged.erase(logged.find(2), logged.find(4));
+        logged.erase_if([](const std::pair<const int,int>& item) { return item.first % 2 == 0; });
+        DurableAVLTree<int,int>::node_type moved = logged.extract(5);
+        moved.mapped() = 55;
+        logged.insert(std::move(moved));
+        logged.extract(7);
+    }
+    {
+        DurableAVLTree<int,int> recovered;
+        recovered.open("bst-test-wal");
+        cout << "Recovered after erasing:";
+        for(DurableAVLTree<int,int>::iterator it = recovered.begin(); it != recovered.end(); ++it) {
+            cout << " " << it->first << "=" << it->second;
+        }
+        cout << endl;
+        recovered.clear();
+    }
+    {
+        DurableAVLTree<int,int> recovered;
+        recovered.open("bst-test-wal");
+        cout << "Recovered after clear: " << recovered.empty() << endl;
+    }
+    std::remove("bst-test-wal.log");
+    std::remove("bst-test-wal.ckpt");
+
+    // Lock-free reads with epoch reclamation
+    EpochAVLTree<char,int> et;
+    EpochAVLTree<char,int>::Reader reader(et.reclaimer());
+    et.insert(std::make_pair('a',1));
+    et.insert(std::make_pair('b',2));
+    et.insert(std::make_pair('b',3));
+    et.remove('a');
+    int seen = 0;
+    cout << "Reader finds b: " << et.find('b', seen, reader) << " (" << seen << ")"
+         << ", a: " << et.find('a', seen, reader) << endl;
+    et.collect();
+    cout << "Retired after collect: " << et.retiredCount() << endl;
+
+    // Lock-free tree shared by several threads
+    LockFreeBST<int,int> lf;
+    std::vector<std::thread> workers;
+    for(int t = 0; t < 4; ++t) {
+        workers.push_back(std::thread([&lf, t]() {
+            LockFreeBST<int,int>::Handle handle(lf.reclaimer());
+            for(int k = t; k < 40; k += 4) {
+                lf.insert(std::make_pair(k, k), handle);
+            }
+            for(int k = t; k < 40; k += 8) {
+                lf.remove(k, handle);
+            }
+        }));
+    }
+    for(size_t t = 0; t < workers.size(); ++t) {
+        workers[t].join();
+    }
+    LockFreeBST<int,int>::Handle lfHandle(lf.reclaimer());
+    cout << "Lock-free size " << lf.size() << ", first keys:";
+    LockFreeBST<int,int>::iterator lfIt = lf.begin(lfHandle);
+    for(int i = 0; i < 4 && lfIt != lf.end(); ++i, ++lfIt) {
+        cout << " " << lfIt->first;
+    }
+    cout << endl;
+
+    // A three-entry cache drops its least recently used key
+    OrderedCache<char,int> oc(3);
+    oc.insert(std::make_pair('a',1));
+    oc.insert(std::make_pair('b',2));
+    oc.insert(std::make_pair('c',3));
+    int cached;
+    oc.get('a', cached);
+    oc.insert(std::make_pair('d',4));
+    cout << "Cached from b:";
+    for(OrderedCache<char,int>::iterator it = oc.lower_bound('b'); it != oc.end(); ++it) {
+        cout << " " << it->first;
+    }
+    cout << " (evicted " << oc.evictionCount() << ", b cached: " << oc.contains('b') << ")" << endl;
+
+    // Range queries skip entries whose time to live has run out
+    OrderedCache<char,int,CacheItemSize,ManualClock> ttl;
+    ttl.setTimeToLive(std::chrono::milliseconds(10));
+    ttl.insert(std::make_pair('a',1));
+    ttl.insert(std::make_pair('b',2));
+    ManualClock::ms = 5;
+    ttl.insert(std::make_pair('c',3));
+    ttl.insert(std::make_pair('d',4));
+    ManualClock::ms = 12;
+    cout << "Live from a:";
+    for(OrderedCache<char,int,CacheItemSize,ManualClock>::iterator it = ttl.lower_bound('a'); it != ttl.end(); ++it) {
+        cout << " " << it->first;
+    }
+    cout << ", after a: " << ttl.upper_bound('a')->first << endl;
+
+    // Multimap Tests
+    MultiAVLTree<char,int> mt;
+    mt.insert(std::make_pair('a',1));
+    mt.insert(std::make_pair('a',2));
+    mt.insert(std::make_pair('b',3));
+    mt.insert(std::make_pair('a',4));
+    cout << "Values under a (" << mt.count('a') << "):";
+    std::pair<int*, int*> run = mt.equal_range('a');
+    for(int* v = run.first; v != run.second; ++v) {
+        cout << " " << *v;
+    }
+    cout << endl;
+    mt.erase('a', 2);
+    cout << "After erasing (a, 2): " << mt.count('a') << " left" << endl;
+
+    // Splay Tree Tests
+    SplayTree<char,int> st;
+    st.insert(std::make_pair('a',1));
+    st.insert(std::make_pair('b',2));
+    st.insert(std::make_pair('c',3));
+
+    cout << "\nSplayTree contents:" << endl;
+    for(SplayTree<char,int>::iterator it = st.begin(); it != st.end(); ++it) {
+        cout << it->first << " " << it->second << endl;
+    }
+    if(st.find('a') != st.end()) {
+        cout << "Found a" << endl;
+    }
+    else {
+        cout << "Did not find a" << endl;
+    }
+    cout << "Erasing b" << endl;
+    st.remove('b');
+    st.print();
+
+    // Red-Black Tree Tests
+    RBTree<char,int> rt;
+    rt.insert(std::make_pair('a',1));
+    rt.insert(std::make_pair('b',2));
+    rt.insert(std::make_pair('c',3));
+
+    cout << "\nRBTree contents:" << endl;
+    for(RBTree<char,int>::iterator it = rt.begin(); it != rt.end(); ++it) {
+        cout << it->first << " " << it->second << endl;
+    }
+    if(rt.find('b') != rt.end()) {
+        cout << "Found b" << endl;
+    }
+    else {
+        cout << "Did not find b" << endl;
+    }
+    cout << "Erasing b" << endl;
+    rt.remove('b');
+    rt.print();
+
+    // Treap Tests
+    Treap<char,int> tt;
+    std::pair<char,int> batch[] = { std::make_pair('d',4), std::make_pair('a',1),
+                                    std::make_pair('c',3), std::make_pair('b',2),
+                                    std::make_pair('a',5) };
+    tt.insert_bulk(batch, batch + 5, 2);
+
+    cout << "\nTreap contents:" << endl;
+    for(Treap<char,int>::iterator it = tt.begin(); it != tt.end(); ++it) {
+        cout << it->first << " " << it->second << endl;
+    }
+    cout << "Erasing [b, d)" << endl;
+    tt.remove_range('b', 'd', 2);
+    for(Treap<char,int>::iterator it = tt.begin(); it != tt.end(); ++it) {
+        cout << it->first << " " << it->second << endl;
+    }
+
+    // Compact AVL Tree Tests
+    CompactAVLTree<char,int> ct;
+    ct.insert(std::make_pair('a',1));
+    ct.insert(std::make_pair('b',2));
+    ct.insert(std::make_pair('c',3));
+
+    cout << "\nCompactAVLTree contents:" << endl;
+    ct.print();
+    if(ct.find('b') != ct.end()) {
+        cout << "Found b" << endl;
+    }
+    else {
+        cout << "Did not find b" << endl;
+    }
+    cout << "Erasing b" << endl;
+    ct.remove('b');
+
+    // Stack AVL Tree Tests
+    StackAVLTree<char,int> pt;
+    pt.insert(std::make_pair('a',1));
+    pt.insert(std::make_pair('b',2));
+    pt.insert(std::make_pair('c',3));
+
+    cout << "\nStackAVLTree contents:" << endl;
+    pt.print();
+    cout << "Iterating from b:" << endl;
+    for(StackAVLTree<char,int>::iterator it = pt.find('b'); it != pt.end(); ++it) {
+        cout << it->first << " " << it->second << endl;
+    }
+    cout << "Erasing b" << endl;
+    pt.remove('b');
+    pt.print();
+
+    // Threaded AVL Tree Tests
+    ThreadedAVLTree<char,int> tht;
+    tht.insert(std::make_pair('a',1));
+    tht.insert(std::make_pair('b',2));
+    tht.insert(std::make_pair('c',3));
+
+    cout << "\nThreadedAVLTree contents:" << endl;
+    tht.print();
+    cout << "Erasing b" << endl;
+    tht.remove('b');
+    tht.print();
+
     return 0;
 }
@@ -3,8 +3,23 @@
 
 #include <iostream>
 #include <exception>
+#include <stdexcept>
+#include <typeinfo>
 #include <cstdlib>
 #include <utility>
+#include <cmath>
+#include <functional>
+#include <vector>
+#include <thread>
+#include <algorithm>
+#include "workpool.h"
+
+// Hint that a node is about to be read; a no-op on compilers without the builtin
+#if defined(__GNUC__)
+#define BST_PREFETCH(addr) __builtin_prefetch(addr)
+#else
+#define BST_PREFETCH(addr) ((void)0)
+#endif
 
 /**
  * A templated class for a Node in a search tree.
@@ -29,6 +44,7 @@ public:
     virtual Node<Key, Value>* getParent() const;
     virtual Node<Key, Value>* getLeft() const;
     virtual Node<Key, Value>* getRight() const;
+    virtual bool isTombstone() const; // Removed but still linked, see AVLTree::setLazyDelete
 
     void setParent(Node<Key, Value>* parent);
     void setLeft(Node<Key, Value>* left);
@@ -147,6 +163,16 @@ Node<Key, Value>* Node<Key, Value>::getRight() const
     return right_;
 }
 
+/**
+* Plain nodes are never tombstones; only trees with lazy deletion leave
+* dead nodes linked in.
+*/
+template<typename Key, typename Value>
+bool Node<Key, Value>::isTombstone() const
+{
+    return false;
+}
+
 /**
 * A setter for setting the parent of a node.
 */
@@ -157,21 +183,24 @@ void Node<Key, Value>::setParent(Node<Key, Value>* parent)
 }
 
 /**
-* A setter for setting the left child of a node.
+* A setter for setting the left child of a node. Child links are written
+* with a release store, so a lock-free reader (see EpochAVLTree) that loads
+* them with acquire never sees a torn pointer or a half-built child.
 */
 template<typename Key, typename Value>
 void Node<Key, Value>::setLeft(Node<Key, Value>* left)
 {
-    left_ = left;
+    __atomic_store_n(&left_, left, __ATOMIC_RELEASE);
 }
 
 /**
-* A setter for setting the right child of a node.
+* A setter for setting the right child of a node, a release store like
+* setLeft.
 */
 template<typename Key, typename Value>
 void Node<Key, Value>::setRight(Node<Key, Value>* right)
 {
-    right_ = right;
+    __atomic_store_n(&right_, right, __ATOMIC_RELEASE);
 }
 
 /**
@@ -189,6 +218,131 @@ void Node<Key, Value>::setValue(const Value& value)
   ---------------------------------------
 */
 
+/**
+* Interface for the optional hot-key cache that internalFind checks before
+* descending. It maps keys to the nodes that hold them; since a node never
+* changes its key, rotations and nodeSwap leave it valid and only deleting
+* a node requires an evict.
+*
+* lookup and store run under const lookups, so several readers may call them
+* at once: slots and counters are touched only with relaxed atomic loads and
+* stores. Racing readers can overwrite each other's slot or lose a count,
+* but never see a torn pointer.
+*/
+template <typename Key, typename Value>
+class LookupCacheBase
+{
+public:
+    LookupCacheBase() : hits_(0), misses_(0) {}
+    virtual ~LookupCacheBase() {}
+
+    virtual Node<Key, Value>* lookup(const Key& key) = 0; // NULL on a miss
+    virtual void store(Node<Key, Value>* node) = 0;
+    virtual void evict(const Key& key) = 0;
+    virtual void reset() = 0;
+
+    size_t hits() const { return __atomic_load_n(&hits_, __ATOMIC_RELAXED); }
+    size_t misses() const { return __atomic_load_n(&misses_, __ATOMIC_RELAXED); }
+
+protected:
+    // Load and store rather than fetch_add: no locked instruction on a hit
+    static void count(size_t& counter)
+    {
+        __atomic_store_n(&counter, __atomic_load_n(&counter, __ATOMIC_RELAXED) + 1, __ATOMIC_RELAXED);
+    }
+
+    size_t hits_;
+    size_t misses_;
+};
+
+/**
+* A fixed-size direct-mapped cache: each key hashes to exactly one slot and a
+* newer entry simply replaces whatever was there.
+*/
+template <typename Key, typename Value, typename Hash>
+class LookupCache : public LookupCacheBase<Key, Value>
+{
+public:
+    explicit LookupCache(size_t slots);
+
+    virtual Node<Key, Value>* lookup(const Key& key);
+    virtual void store(Node<Key, Value>* node);
+    virtual void evict(const Key& key);
+    virtual void reset();
+
+protected:
+    size_t slotFor(const Key& key) const;
+
+    std::vector<Node<Key, Value>*> slots_;
+    size_t mask_;
+    Hash hash_;
+};
+
+/*
+  ------------------------------------------------
+  Begin implementations for the LookupCache class.
+  ------------------------------------------------
+*/
+
+/**
+* Rounds slots up to a power of two so a slot index is a mask away.
+*/
+template<typename Key, typename Value, typename Hash>
+LookupCache<Key, Value, Hash>::LookupCache(size_t slots)
+{
+    size_t size = 1;
+    while (size < slots) {
+        size *= 2;
+    }
+    slots_.assign(size, nullptr);
+    mask_ = size - 1;
+}
+
+template<typename Key, typename Value, typename Hash>
+Node<Key, Value>* LookupCache<Key, Value, Hash>::lookup(const Key& key)
+{
+    Node<Key, Value>* node = __atomic_load_n(&slots_[slotFor(key)], __ATOMIC_RELAXED);
+    if (node != nullptr && node->getKey() == key) {
+        this->count(this->hits_);
+        return node;
+    }
+    this->count(this->misses_);
+    return nullptr;
+}
+
+template<typename Key, typename Value, typename Hash>
+void LookupCache<Key, Value, Hash>::store(Node<Key, Value>* node)
+{
+    __atomic_store_n(&slots_[slotFor(node->getKey())], node, __ATOMIC_RELAXED);
+}
+
+template<typename Key, typename Value, typename Hash>
+void LookupCache<Key, Value, Hash>::evict(const Key& key)
+{
+    Node<Key, Value>*& slot = slots_[slotFor(key)];
+    if (slot != nullptr && slot->getKey() == key) {
+        slot = nullptr;
+    }
+}
+
+template<typename Key, typename Value, typename Hash>
+void LookupCache<Key, Value, Hash>::reset()
+{
+    std::fill(slots_.begin(), slots_.end(), static_cast<Node<Key, Value>*>(nullptr));
+}
+
+template<typename Key, typename Value, typename Hash>
+size_t LookupCache<Key, Value, Hash>::slotFor(const Key& key) const
+{
+    return hash_(key) & mask_;
+}
+
+/*
+  ----------------------------------------------
+  End implementations for the LookupCache class.
+  ----------------------------------------------
+*/
+
 /**
 * A templated unbalanced binary search tree.
 */
@@ -197,6 +351,8 @@ class BinarySearchTree
 {
 public:
     BinarySearchTree(); 
+    BinarySearchTree(const BinarySearchTree& other); // O(n) clone of other's shape
+    BinarySearchTree& operator=(const BinarySearchTree& other);
     virtual ~BinarySearchTree(); 
     virtual void insert(const std::pair<const Key, Value>& keyValuePair); 
     virtual void remove(const Key& key); 
@@ -204,6 +360,17 @@ public:
     bool isBalanced() const; 
     void print() const;
     bool empty() const;
+    void setSelfHealing(bool enabled); // Opt-in scapegoat rebuilding for BinarySearchTree::insert/remove
+    virtual void rebalance(); // Reshapes the whole tree into a complete tree in place
+    void merge(BinarySearchTree& other); // Moves other's items in, O(m + n); other ends up empty. Derived trees take only their own type
+
+    // Optional hot-key cache in front of internalFind. Hash is only
+    // instantiated when the cache is enabled.
+    template<typename Hash = std::hash<Key> >
+    void enableLookupCache(size_t slots);
+    void disableLookupCache();
+    size_t lookupCacheHits() const;
+    size_t lookupCacheMisses() const;
 
     template<typename PPKey, typename PPValue>
     friend void prettyPrintBST(BinarySearchTree<PPKey, PPValue> & tree);
@@ -230,13 +397,69 @@ public:
         Node<Key, Value> *current_;
     };
 
+    /**
+    * Owns a node taken out of a tree by extract() until it is inserted into
+    * another tree of the same type, or frees it when the handle goes away.
+    * It remembers the type of the tree it came from, since every tree type
+    * shares this handle type but not its node type.
+    */
+    class node_type
+    {
+    public:
+        node_type();
+        node_type(node_type&& other);
+        node_type& operator=(node_type&& other);
+        ~node_type();
+
+        bool empty() const;
+        explicit operator bool() const;
+        const Key& key() const;
+        Value& mapped() const;
+
+    protected:
+        friend class BinarySearchTree<Key, Value>;
+        node_type(Node<Key, Value>* node, const std::type_info& source);
+        Node<Key, Value>* node_;
+        const std::type_info* source_; // typeid of the tree extract() was called on
+
+    private:
+        node_type(const node_type&);            // not copyable
+        node_type& operator=(const node_type&);
+    };
+
 public:
     iterator begin() const;
     iterator end() const;
     iterator find(const Key& key) const;
+    void find_batch(const Key* keys, size_t count, iterator* out) const;
+    void find_batch(const std::vector<Key>& keys, std::vector<iterator>& out) const;
+
+    // Parallel traversal: the tree is split into subtree tasks of roughly
+    // grain nodes, run on a work-stealing pool (threads == 0 means the
+    // hardware count). fn, map and combine are called concurrently and the
+    // tree must not change meanwhile. The reduce brackets its combines by
+    // tree shape and grain alone, so with an associative combine the
+    // result does not depend on the thread count or the scheduling.
+    template<typename Fn>
+    void parallel_for_each(Fn fn, unsigned threads = 0, size_t grain = 4096);
+    template<typename T, typename Map, typename Combine>
+    T parallel_reduce(const T& identity, Map map, Combine combine, unsigned threads = 0, size_t grain = 4096) const;
     Value& operator[](const Key& key);
     Value const & operator[](const Key& key) const;
 
+    // Moving single nodes between trees of the same type without
+    // reallocating them. An absent key or end() gives an empty handle.
+    node_type extract(const Key& key);
+    node_type extract(iterator pos);
+    std::pair<iterator, bool> insert(node_type&& handle); // The handle keeps its node if the key is taken
+
+    // Erasing through iterators, without searching for the keys again.
+    // Iterators to the items that are kept stay valid.
+    iterator erase(iterator pos); // Returns the successor of pos
+    iterator erase(iterator first, iterator last); // Erases [first, last), returns last
+    template<typename Pred>
+    size_t erase_if(Pred pred); // Erases the items pred is true for, returns how many
+
 protected:
     // Mandatory helper functions
     Node<Key, Value>* internalFind(const Key& k) const; // TODO
@@ -248,15 +471,52 @@ protected:
     // Provided helper functions
     virtual void printRoot (Node<Key, Value> *r) const;
     virtual void nodeSwap( Node<Key,Value>* n1, Node<Key,Value>* n2) ;
+    virtual Node<Key, Value>* cloneNode(const Node<Key, Value>* src, Node<Key, Value>* parent) const ; // Copies item and balance data
+    void mergeFrom(BinarySearchTree& other) ; // merge() for derived trees; throws unless other is the same type as this
+    virtual void mergeValue(Node<Key, Value>* mine, Node<Key, Value>* theirs) ; // merge() found the key in both trees
+    virtual void afterRebuild() ; // Restores per-node data once rebalance() or merge() rebuilt the shape
+    virtual Node<Key, Value>* linkNode(Node<Key, Value>* n) ; // Hangs n in the tree, or returns the node that has its key
+    virtual void unlinkNode(Node<Key, Value>* n) ; // Takes n out of the tree without freeing it
+    Node<Key, Value>* findSlot(const Key& key, Node<Key, Value>*& parent) const ; // Match, or NULL and the leaf's parent
+    void setRoot(Node<Key, Value>* root) ; // Release store, like Node::setLeft
 
     // Add helper functions here
 		bool isBalancedHelper(Node<Key, Value>* node) const ; // Performs is Balanced
 		int height(Node<Key, Value>* node) const ; // Gets the height
     void clearHelper(Node<Key, Value>* node) ; // Use recursion to inorder delete each element
+    Node<Key, Value>* cloneTree(const Node<Key, Value>* src) const ; // Copies the subtree at src, same shape
+    size_t subtreeSize(Node<Key, Value>* node) const ; // Counts the nodes below and including node
+    void rebuildSubtree(Node<Key, Value>* node) ; // Reshapes the subtree at node into a balanced one
+    static Node<Key, Value>* treeToVine(Node<Key, Value>* node, size_t& count) ; // Flattens into a right-linked list
+    static Node<Key, Value>* vineToTree(Node<Key, Value>*& head, size_t count) ; // Builds a balanced tree from the list
+    static void compressVine(Node<Key, Value>*& head, size_t count) ; // One left-rotation pass of Day-Stout-Warren
+    static int depthBound(size_t size) ; // Deepest allowed node depth in self-healing mode
+    void evictCached(const Key& key) ; // Must be called before the node holding key is deleted
+    static iterator iteratorAt(Node<Key, Value>* node) ; // Lets derived trees hand out iterators
+    static unsigned workerCount(unsigned threads, size_t work) ; // 0 threads means the hardware count
+    static void sortAndDedupe(std::vector<std::pair<Key, Value> >& items, unsigned threads) ; // Last duplicate wins
+    int parallelSplitDepth(size_t grain) const ; // Nodes above this depth are split into tasks
+    static void collectNodes(Node<Key, Value>* node, std::vector<Node<Key, Value>*>& out) ; // Appends the subtree in key order
+    static void dropTombstones(std::vector<Node<Key, Value>*>& nodes) ; // Frees the dead ones, keeps the order
+    static Node<Key, Value>* linkBalanced(Node<Key, Value>* const* nodes, size_t count) ; // Sorted nodes into a balanced tree
+    void rebuildFrom(const std::vector<Node<Key, Value>*>& nodes) ; // The sorted nodes become the whole tree
+    template<typename Visit>
+    static void visitInOrder(Node<Key, Value>* node, Visit& visit) ; // Iterative walk of one subtree
+    template<typename Fn>
+    static void forEachSubtree(WorkStealingPool* pool, Node<Key, Value>* node, int depth, int splitDepth, Fn& fn) ;
+    template<typename T, typename Map, typename Combine>
+    static T reduceSubtree(WorkStealingPool* pool, Node<Key, Value>* node, int depth, int splitDepth,
+                           const T& identity, Map& map, Combine& combine) ;
 
 protected:
     Node<Key, Value>* root_;
-    // You should not need other data members
+    // Only maintained while self-healing is on, except that AVLTree
+    // always keeps size_
+    bool selfHealing_;
+    size_t size_;
+    size_t maxSize_;
+    size_t tombstones_; // Dead nodes still linked in, see AVLTree::setLazyDelete
+    LookupCacheBase<Key, Value>* cache_; // NULL unless enableLookupCache was called
 };
 
 /*
@@ -271,12 +531,8 @@ Begin implementations for the BinarySearchTree::iterator class.
 template<class Key, class Value>
 BinarySearchTree<Key, Value>::iterator::iterator(Node<Key,Value> *ptr)
 {
+    // Point exactly at ptr; begin() already passes in the leftmost node
     current_ = ptr;
-    // Get the leftmost node
-    while (current_ && current_->getLeft() != nullptr)
-    {
-        current_ = current_->getLeft();
-    }
 }
 
 /**
@@ -333,37 +589,113 @@ BinarySearchTree<Key, Value>::iterator::operator!=(
 
 
 /**
-* Advances the iterator's location using an in-order sequencing
+* Advances the iterator's location using an in-order sequencing,
+* skipping tombstones
 */
 template<class Key, class Value>
 typename BinarySearchTree<Key, Value>::iterator&
 BinarySearchTree<Key, Value>::iterator::operator++()
 {
-    if (current_->getRight()) {
-        // If the current node has a right child, move to the right child.
-        current_ = current_->getRight();
-        while (current_->getLeft()) {
-            current_ = current_->getLeft();
-        }
-    } else {
-        // Else move up the tree until we find the first parent node whose left child is not the current node or until we reach the root.
-        Node<Key, Value>* parent = current_->getParent();
-        while (parent && current_ == parent->getRight()) {
+    do {
+        if (current_->getRight()) {
+            // If the current node has a right child, move to the right child.
+            current_ = current_->getRight();
+            while (current_->getLeft()) {
+                current_ = current_->getLeft();
+            }
+        } else {
+            // Else move up the tree until we find the first parent node whose left child is not the current node or until we reach the root.
+            Node<Key, Value>* parent = current_->getParent();
+            while (parent && current_ == parent->getRight()) {
+                current_ = parent;
+                parent = current_->getParent();
+            }
+
+            // Step 3: Set the current node to the left child of the parent found in step 2,
+            // or to null if we reach the root.
             current_ = parent;
-            parent = current_->getParent();
         }
+    } while (current_ && current_->isTombstone()); // Step over lazily deleted nodes
+    return *this;
+}
+
+
+/*
+-------------------------------------------------------------
+End implementations for the BinarySearchTree::iterator class.
+-------------------------------------------------------------
+*/
+
+/*
+---------------------------------------------------------------
+Begin implementations for the BinarySearchTree::node_type class.
+----------------------------------------------------------------
+*/
+
+template<class Key, class Value>
+BinarySearchTree<Key, Value>::node_type::node_type() : node_(nullptr), source_(nullptr)
+{
+}
+
+template<class Key, class Value>
+BinarySearchTree<Key, Value>::node_type::node_type(Node<Key, Value>* node, const std::type_info& source)
+    : node_(node), source_(&source)
+{
+}
+
+template<class Key, class Value>
+BinarySearchTree<Key, Value>::node_type::node_type(node_type&& other)
+    : node_(other.node_), source_(other.source_)
+{
+    other.node_ = nullptr;
+}
 
-        // Step 3: Set the current node to the left child of the parent found in step 2,
-        // or to null if we reach the root.
-        current_ = parent;
+template<class Key, class Value>
+typename BinarySearchTree<Key, Value>::node_type&
+BinarySearchTree<Key, Value>::node_type::operator=(node_type&& other)
+{
+    if (this != &other) {
+        delete node_;
+        node_ = other.node_;
+        source_ = other.source_;
+        other.node_ = nullptr;
     }
     return *this;
 }
 
+template<class Key, class Value>
+BinarySearchTree<Key, Value>::node_type::~node_type()
+{
+    delete node_;
+}
+
+template<class Key, class Value>
+bool BinarySearchTree<Key, Value>::node_type::empty() const
+{
+    return node_ == nullptr;
+}
+
+template<class Key, class Value>
+BinarySearchTree<Key, Value>::node_type::operator bool() const
+{
+    return node_ != nullptr;
+}
+
+template<class Key, class Value>
+const Key& BinarySearchTree<Key, Value>::node_type::key() const
+{
+    return node_->getKey();
+}
+
+template<class Key, class Value>
+Value& BinarySearchTree<Key, Value>::node_type::mapped() const
+{
+    return node_->getValue();
+}
 
 /*
 -------------------------------------------------------------
-End implementations for the BinarySearchTree::iterator class.
+End implementations for the BinarySearchTree::node_type class.
 -------------------------------------------------------------
 */
 
@@ -377,21 +709,58 @@ Begin implementations for the BinarySearchTree class.
 * Default constructor for a BinarySearchTree, which sets the root to NULL.
 */
 template<class Key, class Value>
-BinarySearchTree<Key, Value>::BinarySearchTree() : root_(nullptr){} // set root_ to nullptr
+BinarySearchTree<Key, Value>::BinarySearchTree() :
+    root_(nullptr), selfHealing_(false), size_(0), maxSize_(0), tombstones_(0), cache_(nullptr){} // set root_ to nullptr
+
+/**
+* Copies other node for node, so the copy has the same shape and per-node
+* balance data and no key is compared. The lookup cache is not copied.
+*/
+template<typename Key, typename Value>
+BinarySearchTree<Key, Value>::BinarySearchTree(const BinarySearchTree<Key, Value>& other) :
+    root_(nullptr), selfHealing_(other.selfHealing_), size_(other.size_), maxSize_(other.maxSize_),
+    tombstones_(other.tombstones_), cache_(nullptr)
+{
+    root_ = other.cloneTree(other.root_);
+}
+
+/**
+* Keeps this tree's lookup cache, if any, but empties it. Like merge(), it
+* throws std::invalid_argument if other is a tree of another type, whose
+* nodes this tree could not work with.
+*/
+template<typename Key, typename Value>
+BinarySearchTree<Key, Value>& BinarySearchTree<Key, Value>::operator=(const BinarySearchTree<Key, Value>& other)
+{
+    if (typeid(*this) != typeid(other)) {
+        throw std::invalid_argument("operator=: trees of different types");
+    }
+    if (this != &other) {
+        Node<Key, Value>* copy = other.cloneTree(other.root_);
+        clear();
+        root_ = copy;
+        selfHealing_ = other.selfHealing_;
+        size_ = other.size_;
+        maxSize_ = other.maxSize_;
+        tombstones_ = other.tombstones_;
+    }
+    return *this;
+}
 
 template<typename Key, typename Value>
 BinarySearchTree<Key, Value>::~BinarySearchTree()
 {
  clear(); // Clear removes all elements
+ delete cache_;
 }
 
 /**
- * Returns true if tree is empty
+ * Returns true if tree is empty. Tombstones do not count as items.
 */
 template<class Key, class Value>
 bool BinarySearchTree<Key, Value>::empty() const
 {
-    return root_ == NULL;
+    return root_ == NULL || (tombstones_ != 0 && begin() == end());
 }
 
 template<typename Key, typename Value>
@@ -409,6 +778,9 @@ typename BinarySearchTree<Key, Value>::iterator
 BinarySearchTree<Key, Value>::begin() const
 {
     BinarySearchTree<Key, Value>::iterator begin(getSmallestNode());
+    if (begin.current_ && begin.current_->isTombstone()) {
+        ++begin;
+    }
     return begin;
 }
 
@@ -436,6 +808,284 @@ BinarySearchTree<Key, Value>::find(const Key & k) const
     return it;
 }
 
+/**
+* Looks up count keys at once and stores an iterator for each in out (end()
+* for a miss). Lookups advance in groups of kBatchGroup, one level per
+* round, and each round prefetches the next node of every unfinished
+* lookup, so the cache misses of a group overlap instead of being paid one
+* after another. The descent reads left_/right_ directly to avoid a virtual
+* call per level and does not consult the lookup cache.
+*/
+template<class Key, class Value>
+void BinarySearchTree<Key, Value>::find_batch(const Key* keys, size_t count, iterator* out) const
+{
+    const size_t kBatchGroup = 16;
+    Node<Key, Value>* current[kBatchGroup];
+    for (size_t base = 0; base < count; base += kBatchGroup) {
+        size_t group = std::min(kBatchGroup, count - base);
+        for (size_t i = 0; i < group; ++i) {
+            current[i] = root_;
+        }
+        size_t active = root_ ? group : 0;
+        while (active > 0) {
+            active = 0;
+            for (size_t i = 0; i < group; ++i) {
+                Node<Key, Value>* node = current[i];
+                if (node == nullptr) {
+                    continue;
+                }
+                const Key& key = keys[base + i];
+                if (key == node->item_.first) {
+                    out[base + i] = iterator(node->isTombstone() ? nullptr : node);
+                    current[i] = nullptr;
+                    continue;
+                }
+                node = (key < node->item_.first) ? node->left_ : node->right_;
+                current[i] = node;
+                if (node) {
+                    BST_PREFETCH(node);
+                    ++active;
+                } else {
+                    out[base + i] = iterator(nullptr);
+                }
+            }
+        }
+        if (!root_) {
+            for (size_t i = 0; i < group; ++i) {
+                out[base + i] = iterator(nullptr);
+            }
+        }
+    }
+}
+
+template<class Key, class Value>
+void BinarySearchTree<Key, Value>::find_batch(const std::vector<Key>& keys, std::vector<iterator>& out) const
+{
+    out.resize(keys.size());
+    if (!keys.empty()) {
+        find_batch(&keys[0], keys.size(), &out[0]);
+    }
+}
+
+/**
+* Calls fn on every item, in no particular order.
+*/
+template<class Key, class Value>
+template<typename Fn>
+void BinarySearchTree<Key, Value>::parallel_for_each(Fn fn, unsigned threads, size_t grain)
+{
+    unsigned t = workerCount(threads, static_cast<size_t>(-1));
+    int splitDepth = parallelSplitDepth(grain);
+    if (t == 1 || splitDepth == 0) {
+        visitInOrder(root_, fn);
+        return;
+    }
+    WorkStealingPool pool(t);
+    pool.run([&]() { forEachSubtree(&pool, root_, 0, splitDepth, fn); });
+}
+
+/**
+* Returns combine over map(item) for every item in key order, starting from
+* identity.
+*/
+template<class Key, class Value>
+template<typename T, typename Map, typename Combine>
+T BinarySearchTree<Key, Value>::parallel_reduce(const T& identity, Map map, Combine combine, unsigned threads, size_t grain) const
+{
+    unsigned t = workerCount(threads, static_cast<size_t>(-1));
+    int splitDepth = parallelSplitDepth(grain);
+    if (t == 1) {
+        return reduceSubtree<T>(nullptr, root_, 0, splitDepth, identity, map, combine);
+    }
+    T result = identity;
+    WorkStealingPool pool(t);
+    pool.run([&]() { result = reduceSubtree<T>(&pool, root_, 0, splitDepth, identity, map, combine); });
+    return result;
+}
+
+/**
+* Estimates the tree height from its left spine (exact for a complete tree
+* and within a factor of two for an AVL tree) and returns the depth at
+* which subtrees are expected to hold about grain nodes. A degenerate tree
+* with a short left spine is simply not split.
+*/
+template<class Key, class Value>
+int BinarySearchTree<Key, Value>::parallelSplitDepth(size_t grain) const
+{
+    int spine = 0;
+    for (Node<Key, Value>* node = root_; node != nullptr; node = node->left_) {
+        ++spine;
+    }
+    int grainLog = 0;
+    while ((static_cast<size_t>(1) << grainLog) < grain && grainLog < 63) {
+        ++grainLog;
+    }
+    return std::max(0, spine - grainLog);
+}
+
+template<class Key, class Value>
+void BinarySearchTree<Key, Value>::collectNodes(Node<Key, Value>* node, std::vector<Node<Key, Value>*>& out)
+{
+    std::vector<Node<Key, Value>*> stack;
+    while (node != nullptr || !stack.empty()) {
+        while (node != nullptr) {
+            stack.push_back(node);
+            node = node->left_;
+        }
+        node = stack.back();
+        stack.pop_back();
+        out.push_back(node);
+        node = node->right_;
+    }
+}
+
+/**
+* Frees the tombstones among nodes and closes up the gaps, keeping the
+* order. The caller relinks what is left.
+*/
+template<class Key, class Value>
+void BinarySearchTree<Key, Value>::dropTombstones(std::vector<Node<Key, Value>*>& nodes)
+{
+    size_t kept = 0;
+    for (size_t i = 0; i < nodes.size(); ++i) {
+        if (nodes[i]->isTombstone()) {
+            delete nodes[i];
+        } else {
+            nodes[kept++] = nodes[i];
+        }
+    }
+    nodes.resize(kept);
+}
+
+/**
+* Links nodes[0, count) into a tree with every level full except possibly
+* the last and returns its root; the root's parent is left for the caller.
+*/
+template<class Key, class Value>
+Node<Key, Value>* BinarySearchTree<Key, Value>::linkBalanced(Node<Key, Value>* const* nodes, size_t count)
+{
+    if (count == 0) {
+        return nullptr;
+    }
+    size_t mid = count / 2;
+    Node<Key, Value>* root = nodes[mid];
+    Node<Key, Value>* left = linkBalanced(nodes, mid);
+    Node<Key, Value>* right = linkBalanced(nodes + mid + 1, count - mid - 1);
+    root->setLeft(left);
+    root->setRight(right);
+    if (left) {
+        left->setParent(root);
+    }
+    if (right) {
+        right->setParent(root);
+    }
+    return root;
+}
+
+/**
+* Links the sorted nodes into a balanced tree that replaces the current one
+* and lets the tree type restore its invariants. The nodes must all be live.
+*/
+template<class Key, class Value>
+void BinarySearchTree<Key, Value>::rebuildFrom(const std::vector<Node<Key, Value>*>& nodes)
+{
+    root_ = linkBalanced(nodes.data(), nodes.size());
+    size_ = nodes.size();
+    maxSize_ = nodes.size();
+    tombstones_ = 0;
+    if (root_ != nullptr) {
+        root_->setParent(nullptr);
+        afterRebuild();
+    }
+}
+
+template<class Key, class Value>
+template<typename Visit>
+void BinarySearchTree<Key, Value>::visitInOrder(Node<Key, Value>* node, Visit& visit)
+{
+    std::vector<Node<Key, Value>*> stack;
+    while (node != nullptr || !stack.empty()) {
+        while (node != nullptr) {
+            stack.push_back(node);
+            node = node->left_;
+        }
+        node = stack.back();
+        stack.pop_back();
+        if (!node->isTombstone()) {
+            visit(node->item_);
+        }
+        node = node->right_;
+    }
+}
+
+/**
+* Above splitDepth the left subtree is spawned as a task while this thread
+* takes the right one; below it the subtree is walked in place.
+*/
+template<class Key, class Value>
+template<typename Fn>
+void BinarySearchTree<Key, Value>::forEachSubtree(WorkStealingPool* pool, Node<Key, Value>* node, int depth, int splitDepth, Fn& fn)
+{
+    if (node == nullptr) {
+        return;
+    }
+    if (depth >= splitDepth) {
+        visitInOrder(node, fn);
+        return;
+    }
+    WorkStealingPool::TaskGroup group;
+    Node<Key, Value>* left = node->left_;
+    pool->spawn(group, [=, &fn]() { forEachSubtree(pool, left, depth + 1, splitDepth, fn); });
+    if (!node->isTombstone()) {
+        fn(node->item_);
+    }
+    forEachSubtree(pool, node->right_, depth + 1, splitDepth, fn);
+    pool->wait(group);
+}
+
+/**
+* Same split as forEachSubtree. Results are combined as
+* (left, node, right) at split nodes and folded left to right below them,
+* whichever thread computed each part. A null pool runs everything inline.
+*/
+template<class Key, class Value>
+template<typename T, typename Map, typename Combine>
+T BinarySearchTree<Key, Value>::reduceSubtree(WorkStealingPool* pool, Node<Key, Value>* node, int depth, int splitDepth,
+                                              const T& identity, Map& map, Combine& combine)
+{
+    if (node == nullptr) {
+        return identity;
+    }
+    if (depth >= splitDepth) {
+        struct Fold {
+            Fold(const T& start, Map& m, Combine& c) : acc(start), map(m), combine(c) {}
+            void operator()(std::pair<const Key, Value>& item) { acc = combine(acc, map(item)); }
+            T acc;
+            Map& map;
+            Combine& combine;
+        } fold(identity, map, combine);
+        visitInOrder(node, fold);
+        return fold.acc;
+    }
+    T left = identity;
+    T right = identity;
+    Node<Key, Value>* leftChild = node->left_;
+    if (pool != nullptr) {
+        WorkStealingPool::TaskGroup group;
+        pool->spawn(group, [&]() { left = reduceSubtree<T>(pool, leftChild, depth + 1, splitDepth, identity, map, combine); });
+        right = reduceSubtree<T>(pool, node->right_, depth + 1, splitDepth, identity, map, combine);
+        pool->wait(group);
+    }
+    else {
+        left = reduceSubtree<T>(pool, leftChild, depth + 1, splitDepth, identity, map, combine);
+        right = reduceSubtree<T>(pool, node->right_, depth + 1, splitDepth, identity, map, combine);
+    }
+    if (node->isTombstone()) {
+        return combine(left, right);
+    }
+    return combine(combine(left, map(node->item_)), right);
+}
+
 /**
  * @precondition The key exists in the map
  * Returns the value associated with the key
@@ -465,11 +1115,28 @@ template<class Key, class Value>
 void BinarySearchTree<Key, Value>::insert(const std::pair<const Key, Value> &keyValuePair)
 { //Create the new node to be inserted
 	Node<Key, Value>* newNode = new Node<Key, Value>(keyValuePair.first, keyValuePair.second, nullptr);
-		if (!root_) {// Make it the root if the list is empty
-				root_ = newNode;
-		} else { // Start at the root and work down
-				Node<Key, Value>* currentNode = root_;
+	Node<Key, Value>* existing = BinarySearchTree<Key, Value>::linkNode(newNode);
+	if (existing) { // if its equal overwrite the value
+		existing->setValue(keyValuePair.second);
+		delete newNode;
+	}
+}
+
+/**
+* Links n in as a leaf, keeping the scapegoat depth bound if self-healing is
+* on. Returns the node that already holds n's key, leaving n untouched, or
+* NULL once n is in the tree.
+*/
+template<typename Key, typename Value>
+Node<Key, Value>* BinarySearchTree<Key, Value>::linkNode(Node<Key, Value>* newNode)
+{
+		int depth = 0; // edges between the root and the new node
+		if (!root_) {// Make it the root if the list is empty
+				root_ = newNode;
+		} else { // Start at the root and work down
+				Node<Key, Value>* currentNode = root_;
 				while (currentNode) {
+						++depth;
 						if (newNode->getItem().first < currentNode->getItem().first) {
 								if (!currentNode->getLeft()) {
 										currentNode->setLeft(newNode);
@@ -487,12 +1154,37 @@ void BinarySearchTree<Key, Value>::insert(const std::pair<const Key, Value> &key
 										currentNode = currentNode->getRight();
 								}
 						} else { // if its equal overwrite the value
-								currentNode->setValue(keyValuePair.second);
-								delete newNode;
-								break;
+								return currentNode;
 						}
 				}
 		}
+		if (!selfHealing_) {
+				return nullptr;
+		}
+		++size_;
+		if (size_ > maxSize_) {
+				maxSize_ = size_;
+		}
+		if (depth <= depthBound(size_)) {
+				return nullptr;
+		}
+		// Too deep: walk up to the first ancestor whose child holds more than
+		// 2/3 of its subtree (the scapegoat) and rebuild that subtree
+		Node<Key, Value>* child = newNode;
+		size_t childSize = 1;
+		while (child->getParent()) {
+				Node<Key, Value>* parent = child->getParent();
+				Node<Key, Value>* sibling = (parent->getLeft() == child) ? parent->getRight() : parent->getLeft();
+				size_t parentSize = childSize + 1 + subtreeSize(sibling);
+				if (3 * childSize > 2 * parentSize) {
+						rebuildSubtree(parent);
+						afterRebuild();
+						return nullptr;
+				}
+				child = parent;
+				childSize = parentSize;
+		}
+		return nullptr;
 }
 
 
@@ -506,61 +1198,81 @@ void BinarySearchTree<Key, Value>::remove(const Key& key)
 {
     Node<Key, Value>* nodeToRemove = internalFind(key);
     if (nodeToRemove) {
-        if (!nodeToRemove->getLeft() || !nodeToRemove->getRight()) {
-            Node<Key, Value>* child = nodeToRemove->getLeft() ? nodeToRemove->getLeft() : nodeToRemove->getRight();
-            if (child) {
-                child->setParent(nodeToRemove->getParent());
-            }
-            if (!nodeToRemove->getParent()) { // set child to root if the parent was the root
-                root_ = child;
-            } else {
-                if (nodeToRemove == nodeToRemove->getParent()->getLeft()) {
-                    nodeToRemove->getParent()->setLeft(child);
-                } else {
-                    nodeToRemove->getParent()->setRight(child);
-                }
-            }
-            delete nodeToRemove;
-        } else {
-            // Find the predecessor of the node to be removed
-            Node<Key, Value>* predecessorNode = nodeToRemove->getLeft();
-            while (predecessorNode->getRight()) {
-                predecessorNode = predecessorNode->getRight();
-            }
+        evictCached(key);
+        BinarySearchTree<Key, Value>::unlinkNode(nodeToRemove);
+        delete nodeToRemove;
+    }
+}
 
-            // Promote the predecessor
-            if (predecessorNode->getParent() == nodeToRemove) {
-                predecessorNode->setRight(nodeToRemove->getRight());
-                predecessorNode->getRight()->setParent(predecessorNode);
+/**
+* Unlinks n, promoting its predecessor if it has two children. The cache
+* entry for n's key must already be gone.
+*/
+template<typename Key, typename Value>
+void BinarySearchTree<Key, Value>::unlinkNode(Node<Key, Value>* nodeToRemove)
+{
+    if (!nodeToRemove->getLeft() || !nodeToRemove->getRight()) {
+        Node<Key, Value>* child = nodeToRemove->getLeft() ? nodeToRemove->getLeft() : nodeToRemove->getRight();
+        if (child) {
+            child->setParent(nodeToRemove->getParent());
+        }
+        if (!nodeToRemove->getParent()) { // set child to root if the parent was the root
+            root_ = child;
+        } else {
+            if (nodeToRemove == nodeToRemove->getParent()->getLeft()) {
+                nodeToRemove->getParent()->setLeft(child);
             } else {
-                predecessorNode->getParent()->setRight(predecessorNode->getLeft());
-                if (predecessorNode->getLeft()) {
-                    predecessorNode->getLeft()->setParent(predecessorNode->getParent());
-                }
-                predecessorNode->setLeft(nodeToRemove->getLeft());
-                predecessorNode->getLeft()->setParent(predecessorNode);
-                predecessorNode->setRight(nodeToRemove->getRight());
-                predecessorNode->getRight()->setParent(predecessorNode);
+                nodeToRemove->getParent()->setRight(child);
             }
+        }
+    } else {
+        // Find the predecessor of the node to be removed
+        Node<Key, Value>* predecessorNode = nodeToRemove->getLeft();
+        while (predecessorNode->getRight()) {
+            predecessorNode = predecessorNode->getRight();
+        }
 
-            // Update parent of the predecessor's original right child
-            if (nodeToRemove->getRight()) {
-                nodeToRemove->getRight()->setParent(predecessorNode);
+        // Promote the predecessor
+        if (predecessorNode->getParent() == nodeToRemove) {
+            predecessorNode->setRight(nodeToRemove->getRight());
+            predecessorNode->getRight()->setParent(predecessorNode);
+        } else {
+            predecessorNode->getParent()->setRight(predecessorNode->getLeft());
+            if (predecessorNode->getLeft()) {
+                predecessorNode->getLeft()->setParent(predecessorNode->getParent());
             }
+            predecessorNode->setLeft(nodeToRemove->getLeft());
+            predecessorNode->getLeft()->setParent(predecessorNode);
+            predecessorNode->setRight(nodeToRemove->getRight());
+            predecessorNode->getRight()->setParent(predecessorNode);
+        }
+
+        // Update parent of the predecessor's original right child
+        if (nodeToRemove->getRight()) {
+            nodeToRemove->getRight()->setParent(predecessorNode);
+        }
 
-            // Update parent of the predecessor's original parent
-            if (!nodeToRemove->getParent()) { // set predecessor to root if the parent was the root
-                root_ = predecessorNode;
+        // Update parent of the predecessor's original parent
+        if (!nodeToRemove->getParent()) { // set predecessor to root if the parent was the root
+            root_ = predecessorNode;
+        } else {
+            if (nodeToRemove == nodeToRemove->getParent()->getLeft()) {
+                nodeToRemove->getParent()->setLeft(predecessorNode);
             } else {
-                if (nodeToRemove == nodeToRemove->getParent()->getLeft()) {
-                    nodeToRemove->getParent()->setLeft(predecessorNode);
-                } else {
-                    nodeToRemove->getParent()->setRight(predecessorNode);
-                }
+                nodeToRemove->getParent()->setRight(predecessorNode);
             }
-            predecessorNode->setParent(nodeToRemove->getParent());
-
-            delete nodeToRemove;
+        }
+        predecessorNode->setParent(nodeToRemove->getParent());
+    }
+    if (selfHealing_) {
+        // Rebuild everything once the tree has shrunk well below its peak
+        --size_;
+        if (3 * size_ < 2 * maxSize_) {
+            if (root_) {
+                rebuildSubtree(root_);
+                afterRebuild();
+            }
+            maxSize_ = size_;
         }
     }
 }
@@ -601,6 +1313,272 @@ void BinarySearchTree<Key, Value>::clear()
 {
     clearHelper(root_);
     root_ = nullptr;
+    size_ = 0;
+    maxSize_ = 0;
+    tombstones_ = 0;
+    if (cache_) {
+        cache_->reset();
+    }
+}
+
+/**
+* Walks src and the copy in lockstep without recursion: go down into the
+* first child that is not copied yet, otherwise climb back up both trees.
+* cloneNode is called on the tree that owns src, so it makes the right kind
+* of node even while a derived copy is still under construction.
+*/
+template<typename Key, typename Value>
+Node<Key, Value>* BinarySearchTree<Key, Value>::cloneTree(const Node<Key, Value>* src) const
+{
+    if (src == nullptr) {
+        return nullptr;
+    }
+    Node<Key, Value>* copy = cloneNode(src, nullptr);
+    const Node<Key, Value>* s = src;
+    Node<Key, Value>* d = copy;
+    while (true) {
+        if (s->getLeft() != nullptr && d->getLeft() == nullptr) {
+            d->setLeft(cloneNode(s->getLeft(), d));
+            s = s->getLeft();
+            d = d->getLeft();
+        }
+        else if (s->getRight() != nullptr && d->getRight() == nullptr) {
+            d->setRight(cloneNode(s->getRight(), d));
+            s = s->getRight();
+            d = d->getRight();
+        }
+        else if (s == src) {
+            break;
+        }
+        else {
+            s = s->getParent();
+            d = d->getParent();
+        }
+    }
+    return copy;
+}
+
+template<typename Key, typename Value>
+Node<Key, Value>* BinarySearchTree<Key, Value>::cloneNode(const Node<Key, Value>* src, Node<Key, Value>* parent) const
+{
+    return new Node<Key, Value>(src->getKey(), src->getValue(), parent);
+}
+
+/**
+* Flattens both trees into sorted arrays of nodes, merges them in one pass
+* and links the result into a balanced tree, after which afterRebuild() lets
+* each tree type restore its own invariants. Working from arrays rather than
+* linked vines keeps the merge and the build from chasing one pointer at a
+* time. A key present in both keeps this tree's node and gets its value from
+* mergeValue(). Tombstones in either tree are dropped.
+*
+* Each derived tree declares its own merge() taking only its own type, so
+* merging an RBTree into an AVLTree does not compile. Through a
+* BinarySearchTree reference the types are checked here instead, and
+* std::invalid_argument is thrown before anything moves.
+*/
+template<typename Key, typename Value>
+void BinarySearchTree<Key, Value>::merge(BinarySearchTree<Key, Value>& other)
+{
+    mergeFrom(other);
+}
+
+template<typename Key, typename Value>
+void BinarySearchTree<Key, Value>::mergeFrom(BinarySearchTree<Key, Value>& other)
+{
+    if (typeid(*this) != typeid(other)) {
+        throw std::invalid_argument("merge: trees of different types");
+    }
+    if (&other == this || other.root_ == nullptr) {
+        return;
+    }
+    std::vector<Node<Key, Value>*> mine;
+    std::vector<Node<Key, Value>*> theirs;
+    collectNodes(root_, mine);
+    collectNodes(other.root_, theirs);
+    if (tombstones_ != 0) {
+        dropTombstones(mine);
+    }
+    if (other.tombstones_ != 0) {
+        dropTombstones(theirs);
+    }
+    other.root_ = nullptr;
+    other.clear();
+
+    std::vector<Node<Key, Value>*> merged;
+    merged.reserve(mine.size() + theirs.size());
+    size_t i = 0;
+    size_t j = 0;
+    while (i < mine.size() || j < theirs.size()) {
+        if (j == theirs.size() || (i < mine.size() && mine[i]->getKey() < theirs[j]->getKey())) {
+            merged.push_back(mine[i++]);
+        }
+        else if (i == mine.size() || theirs[j]->getKey() < mine[i]->getKey()) {
+            merged.push_back(theirs[j++]);
+        }
+        else {
+            mergeValue(mine[i], theirs[j]);
+            delete theirs[j++];
+        }
+    }
+    rebuildFrom(merged);
+}
+
+/**
+* Returns the node holding key. Otherwise returns NULL and sets parent to
+* the node a new leaf for key would hang from (NULL for an empty tree).
+*/
+template<typename Key, typename Value>
+Node<Key, Value>* BinarySearchTree<Key, Value>::findSlot(const Key& key, Node<Key, Value>*& parent) const
+{
+    parent = nullptr;
+    Node<Key, Value>* current = root_;
+    while (current != nullptr) {
+        if (key < current->getKey()) {
+            parent = current;
+            current = current->left_;
+        } else if (current->getKey() < key) {
+            parent = current;
+            current = current->right_;
+        } else {
+            return current;
+        }
+    }
+    return nullptr;
+}
+
+template<typename Key, typename Value>
+typename BinarySearchTree<Key, Value>::node_type BinarySearchTree<Key, Value>::extract(const Key& key)
+{
+    return extract(iterator(internalFind(key)));
+}
+
+/**
+* Unlinks the node at pos, with the same rebalancing a remove would do, and
+* hands it over with its links cleared.
+*/
+template<typename Key, typename Value>
+typename BinarySearchTree<Key, Value>::node_type BinarySearchTree<Key, Value>::extract(iterator pos)
+{
+    Node<Key, Value>* n = pos.current_;
+    if (n == nullptr) {
+        return node_type();
+    }
+    evictCached(n->getKey());
+    unlinkNode(n);
+    n->setParent(nullptr);
+    n->setLeft(nullptr);
+    n->setRight(nullptr);
+    return node_type(n, typeid(*this));
+}
+
+/**
+* Relinks the handle's node itself, so neither the key nor the value is
+* copied and nothing is allocated. Derived trees link their own node type,
+* so a handle extracted from a tree of another type throws
+* std::invalid_argument and keeps its node.
+*/
+template<typename Key, typename Value>
+std::pair<typename BinarySearchTree<Key, Value>::iterator, bool>
+BinarySearchTree<Key, Value>::insert(node_type&& handle)
+{
+    Node<Key, Value>* n = handle.node_;
+    if (n == nullptr) {
+        return std::make_pair(end(), false);
+    }
+    if (*handle.source_ != typeid(*this)) {
+        throw std::invalid_argument("insert: node from a tree of a different type");
+    }
+    Node<Key, Value>* existing = linkNode(n);
+    if (existing != nullptr) {
+        return std::make_pair(iterator(existing), false);
+    }
+    handle.node_ = nullptr;
+    return std::make_pair(iterator(n), true);
+}
+
+template<typename Key, typename Value>
+typename BinarySearchTree<Key, Value>::iterator BinarySearchTree<Key, Value>::erase(iterator pos)
+{
+    Node<Key, Value>* n = pos.current_;
+    if (n == nullptr) {
+        return end();
+    }
+    ++pos;
+    evictCached(n->getKey());
+    unlinkNode(n);
+    delete n;
+    return pos;
+}
+
+/**
+* Sweeps the range in key order, unlinking each node where the iterator
+* already is. Nodes are only ever relinked, so last survives. Rebuilding
+* from the survivors instead would have to visit every one of them, which
+* measured slower even when the range is most of the tree.
+*/
+template<typename Key, typename Value>
+typename BinarySearchTree<Key, Value>::iterator BinarySearchTree<Key, Value>::erase(iterator first, iterator last)
+{
+    while (first != last) {
+        first = erase(first);
+    }
+    return last;
+}
+
+/**
+* Erases one node at a time while most of the tree survives. Once pred has
+* matched more than half of the items, the survivors are compacted into a
+* sorted array and the tree is rebuilt from it in a single pass instead,
+* which also drops any tombstones. pred never sees a tombstone.
+*/
+template<typename Key, typename Value>
+template<typename Pred>
+size_t BinarySearchTree<Key, Value>::erase_if(Pred pred)
+{
+    std::vector<Node<Key, Value>*> all;
+    collectNodes(root_, all);
+    std::vector<Node<Key, Value>*> doomed;
+    size_t kept = 0;
+    for (size_t i = 0; i < all.size(); ++i) {
+        if (all[i]->isTombstone()) {
+            all[kept++] = all[i];
+        }
+        else if (pred(static_cast<const std::pair<const Key, Value>&>(all[i]->getItem()))) {
+            doomed.push_back(all[i]);
+        } else {
+            all[kept++] = all[i];
+        }
+    }
+    if (doomed.size() <= kept) {
+        for (size_t i = 0; i < doomed.size(); ++i) {
+            evictCached(doomed[i]->getKey());
+            unlinkNode(doomed[i]);
+            delete doomed[i];
+        }
+        return doomed.size();
+    }
+    for (size_t i = 0; i < doomed.size(); ++i) {
+        delete doomed[i];
+    }
+    if (cache_) {
+        cache_->reset();
+    }
+    all.resize(kept);
+    if (tombstones_ != 0) {
+        dropTombstones(all);
+    }
+    rebuildFrom(all);
+    return doomed.size();
+}
+
+/**
+* Same as inserting other's item over ours: their value wins.
+*/
+template<typename Key, typename Value>
+void BinarySearchTree<Key, Value>::mergeValue(Node<Key, Value>* mine, Node<Key, Value>* theirs)
+{
+    mine->setValue(theirs->getValue());
 }
 
 // Use recursion to inorder delete each element
@@ -634,15 +1612,27 @@ BinarySearchTree<Key, Value>::getSmallestNode() const
 /**
 * Helper function to find a node with given key, k and
 * return a pointer to it or NULL if no item with that key
-* exists
+* exists. A tombstone is never returned or cached.
 */
 template<typename Key, typename Value>
 Node<Key, Value>* BinarySearchTree<Key, Value>::internalFind(const Key& key) const
 {
+    if (cache_) {
+        Node<Key, Value>* cached = cache_->lookup(key);
+        if (cached) {
+            return cached;
+        }
+    }
     Node<Key, Value> *current = root_;
 		// Iterate from top down checking to see if current has the correct key
     while (current != nullptr) {
         if (key == current->getKey()) {
+            if (current->isTombstone()) {
+                return nullptr;
+            }
+            if (cache_) {
+                cache_->store(current);
+            }
             return current;
         } else if (key < current->getKey()) {
             current = current->getLeft();
@@ -653,6 +1643,153 @@ Node<Key, Value>* BinarySearchTree<Key, Value>::internalFind(const Key& key) con
     return nullptr;
 }
 
+/**
+* Turns self-healing on or off. While it is on, BinarySearchTree::insert keeps
+* every node within depthBound() of the root by rebuilding the subtree of a
+* scapegoat ancestor, and remove rebuilds the whole tree once it has lost a
+* third of its peak size. This gives amortized O(log n) updates without any
+* per-node bookkeeping. Derived trees that override insert/remove never
+* trigger those rebuilds, but turning it on reshapes the whole tree, so
+* afterRebuild() runs to restore their balances, colors or heap order.
+*/
+template<typename Key, typename Value>
+void BinarySearchTree<Key, Value>::setSelfHealing(bool enabled)
+{
+    selfHealing_ = enabled;
+    if (!enabled) {
+        return;
+    }
+    // The recursive counting below is safe once the tree has been rebuilt
+    size_t count = 0;
+    if (root_) {
+        Node<Key, Value>* head = treeToVine(root_, count);
+        root_ = vineToTree(head, count);
+        root_->setParent(nullptr);
+        afterRebuild();
+    }
+    size_ = count;
+    maxSize_ = count;
+}
+
+/**
+* Puts a direct-mapped cache with the given number of slots (rounded up to a
+* power of two) in front of internalFind, replacing any existing cache.
+* Const lookups stay safe to run concurrently with each other; anything that
+* modifies the tree, including this call, still needs exclusive access.
+*/
+template<typename Key, typename Value>
+template<typename Hash>
+void BinarySearchTree<Key, Value>::enableLookupCache(size_t slots)
+{
+    delete cache_;
+    cache_ = new LookupCache<Key, Value, Hash>(slots);
+}
+
+template<typename Key, typename Value>
+void BinarySearchTree<Key, Value>::disableLookupCache()
+{
+    delete cache_;
+    cache_ = nullptr;
+}
+
+template<typename Key, typename Value>
+size_t BinarySearchTree<Key, Value>::lookupCacheHits() const
+{
+    return cache_ ? cache_->hits() : 0;
+}
+
+template<typename Key, typename Value>
+size_t BinarySearchTree<Key, Value>::lookupCacheMisses() const
+{
+    return cache_ ? cache_->misses() : 0;
+}
+
+template<typename Key, typename Value>
+typename BinarySearchTree<Key, Value>::iterator BinarySearchTree<Key, Value>::iteratorAt(Node<Key, Value>* node)
+{
+    return iterator(node);
+}
+
+template<typename Key, typename Value>
+void BinarySearchTree<Key, Value>::evictCached(const Key& key)
+{
+    if (cache_) {
+        cache_->evict(key);
+    }
+}
+
+/**
+* Number of threads to use: the requested count (or the hardware count when
+* 0), but never more than one per item of work.
+*/
+template<class Key, class Value>
+unsigned BinarySearchTree<Key, Value>::workerCount(unsigned threads, size_t work)
+{
+    if (threads == 0) {
+        threads = std::thread::hardware_concurrency();
+    }
+    if (threads == 0) {
+        threads = 1;
+    }
+    if (work < threads) {
+        threads = work == 0 ? 1 : static_cast<unsigned>(work);
+    }
+    return threads;
+}
+
+/**
+* Stable sorts items by key (chunks in parallel, then pairwise merges) and
+* keeps only the last occurrence of each key, matching repeated insert calls.
+*/
+template<class Key, class Value>
+void BinarySearchTree<Key, Value>::sortAndDedupe(std::vector<std::pair<Key, Value> >& items, unsigned threads)
+{
+    typedef std::pair<Key, Value> Item;
+    struct KeyLess {
+        bool operator()(const Item& a, const Item& b) const { return a.first < b.first; }
+    };
+    size_t n = items.size();
+    std::vector<size_t> bounds;
+    for (unsigned i = 0; i <= threads; ++i) {
+        bounds.push_back(n * i / threads);
+    }
+    std::vector<std::thread> workers;
+    for (unsigned i = 0; i < threads; ++i) {
+        workers.push_back(std::thread([&, i]() {
+            std::stable_sort(items.begin() + bounds[i], items.begin() + bounds[i + 1], KeyLess());
+        }));
+    }
+    for (size_t i = 0; i < workers.size(); ++i) {
+        workers[i].join();
+    }
+    // Merge neighbouring runs; chunks stay in input order so stability holds
+    for (size_t width = 1; width < threads; width *= 2) {
+        workers.clear();
+        for (size_t i = 0; i + width < threads; i += 2 * width) {
+            size_t lo = bounds[i];
+            size_t mid = bounds[i + width];
+            size_t hi = bounds[std::min<size_t>(i + 2 * width, threads)];
+            workers.push_back(std::thread([&items, lo, mid, hi]() {
+                std::inplace_merge(items.begin() + lo, items.begin() + mid, items.begin() + hi, KeyLess());
+            }));
+        }
+        for (size_t i = 0; i < workers.size(); ++i) {
+            workers[i].join();
+        }
+    }
+    size_t out = 0;
+    for (size_t i = 0; i < n; ++i) {
+        if (i + 1 < n && !(items[i].first < items[i + 1].first)) {
+            continue; // a later item has the same key
+        }
+        if (out != i) {
+            items[out] = items[i];
+        }
+        ++out;
+    }
+    items.resize(out);
+}
+
 /**
  * Return true iff the BST is balanced.
  */
@@ -702,6 +1839,169 @@ int BinarySearchTree<Key, Value>::height(Node<Key, Value>* node) const {
 
 
 
+template<typename Key, typename Value>
+size_t BinarySearchTree<Key, Value>::subtreeSize(Node<Key, Value>* node) const {
+    if (!node) {
+        return 0;
+    }
+    return 1 + subtreeSize(node->getLeft()) + subtreeSize(node->getRight());
+}
+
+/**
+* Rebuilds the subtree rooted at node into a balanced one in linear time.
+* The existing nodes are relinked; nothing is allocated or copied.
+*/
+template<typename Key, typename Value>
+void BinarySearchTree<Key, Value>::rebuildSubtree(Node<Key, Value>* node) {
+    Node<Key, Value>* parent = node->getParent();
+    bool isLeft = parent && parent->getLeft() == node;
+    size_t count = 0;
+    Node<Key, Value>* head = treeToVine(node, count);
+    Node<Key, Value>* rebuilt = vineToTree(head, count);
+    rebuilt->setParent(parent);
+    if (!parent) {
+        root_ = rebuilt;
+    } else if (isLeft) {
+        parent->setLeft(rebuilt);
+    } else {
+        parent->setRight(rebuilt);
+    }
+}
+
+/**
+* Flattens the subtree at node into a list in key order linked through the
+* right pointers, using right rotations so no stack is needed. Returns the
+* head of the list and stores its length in count. Each list node's parent is
+* its list predecessor; the head keeps its old parent.
+*/
+template<typename Key, typename Value>
+Node<Key, Value>* BinarySearchTree<Key, Value>::treeToVine(Node<Key, Value>* node, size_t& count) {
+    Node<Key, Value>* head = nullptr;
+    Node<Key, Value>* tail = nullptr;
+    count = 0;
+    while (node) {
+        if (node->getLeft()) { // rotate the left child up
+            Node<Key, Value>* left = node->getLeft();
+            node->setLeft(left->getRight());
+            left->setRight(node);
+            node = left;
+        } else {
+            if (tail) {
+                tail->setRight(node);
+                node->setParent(tail);
+            } else {
+                head = node;
+            }
+            tail = node;
+            ++count;
+            node = node->getRight();
+        }
+    }
+    return head;
+}
+
+/**
+* Consumes the first count nodes of the list at head and links them into a
+* balanced tree whose root is returned (its parent is left for the caller).
+* head is advanced past the consumed nodes.
+*/
+template<typename Key, typename Value>
+Node<Key, Value>* BinarySearchTree<Key, Value>::vineToTree(Node<Key, Value>*& head, size_t count) {
+    if (count == 0) {
+        return nullptr;
+    }
+    size_t leftCount = count / 2;
+    Node<Key, Value>* left = vineToTree(head, leftCount);
+    Node<Key, Value>* root = head;
+    head = head->getRight();
+    root->setLeft(left);
+    if (left) {
+        left->setParent(root);
+    }
+    Node<Key, Value>* right = vineToTree(head, count - leftCount - 1);
+    root->setRight(right);
+    if (right) {
+        right->setParent(root);
+    }
+    return root;
+}
+
+/**
+* Left-rotates every other node of the first 2 * count nodes of the vine at
+* head over its right neighbour, halving that stretch of the spine. Every
+* link written also gets its parent pointer fixed.
+*/
+template<typename Key, typename Value>
+void BinarySearchTree<Key, Value>::compressVine(Node<Key, Value>*& head, size_t count) {
+    Node<Key, Value>* scanner = nullptr;
+    for (size_t i = 0; i < count; ++i) {
+        Node<Key, Value>* child = scanner ? scanner->getRight() : head;
+        Node<Key, Value>* next = child->getRight();
+        if (scanner) {
+            scanner->setRight(next);
+            next->setParent(scanner);
+        } else {
+            head = next;
+        }
+        scanner = next;
+        child->setRight(scanner->getLeft());
+        if (child->getRight()) {
+            child->getRight()->setParent(child);
+        }
+        scanner->setLeft(child);
+        child->setParent(scanner);
+    }
+}
+
+/**
+* Day-Stout-Warren global rebalance: rotate the tree into a sorted vine, then
+* fold the vine back up into a complete tree (every level full except
+* possibly the last) with O(log n) rotation passes. Runs in O(n) time and
+* O(1) extra space. Nodes are relinked, never allocated, copied or freed,
+* so iterators stay valid.
+*/
+template<typename Key, typename Value>
+void BinarySearchTree<Key, Value>::rebalance() {
+    if (!root_) {
+        return;
+    }
+    size_t count = 0;
+    Node<Key, Value>* head = treeToVine(root_, count);
+    // Largest 2^k - 1 that fits; the rest become the partial bottom level
+    size_t full = 1;
+    while (full * 2 + 1 <= count) {
+        full = full * 2 + 1;
+    }
+    compressVine(head, count - full);
+    while (full > 1) {
+        full /= 2;
+        compressVine(head, full);
+    }
+    root_ = head;
+    root_->setParent(nullptr);
+    afterRebuild();
+}
+
+template<typename Key, typename Value>
+void BinarySearchTree<Key, Value>::afterRebuild() {
+}
+
+template<typename Key, typename Value>
+void BinarySearchTree<Key, Value>::setRoot(Node<Key, Value>* root) {
+    __atomic_store_n(&root_, root, __ATOMIC_RELEASE);
+}
+
+/**
+* floor(log_{3/2}(size)), the scapegoat depth limit for alpha = 2/3.
+*/
+template<typename Key, typename Value>
+int BinarySearchTree<Key, Value>::depthBound(size_t size) {
+    if (size < 2) {
+        return 0;
+    }
+    return static_cast<int>(std::log(static_cast<double>(size)) / std::log(1.5));
+}
+
 template<typename Key, typename Value>
 void BinarySearchTree<Key, Value>::nodeSwap( Node<Key,Value>* n1, Node<Key,Value>* n2)
 {
@@ -778,10 +2078,10 @@ void BinarySearchTree<Key, Value>::nodeSwap( Node<Key,Value>* n1, Node<Key,Value
 
 
     if(this->root_ == n1) {
-        this->root_ = n2;
+        setRoot(n2);
     }
     else if(this->root_ == n2) {
-        this->root_ = n1;
+        setRoot(n1);
     }
 
 }
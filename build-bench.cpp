@@ -0,0 +1,49 @@
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <thread>
+#include "avlbst.h"
+#include "bench-util.h"
+
+using namespace std;
+
+// Usage: build-bench [num_items] [max_threads]
+// Keys are drawn uniformly with replacement, so about a third of the items
+// are duplicates that the build has to resolve.
+
+int main(int argc, char *argv[])
+{
+    int n = (int) benchArg(argc, argv, 1, 10000000);
+    unsigned maxThreads = (unsigned) benchArg(argc, argv, 2, 8);
+
+    vector<int> keys = makeUniformTrace(n, n, 1);
+    vector<std::pair<int, int> > items(n);
+    for (int i = 0; i < n; ++i) {
+        items[i] = std::make_pair(keys[i], i);
+    }
+    keys.clear();
+
+    cout << n << " unsorted items, " << std::thread::hardware_concurrency() << " hardware threads" << endl;
+    cout << fixed << setprecision(1);
+    cout << "method               time(ms)" << endl;
+
+    long checksum = 0;
+    {
+        AVLTree<int, int> tree;
+        BenchTimer timer;
+        for (int i = 0; i < n; ++i) {
+            tree.insert(items[i]);
+        }
+        cout << "insert loop          " << setw(8) << timer.elapsedMs() << endl;
+        checksum += tree.begin()->second;
+    }
+    for (unsigned t = 1; t <= maxThreads; t *= 2) {
+        AVLTree<int, int> tree;
+        BenchTimer timer;
+        tree.build_parallel(items.begin(), items.end(), t);
+        cout << "build_parallel(" << setw(2) << t << ")   " << setw(8) << timer.elapsedMs() << endl;
+        checksum += tree.begin()->second;
+    }
+    cout << "(checksum " << checksum << ")" << endl;
+    return 0;
+}
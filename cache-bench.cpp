@@ -0,0 +1,48 @@
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include "avlbst.h"
+#include "bench-util.h"
+
+using namespace std;
+
+// Usage: cache-bench [num_keys] [num_lookups]
+
+int main(int argc, char *argv[])
+{
+    int n = (int) benchArg(argc, argv, 1, 1000000);
+    size_t lookups = (size_t) benchArg(argc, argv, 2, 5000000);
+
+    vector<int> keys = makeShuffledKeys(n, 1);
+    vector<int> trace = makeZipfTrace(n, lookups, 0.99, 2);
+
+    AVLTree<int, int> tree;
+    for (size_t i = 0; i < keys.size(); ++i) {
+        tree.insert(std::make_pair(keys[i], keys[i]));
+    }
+
+    cout << n << " keys, " << lookups << " Zipf(0.99) lookups" << endl;
+    cout << fixed << setprecision(1);
+    cout << "cache slots   time(ms)  hit rate(%)" << endl;
+
+    size_t sizes[] = { 0, 1024, 4096, 16384, 65536 };
+    long checksum = 0;
+    for (size_t s = 0; s < sizeof(sizes) / sizeof(sizes[0]); ++s) {
+        if (sizes[s] == 0) {
+            tree.disableLookupCache();
+        } else {
+            tree.enableLookupCache(sizes[s]);
+        }
+        BenchTimer timer;
+        for (size_t i = 0; i < trace.size(); ++i) {
+            checksum += tree[trace[i]];
+        }
+        double ms = timer.elapsedMs();
+        size_t hits = tree.lookupCacheHits();
+        size_t total = hits + tree.lookupCacheMisses();
+        double rate = total == 0 ? 0.0 : 100.0 * hits / total;
+        cout << setw(11) << sizes[s] << "  " << setw(9) << ms << "  " << setw(11) << rate << endl;
+    }
+    cout << "(checksum " << checksum << ")" << endl;
+    return 0;
+}
@@ -0,0 +1,59 @@
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <stdint.h>
+#include "avlbst.h"
+#include "compactavlbst.h"
+#include "bench-util.h"
+
+using namespace std;
+
+// Usage: compact-bench [num_keys] [num_lookups]
+
+template<typename Tree>
+void timeTree(const char* name, Tree& tree, const vector<int>& keys, const vector<int>& trace)
+{
+    BenchTimer timer;
+    for (size_t i = 0; i < keys.size(); ++i) {
+        tree.insert(std::make_pair((uint64_t) keys[i], (uint64_t) i));
+    }
+    double insertMs = timer.elapsedMs();
+    uint64_t checksum = 0;
+    timer.reset();
+    for (size_t i = 0; i < trace.size(); ++i) {
+        checksum += tree.find((uint64_t) trace[i])->second;
+    }
+    double findMs = timer.elapsedMs();
+    cout << name << setw(11) << insertMs << "  " << setw(9) << findMs
+         << "   (checksum " << checksum << ")" << endl;
+}
+
+int main(int argc, char *argv[])
+{
+    int n = (int) benchArg(argc, argv, 1, 2000000);
+    size_t lookups = (size_t) benchArg(argc, argv, 2, 2000000);
+
+    vector<int> keys = makeShuffledKeys(n, 1);
+    vector<int> trace = makeUniformTrace(n, lookups, 2);
+
+    cout << n << " uint64_t -> uint64_t entries" << endl;
+    cout << fixed << setprecision(1);
+    cout << "tree              insert(ms)  find(ms)" << endl;
+    double compactBytes;
+    {
+        CompactAVLTree<uint64_t, uint64_t> compact;
+        timeTree("CompactAVLTree  ", compact, keys, trace);
+        compactBytes = compact.bytesPerEntry();
+    }
+    {
+        AVLTree<uint64_t, uint64_t> avl;
+        timeTree("AVLTree         ", avl, keys, trace);
+    }
+
+    cout << "bytes per entry:" << endl;
+    cout << "  payload                 " << 2 * sizeof(uint64_t) << endl;
+    cout << "  AVLTree node (sizeof)   " << sizeof(AVLNode<uint64_t, uint64_t>)
+         << " + allocator header per node" << endl;
+    cout << "  CompactAVLTree (total)  " << setprecision(2) << compactBytes << endl;
+    return 0;
+}
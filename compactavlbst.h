@@ -0,0 +1,715 @@
+#ifndef COMPACTAVLBST_H
+#define COMPACTAVLBST_H
+
+#include <iostream>
+#include <exception>
+#include <stdexcept>
+#include <cstdlib>
+#include <cstdint>
+#include <new>
+#include <vector>
+#include <algorithm>
+
+/**
+* A memory-lean AVL tree with the same interface as BinarySearchTree.
+*
+* Nodes are not individually heap allocated. They live in an arena of
+* fixed-size blocks and refer to each other by 32-bit index instead of by
+* pointer, and there are no virtual functions, so a node is just the item plus
+* 12 bytes of links. The AVL balance (-1, 0 or +1) is stored in the top two bits
+* of the parent index, which limits a tree to 2^30 - 1 entries.
+*
+* Blocks are never moved or freed while the tree is alive, so a node keeps
+* its address and iterators stay valid across inserts of other keys.
+*/
+template <typename Key, typename Value>
+class CompactAVLTree
+{
+public:
+    CompactAVLTree();
+    ~CompactAVLTree();
+
+    void insert(const std::pair<const Key, Value>& keyValuePair);
+    void remove(const Key& key);
+    void clear();
+    bool isBalanced() const;
+    void print() const;
+    bool empty() const;
+    size_t size() const;
+    double bytesPerEntry() const; // Arena and bookkeeping bytes divided by the number of entries
+
+    /**
+    * An internal iterator class for traversing the contents of the tree.
+    */
+    class iterator
+    {
+    public:
+        iterator();
+
+        std::pair<const Key,Value>& operator*() const;
+        std::pair<const Key,Value>* operator->() const;
+
+        bool operator==(const iterator& rhs) const;
+        bool operator!=(const iterator& rhs) const;
+
+        iterator& operator++();
+
+    protected:
+        friend class CompactAVLTree<Key, Value>;
+        iterator(const CompactAVLTree<Key, Value>* tree, uint32_t index);
+        const CompactAVLTree<Key, Value>* tree_;
+        uint32_t index_;
+    };
+
+    iterator begin() const;
+    iterator end() const;
+    iterator find(const Key& key) const;
+    Value& operator[](const Key& key);
+    Value const & operator[](const Key& key) const;
+
+protected:
+    static const uint32_t NIL = 0x3FFFFFFFu;      // "no node"; also the largest usable index + 1
+    static const uint32_t kParentMask = 0x3FFFFFFFu;
+    static const int kBlockBits = 12;             // 4096 nodes per arena block
+    static const uint32_t kBlockSize = 1u << kBlockBits;
+
+    struct Slot {
+        Slot(const std::pair<const Key, Value>& kv, uint32_t parent) :
+            item(kv), left(NIL), right(NIL), parentAndBalance(parent | (1u << 30)) {}
+        std::pair<const Key, Value> item;
+        uint32_t left;
+        uint32_t right;
+        uint32_t parentAndBalance; // low 30 bits parent index, high 2 bits balance + 1
+    };
+
+    Slot& slot(uint32_t i) const;
+    uint32_t parent(uint32_t i) const;
+    void setParent(uint32_t i, uint32_t p);
+    int balance(uint32_t i) const;
+    void setBalance(uint32_t i, int b);
+    uint32_t allocate(const std::pair<const Key, Value>& kv, uint32_t parent);
+    void release(uint32_t i);
+    uint32_t internalFind(const Key& key) const;
+    void replaceChild(uint32_t p, uint32_t oldChild, uint32_t newChild); // Also updates root_
+    uint32_t rotateLeft(uint32_t x);
+    uint32_t rotateRight(uint32_t x);
+    uint32_t rotateRightLeft(uint32_t x);
+    uint32_t rotateLeftRight(uint32_t x);
+    int height(uint32_t i) const;
+    bool isBalancedHelper(uint32_t i) const;
+
+    CompactAVLTree(const CompactAVLTree&);            // not copyable
+    CompactAVLTree& operator=(const CompactAVLTree&);
+
+    std::vector<Slot*> blocks_;
+    std::vector<uint32_t> free_; // released slots, reused before growing
+    uint32_t used_;              // slots handed out so far (live or free)
+    uint32_t root_;
+    size_t size_;
+};
+
+/*
+-----------------------------------------------------------
+Begin implementations for the CompactAVLTree::iterator class.
+-----------------------------------------------------------
+*/
+
+template<class Key, class Value>
+CompactAVLTree<Key, Value>::iterator::iterator() : tree_(nullptr), index_(NIL)
+{
+}
+
+template<class Key, class Value>
+CompactAVLTree<Key, Value>::iterator::iterator(const CompactAVLTree<Key, Value>* tree, uint32_t index) :
+    tree_(tree), index_(index)
+{
+}
+
+template<class Key, class Value>
+std::pair<const Key,Value> &
+CompactAVLTree<Key, Value>::iterator::operator*() const
+{
+    return tree_->slot(index_).item;
+}
+
+template<class Key, class Value>
+std::pair<const Key,Value> *
+CompactAVLTree<Key, Value>::iterator::operator->() const
+{
+    return &(tree_->slot(index_).item);
+}
+
+template<class Key, class Value>
+bool CompactAVLTree<Key, Value>::iterator::operator==(const iterator& rhs) const
+{
+    return index_ == rhs.index_;
+}
+
+template<class Key, class Value>
+bool CompactAVLTree<Key, Value>::iterator::operator!=(const iterator& rhs) const
+{
+    return !(*this == rhs);
+}
+
+/**
+* Advances to the in-order successor by following the index links.
+*/
+template<class Key, class Value>
+typename CompactAVLTree<Key, Value>::iterator&
+CompactAVLTree<Key, Value>::iterator::operator++()
+{
+    uint32_t right = tree_->slot(index_).right;
+    if (right != NIL) {
+        index_ = right;
+        while (tree_->slot(index_).left != NIL) {
+            index_ = tree_->slot(index_).left;
+        }
+    } else {
+        uint32_t p = tree_->parent(index_);
+        while (p != NIL && tree_->slot(p).right == index_) {
+            index_ = p;
+            p = tree_->parent(index_);
+        }
+        index_ = p;
+    }
+    return *this;
+}
+
+/*
+---------------------------------------------------------
+End implementations for the CompactAVLTree::iterator class.
+---------------------------------------------------------
+*/
+
+/*
+--------------------------------------------------
+Begin implementations for the CompactAVLTree class.
+--------------------------------------------------
+*/
+
+template<class Key, class Value>
+CompactAVLTree<Key, Value>::CompactAVLTree() : used_(0), root_(NIL), size_(0)
+{
+}
+
+template<class Key, class Value>
+CompactAVLTree<Key, Value>::~CompactAVLTree()
+{
+    clear();
+}
+
+/**
+* Destroys every live item and returns all arena blocks.
+*/
+template<class Key, class Value>
+void CompactAVLTree<Key, Value>::clear()
+{
+    // Walk the tree instead of the arena so freed slots are not destroyed twice
+    if (root_ != NIL) {
+        std::vector<uint32_t> stack(1, root_);
+        while (!stack.empty()) {
+            uint32_t i = stack.back();
+            stack.pop_back();
+            if (slot(i).left != NIL) {
+                stack.push_back(slot(i).left);
+            }
+            if (slot(i).right != NIL) {
+                stack.push_back(slot(i).right);
+            }
+            slot(i).~Slot();
+        }
+    }
+    for (size_t b = 0; b < blocks_.size(); ++b) {
+        ::operator delete(blocks_[b]);
+    }
+    blocks_.clear();
+    free_.clear();
+    used_ = 0;
+    root_ = NIL;
+    size_ = 0;
+}
+
+template<class Key, class Value>
+bool CompactAVLTree<Key, Value>::empty() const
+{
+    return root_ == NIL;
+}
+
+template<class Key, class Value>
+size_t CompactAVLTree<Key, Value>::size() const
+{
+    return size_;
+}
+
+/**
+* Everything the tree holds on to, per live entry: the arena blocks, the
+* block table, the free list and the tree object itself.
+*/
+template<class Key, class Value>
+double CompactAVLTree<Key, Value>::bytesPerEntry() const
+{
+    if (size_ == 0) {
+        return 0.0;
+    }
+    double bytes = static_cast<double>(blocks_.size()) * kBlockSize * sizeof(Slot)
+        + blocks_.capacity() * sizeof(Slot*)
+        + free_.capacity() * sizeof(uint32_t)
+        + sizeof(*this);
+    return bytes / size_;
+}
+
+/**
+* Prints the contents in key order, one entry per line.
+*/
+template<class Key, class Value>
+void CompactAVLTree<Key, Value>::print() const
+{
+    for (iterator it = begin(); it != end(); ++it) {
+        std::cout << it->first << " " << it->second << std::endl;
+    }
+}
+
+template<class Key, class Value>
+typename CompactAVLTree<Key, Value>::iterator
+CompactAVLTree<Key, Value>::begin() const
+{
+    uint32_t i = root_;
+    while (i != NIL && slot(i).left != NIL) {
+        i = slot(i).left;
+    }
+    return iterator(this, i);
+}
+
+template<class Key, class Value>
+typename CompactAVLTree<Key, Value>::iterator
+CompactAVLTree<Key, Value>::end() const
+{
+    return iterator(this, NIL);
+}
+
+template<class Key, class Value>
+typename CompactAVLTree<Key, Value>::iterator
+CompactAVLTree<Key, Value>::find(const Key& key) const
+{
+    return iterator(this, internalFind(key));
+}
+
+/**
+ * @precondition The key exists in the map
+ * Returns the value associated with the key
+ */
+template<class Key, class Value>
+Value& CompactAVLTree<Key, Value>::operator[](const Key& key)
+{
+    uint32_t i = internalFind(key);
+    if(i == NIL) throw std::out_of_range("Invalid key");
+    return slot(i).item.second;
+}
+template<class Key, class Value>
+Value const & CompactAVLTree<Key, Value>::operator[](const Key& key) const
+{
+    uint32_t i = internalFind(key);
+    if(i == NIL) throw std::out_of_range("Invalid key");
+    return slot(i).item.second;
+}
+
+/*
+ * Recall: If key is already in the tree, you should
+ * overwrite the current value with the updated value.
+ */
+template<class Key, class Value>
+void CompactAVLTree<Key, Value>::insert(const std::pair<const Key, Value>& keyValuePair)
+{
+    if (root_ == NIL) {
+        root_ = allocate(keyValuePair, NIL);
+        return;
+    }
+    uint32_t p = root_;
+    uint32_t n;
+    while (true) {
+        Slot& s = slot(p);
+        if (keyValuePair.first < s.item.first) {
+            if (s.left == NIL) {
+                n = allocate(keyValuePair, p);
+                s.left = n;
+                break;
+            }
+            p = s.left;
+        } else if (s.item.first < keyValuePair.first) {
+            if (s.right == NIL) {
+                n = allocate(keyValuePair, p);
+                s.right = n;
+                break;
+            }
+            p = s.right;
+        } else { // if its equal overwrite the value
+            s.item.second = keyValuePair.second;
+            return;
+        }
+    }
+    // Walk up while the subtree that grew makes its parent taller
+    for (; p != NIL; n = p, p = parent(n)) {
+        int b = balance(p) + (slot(p).left == n ? -1 : 1);
+        if (b == 0) {
+            setBalance(p, 0);
+            return;
+        }
+        if (b == 1 || b == -1) {
+            setBalance(p, b);
+            continue;
+        }
+        if (b == -2) {
+            if (balance(n) > 0) {
+                rotateLeftRight(p);
+            } else {
+                rotateRight(p);
+            }
+        } else {
+            if (balance(n) < 0) {
+                rotateRightLeft(p);
+            } else {
+                rotateLeft(p);
+            }
+        }
+        return; // after a rotation the subtree has its old height again
+    }
+}
+
+/*
+ * Recall: The writeup specifies that if a node has 2 children you
+ * should swap with the predecessor and then remove.
+ */
+template<class Key, class Value>
+void CompactAVLTree<Key, Value>::remove(const Key& key)
+{
+    uint32_t z = internalFind(key);
+    if (z == NIL) {
+        return;
+    }
+    uint32_t p;          // lowest node whose subtree got shorter
+    bool shrankLeft;     // which side of p got shorter
+    Slot& zs = slot(z);
+    if (zs.left != NIL && zs.right != NIL) {
+        // Relink the predecessor y into z's position
+        uint32_t y = zs.left;
+        while (slot(y).right != NIL) {
+            y = slot(y).right;
+        }
+        if (parent(y) == z) {
+            p = y;
+            shrankLeft = true;
+        } else {
+            p = parent(y);
+            shrankLeft = false;
+            uint32_t yLeft = slot(y).left;
+            slot(p).right = yLeft;
+            if (yLeft != NIL) {
+                setParent(yLeft, p);
+            }
+            slot(y).left = zs.left;
+            setParent(zs.left, y);
+        }
+        slot(y).right = zs.right;
+        setParent(zs.right, y);
+        replaceChild(parent(z), z, y);
+        setParent(y, parent(z));
+        setBalance(y, balance(z));
+    } else {
+        uint32_t child = (zs.left != NIL) ? zs.left : zs.right;
+        p = parent(z);
+        shrankLeft = (p != NIL && slot(p).left == z);
+        replaceChild(p, z, child);
+        if (child != NIL) {
+            setParent(child, p);
+        }
+    }
+    release(z);
+
+    // Walk up while the shorter subtree makes its parent shorter too
+    while (p != NIL) {
+        int b = balance(p) + (shrankLeft ? 1 : -1);
+        uint32_t g = parent(p);
+        bool pIsLeft = (g != NIL && slot(g).left == p);
+        if (b == 1 || b == -1) {
+            setBalance(p, b);
+            return;
+        }
+        if (b == 2) {
+            uint32_t r = slot(p).right;
+            int br = balance(r);
+            if (br < 0) {
+                rotateRightLeft(p);
+            } else {
+                rotateLeft(p);
+            }
+            if (br == 0) {
+                return; // height unchanged
+            }
+        } else if (b == -2) {
+            uint32_t l = slot(p).left;
+            int bl = balance(l);
+            if (bl > 0) {
+                rotateLeftRight(p);
+            } else {
+                rotateRight(p);
+            }
+            if (bl == 0) {
+                return;
+            }
+        } else {
+            setBalance(p, 0);
+        }
+        p = g;
+        shrankLeft = pIsLeft;
+    }
+}
+
+/**
+* Return true iff the tree is height balanced.
+*/
+template<class Key, class Value>
+bool CompactAVLTree<Key, Value>::isBalanced() const
+{
+    return isBalancedHelper(root_);
+}
+
+template<class Key, class Value>
+bool CompactAVLTree<Key, Value>::isBalancedHelper(uint32_t i) const
+{
+    if (i == NIL) {
+        return true;
+    }
+    int diff = height(slot(i).left) - height(slot(i).right);
+    if (diff > 1 || diff < -1) {
+        return false;
+    }
+    return isBalancedHelper(slot(i).left) && isBalancedHelper(slot(i).right);
+}
+
+template<class Key, class Value>
+int CompactAVLTree<Key, Value>::height(uint32_t i) const
+{
+    if (i == NIL) {
+        return 0;
+    }
+    return 1 + std::max(height(slot(i).left), height(slot(i).right));
+}
+
+template<class Key, class Value>
+typename CompactAVLTree<Key, Value>::Slot& CompactAVLTree<Key, Value>::slot(uint32_t i) const
+{
+    return blocks_[i >> kBlockBits][i & (kBlockSize - 1)];
+}
+
+template<class Key, class Value>
+uint32_t CompactAVLTree<Key, Value>::parent(uint32_t i) const
+{
+    return slot(i).parentAndBalance & kParentMask;
+}
+
+template<class Key, class Value>
+void CompactAVLTree<Key, Value>::setParent(uint32_t i, uint32_t p)
+{
+    uint32_t& packed = slot(i).parentAndBalance;
+    packed = (packed & ~kParentMask) | p;
+}
+
+template<class Key, class Value>
+int CompactAVLTree<Key, Value>::balance(uint32_t i) const
+{
+    return static_cast<int>(slot(i).parentAndBalance >> 30) - 1;
+}
+
+template<class Key, class Value>
+void CompactAVLTree<Key, Value>::setBalance(uint32_t i, int b)
+{
+    uint32_t& packed = slot(i).parentAndBalance;
+    packed = (packed & kParentMask) | (static_cast<uint32_t>(b + 1) << 30);
+}
+
+/**
+* Constructs a node in a free slot, growing the arena by a block if needed.
+*/
+template<class Key, class Value>
+uint32_t CompactAVLTree<Key, Value>::allocate(const std::pair<const Key, Value>& kv, uint32_t parent)
+{
+    uint32_t i;
+    if (!free_.empty()) {
+        i = free_.back();
+        free_.pop_back();
+    } else {
+        if (used_ == NIL) {
+            throw std::length_error("CompactAVLTree is full");
+        }
+        if ((used_ >> kBlockBits) == blocks_.size()) {
+            blocks_.push_back(static_cast<Slot*>(::operator new(sizeof(Slot) * kBlockSize)));
+        }
+        i = used_++;
+    }
+    new (&slot(i)) Slot(kv, parent);
+    ++size_;
+    return i;
+}
+
+template<class Key, class Value>
+void CompactAVLTree<Key, Value>::release(uint32_t i)
+{
+    slot(i).~Slot();
+    free_.push_back(i);
+    --size_;
+}
+
+template<class Key, class Value>
+uint32_t CompactAVLTree<Key, Value>::internalFind(const Key& key) const
+{
+    uint32_t i = root_;
+    while (i != NIL) {
+        const Slot& s = slot(i);
+        if (key == s.item.first) {
+            return i;
+        }
+        i = (key < s.item.first) ? s.left : s.right;
+    }
+    return NIL;
+}
+
+template<class Key, class Value>
+void CompactAVLTree<Key, Value>::replaceChild(uint32_t p, uint32_t oldChild, uint32_t newChild)
+{
+    if (p == NIL) {
+        root_ = newChild;
+    } else if (slot(p).left == oldChild) {
+        slot(p).left = newChild;
+    } else {
+        slot(p).right = newChild;
+    }
+}
+
+/**
+* Rotates x's right child z above x and returns z. Balances are set for
+* both the insert case (z leaning right) and the remove-only case where z
+* was balanced.
+*/
+template<class Key, class Value>
+uint32_t CompactAVLTree<Key, Value>::rotateLeft(uint32_t x)
+{
+    uint32_t z = slot(x).right;
+    uint32_t inner = slot(z).left;
+    uint32_t g = parent(x);
+    slot(x).right = inner;
+    if (inner != NIL) {
+        setParent(inner, x);
+    }
+    slot(z).left = x;
+    setParent(x, z);
+    replaceChild(g, x, z);
+    setParent(z, g);
+    if (balance(z) == 0) {
+        setBalance(x, 1);
+        setBalance(z, -1);
+    } else {
+        setBalance(x, 0);
+        setBalance(z, 0);
+    }
+    return z;
+}
+
+/**
+* Mirror image of rotateLeft.
+*/
+template<class Key, class Value>
+uint32_t CompactAVLTree<Key, Value>::rotateRight(uint32_t x)
+{
+    uint32_t z = slot(x).left;
+    uint32_t inner = slot(z).right;
+    uint32_t g = parent(x);
+    slot(x).left = inner;
+    if (inner != NIL) {
+        setParent(inner, x);
+    }
+    slot(z).right = x;
+    setParent(x, z);
+    replaceChild(g, x, z);
+    setParent(z, g);
+    if (balance(z) == 0) {
+        setBalance(x, -1);
+        setBalance(z, 1);
+    } else {
+        setBalance(x, 0);
+        setBalance(z, 0);
+    }
+    return z;
+}
+
+/**
+* Double rotation for a right-heavy x whose right child leans left: the
+* inner grandchild y ends up on top.
+*/
+template<class Key, class Value>
+uint32_t CompactAVLTree<Key, Value>::rotateRightLeft(uint32_t x)
+{
+    uint32_t z = slot(x).right;
+    uint32_t y = slot(z).left;
+    int by = balance(y);
+    uint32_t g = parent(x);
+    uint32_t yLeft = slot(y).left;
+    uint32_t yRight = slot(y).right;
+    slot(z).left = yRight;
+    if (yRight != NIL) {
+        setParent(yRight, z);
+    }
+    slot(x).right = yLeft;
+    if (yLeft != NIL) {
+        setParent(yLeft, x);
+    }
+    slot(y).left = x;
+    slot(y).right = z;
+    setParent(x, y);
+    setParent(z, y);
+    replaceChild(g, x, y);
+    setParent(y, g);
+    setBalance(x, by > 0 ? -1 : 0);
+    setBalance(z, by < 0 ? 1 : 0);
+    setBalance(y, 0);
+    return y;
+}
+
+/**
+* Mirror image of rotateRightLeft.
+*/
+template<class Key, class Value>
+uint32_t CompactAVLTree<Key, Value>::rotateLeftRight(uint32_t x)
+{
+    uint32_t z = slot(x).left;
+    uint32_t y = slot(z).right;
+    int by = balance(y);
+    uint32_t g = parent(x);
+    uint32_t yLeft = slot(y).left;
+    uint32_t yRight = slot(y).right;
+    slot(z).right = yLeft;
+    if (yLeft != NIL) {
+        setParent(yLeft, z);
+    }
+    slot(x).left = yRight;
+    if (yRight != NIL) {
+        setParent(yRight, x);
+    }
+    slot(y).right = x;
+    slot(y).left = z;
+    setParent(x, y);
+    setParent(z, y);
+    replaceChild(g, x, y);
+    setParent(y, g);
+    setBalance(x, by < 0 ? 1 : 0);
+    setBalance(z, by > 0 ? -1 : 0);
+    setBalance(y, 0);
+    return y;
+}
+
+/*
+------------------------------------------------
+End implementations for the CompactAVLTree class.
+------------------------------------------------
+*/
+
+#endif
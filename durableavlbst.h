@@ -0,0 +1,659 @@
+#ifndef DURABLEAVLBST_H
+#define DURABLEAVLBST_H
+
+#include <iostream>
+#include <exception>
+#include <stdexcept>
+#include <cstdlib>
+#include <cstdint>
+#include <cstring>
+#include <cerrno>
+#include <cstdio>
+#include <string>
+#include <vector>
+#include <fstream>
+#include <sstream>
+#include <type_traits>
+#include <fcntl.h>
+#include <unistd.h>
+#include "avlbst.h"
+
+/**
+* Turns keys and values into log bytes and back. This one copies the bytes
+* of a trivially copyable type; specialize it for anything else.
+*/
+template <typename T>
+struct WalCodec
+{
+    static_assert(std::is_trivially_copyable<T>::value, "WalCodec needs a specialization for this type");
+    static void put(std::string& out, const T& value)
+    {
+        out.append(reinterpret_cast<const char*>(&value), sizeof(T));
+    }
+    static bool get(const char*& p, const char* end, T& value)
+    {
+        if (static_cast<size_t>(end - p) < sizeof(T)) {
+            return false;
+        }
+        std::memcpy(&value, p, sizeof(T));
+        p += sizeof(T);
+        return true;
+    }
+};
+
+/**
+* Strings are stored as a 32-bit length followed by the characters.
+*/
+template <>
+struct WalCodec<std::string>
+{
+    static void put(std::string& out, const std::string& value)
+    {
+        WalCodec<uint32_t>::put(out, static_cast<uint32_t>(value.size()));
+        out.append(value);
+    }
+    static bool get(const char*& p, const char* end, std::string& value)
+    {
+        uint32_t size;
+        if (!WalCodec<uint32_t>::get(p, end, size) || static_cast<size_t>(end - p) < size) {
+            return false;
+        }
+        value.assign(p, size);
+        p += size;
+        return true;
+    }
+};
+
+/**
+* An AVL tree that survives crashes. Once open() is called, every insert
+* and remove is appended to path.log before it is applied. Records are
+* written in groups: one write() and one fdatasync() cover groupSize
+* records, so a crash loses at most the last group that was not committed.
+* checkpoint() dumps the items in key order to path.ckpt and starts an
+* empty log, and open() recovers by rebuilding the tree from the
+* checkpoint in O(n) and replaying the log on top of it. A torn record at
+* the end of the log is cut off.
+*
+* insert, remove, clear, the erase family, extract and insert(node_type&&)
+* are logged record by record; merge and build_parallel replace so much
+* that they end in a checkpoint instead. Lazy deletion needs nothing more,
+* since remove() is logged either way and compact() changes no item. The
+* base classes do not make these virtual, so calls through an AVLTree or
+* BinarySearchTree reference bypass the log, as do values changed in
+* place. I/O errors throw std::runtime_error.
+*/
+template <class Key, class Value, class KeyCodec = WalCodec<Key>, class ValueCodec = WalCodec<Value> >
+class DurableAVLTree : public AVLTree<Key, Value>
+{
+public:
+    DurableAVLTree();
+    virtual ~DurableAVLTree(); // Commits whatever is pending
+
+    // Replaces the contents with what path.ckpt and path.log hold and
+    // logs all later updates. With fsync false, commits only write() and
+    // leave flushing to the OS.
+    void open(const std::string& path, size_t groupSize = 64, bool fsync = true);
+    void close(); // Commits and stops logging; the items stay
+    bool isOpen() const;
+
+    typedef typename AVLTree<Key, Value>::iterator iterator;
+    typedef typename AVLTree<Key, Value>::node_type node_type;
+
+    using AVLTree<Key, Value>::insert;
+    virtual void insert(const std::pair<const Key, Value>& new_item);
+    virtual void remove(const Key& key);
+    void clear();
+    iterator erase(iterator pos);
+    iterator erase(iterator first, iterator last);
+    template<typename Pred>
+    size_t erase_if(Pred pred);
+    node_type extract(const Key& key);
+    node_type extract(iterator pos);
+    std::pair<iterator, bool> insert(node_type&& handle);
+    void merge(DurableAVLTree& other); // Checkpoints both trees
+    template<typename InputIt>
+    void build_parallel(InputIt first, InputIt last, unsigned threads = 0); // Then checkpoints
+
+    void commit(); // Writes and syncs the pending group now
+    void checkpoint(); // Sorted dump of the tree, then an empty log
+    void setCheckpointInterval(size_t records); // Checkpoint after this many logged records, 0 for never
+    size_t loggedRecords() const; // Records in the log since the last checkpoint
+
+protected:
+    void appendRecord(char op, const Key* key, const Value* value); // key is NULL for a clear
+    void checkpointIfDue();
+    void loadCheckpoint(const std::string& file);
+    size_t replayLog(const std::string& file); // Returns the length of the intact prefix
+    static bool readFile(const std::string& file, std::string& out);
+    static uint32_t checksum(const char* data, size_t size);
+    static void writeAll(int fd, const std::string& data, const std::string& file);
+    static void syncFile(int fd, const std::string& file);
+    void syncDirectory() const; // Makes a rename in path_'s directory durable
+    static void fail(const std::string& what, const std::string& file);
+
+    std::string path_;
+    int logFd_; // -1 while not open
+    size_t groupSize_;
+    bool fsync_;
+    std::string pending_; // Encoded records not written yet
+    size_t pendingRecords_;
+    size_t logEnd_; // Length of the log up to the last commit that went through
+    bool logTorn_; // A failed commit may have left part of a group past logEnd_
+    size_t logged_;
+    size_t checkpointEvery_;
+
+private:
+    DurableAVLTree(const DurableAVLTree&);            // not copyable, it owns the log
+    DurableAVLTree& operator=(const DurableAVLTree&);
+};
+
+/*
+------------------------------------------------
+Begin implementations for the DurableAVLTree class.
+------------------------------------------------
+*/
+
+template<class Key, class Value, class KeyCodec, class ValueCodec>
+DurableAVLTree<Key, Value, KeyCodec, ValueCodec>::DurableAVLTree() :
+    logFd_(-1), groupSize_(64), fsync_(true), pendingRecords_(0), logEnd_(0), logTorn_(false), logged_(0),
+    checkpointEvery_(0)
+{
+}
+
+template<class Key, class Value, class KeyCodec, class ValueCodec>
+DurableAVLTree<Key, Value, KeyCodec, ValueCodec>::~DurableAVLTree()
+{
+    try {
+        close();
+    }
+    catch (const std::exception&) {
+        // Nothing left to report to; the log ends at the last good group
+    }
+}
+
+template<class Key, class Value, class KeyCodec, class ValueCodec>
+void DurableAVLTree<Key, Value, KeyCodec, ValueCodec>::open(const std::string& path, size_t groupSize, bool fsync)
+{
+    close();
+    path_ = path;
+    groupSize_ = groupSize == 0 ? 1 : groupSize;
+    fsync_ = fsync;
+    this->clear();
+    loadCheckpoint(path_ + ".ckpt");
+    std::string log = path_ + ".log";
+    size_t intact = replayLog(log);
+    logFd_ = ::open(log.c_str(), O_WRONLY | O_CREAT | O_APPEND, 0644);
+    if (logFd_ < 0) {
+        fail("cannot open", log);
+    }
+    if (::ftruncate(logFd_, static_cast<off_t>(intact)) != 0) {
+        fail("cannot truncate", log);
+    }
+    logEnd_ = intact;
+    logTorn_ = false;
+}
+
+template<class Key, class Value, class KeyCodec, class ValueCodec>
+void DurableAVLTree<Key, Value, KeyCodec, ValueCodec>::close()
+{
+    if (logFd_ < 0) {
+        return;
+    }
+    commit();
+    ::close(logFd_);
+    logFd_ = -1;
+}
+
+template<class Key, class Value, class KeyCodec, class ValueCodec>
+bool DurableAVLTree<Key, Value, KeyCodec, ValueCodec>::isOpen() const
+{
+    return logFd_ >= 0;
+}
+
+template<class Key, class Value, class KeyCodec, class ValueCodec>
+void DurableAVLTree<Key, Value, KeyCodec, ValueCodec>::insert(const std::pair<const Key, Value>& new_item)
+{
+    if (logFd_ >= 0) {
+        appendRecord('I', &new_item.first, &new_item.second);
+    }
+    AVLTree<Key, Value>::insert(new_item);
+    checkpointIfDue();
+}
+
+template<class Key, class Value, class KeyCodec, class ValueCodec>
+void DurableAVLTree<Key, Value, KeyCodec, ValueCodec>::remove(const Key& key)
+{
+    if (logFd_ >= 0) {
+        appendRecord('R', &key, nullptr);
+    }
+    AVLTree<Key, Value>::remove(key);
+    checkpointIfDue();
+}
+
+template<class Key, class Value, class KeyCodec, class ValueCodec>
+void DurableAVLTree<Key, Value, KeyCodec, ValueCodec>::clear()
+{
+    if (logFd_ >= 0) {
+        appendRecord('C', nullptr, nullptr);
+    }
+    AVLTree<Key, Value>::clear();
+    checkpointIfDue();
+}
+
+template<class Key, class Value, class KeyCodec, class ValueCodec>
+typename DurableAVLTree<Key, Value, KeyCodec, ValueCodec>::iterator
+DurableAVLTree<Key, Value, KeyCodec, ValueCodec>::erase(iterator pos)
+{
+    if (logFd_ >= 0 && pos != this->end()) {
+        appendRecord('R', &pos->first, nullptr);
+    }
+    iterator next = AVLTree<Key, Value>::erase(pos);
+    checkpointIfDue();
+    return next;
+}
+
+/**
+* Erases one item at a time, so that if logging throws, every item already
+* logged has been erased and the rest of the range is untouched.
+*/
+template<class Key, class Value, class KeyCodec, class ValueCodec>
+typename DurableAVLTree<Key, Value, KeyCodec, ValueCodec>::iterator
+DurableAVLTree<Key, Value, KeyCodec, ValueCodec>::erase(iterator first, iterator last)
+{
+    while (first != last) {
+        first = erase(first);
+    }
+    return last;
+}
+
+template<class Key, class Value, class KeyCodec, class ValueCodec>
+template<typename Pred>
+size_t DurableAVLTree<Key, Value, KeyCodec, ValueCodec>::erase_if(Pred pred)
+{
+    size_t erased = 0;
+    iterator it = this->begin();
+    while (it != this->end()) {
+        if (pred(*it)) {
+            it = erase(it);
+            ++erased;
+        }
+        else {
+            ++it;
+        }
+    }
+    return erased;
+}
+
+template<class Key, class Value, class KeyCodec, class ValueCodec>
+typename DurableAVLTree<Key, Value, KeyCodec, ValueCodec>::node_type
+DurableAVLTree<Key, Value, KeyCodec, ValueCodec>::extract(const Key& key)
+{
+    return extract(this->find(key));
+}
+
+template<class Key, class Value, class KeyCodec, class ValueCodec>
+typename DurableAVLTree<Key, Value, KeyCodec, ValueCodec>::node_type
+DurableAVLTree<Key, Value, KeyCodec, ValueCodec>::extract(iterator pos)
+{
+    if (logFd_ >= 0 && pos != this->end()) {
+        appendRecord('R', &pos->first, nullptr);
+    }
+    node_type handle = AVLTree<Key, Value>::extract(pos);
+    checkpointIfDue();
+    return handle;
+}
+
+/**
+* Logged after the node is linked, since only then is it known whether the
+* key was free. If logging throws, the node goes back into the handle.
+*/
+template<class Key, class Value, class KeyCodec, class ValueCodec>
+std::pair<typename DurableAVLTree<Key, Value, KeyCodec, ValueCodec>::iterator, bool>
+DurableAVLTree<Key, Value, KeyCodec, ValueCodec>::insert(node_type&& handle)
+{
+    std::pair<iterator, bool> result = AVLTree<Key, Value>::insert(std::move(handle));
+    if (logFd_ >= 0 && result.second) {
+        try {
+            appendRecord('I', &result.first->first, &result.first->second);
+        }
+        catch (const std::exception&) {
+            handle = AVLTree<Key, Value>::extract(result.first);
+            throw;
+        }
+        checkpointIfDue();
+    }
+    return result;
+}
+
+/**
+* other is checkpointed last, so if this tree's checkpoint fails, a
+* recovery finds the moved items in both trees rather than in neither.
+*/
+template<class Key, class Value, class KeyCodec, class ValueCodec>
+void DurableAVLTree<Key, Value, KeyCodec, ValueCodec>::merge(DurableAVLTree& other)
+{
+    this->mergeFrom(other);
+    checkpoint();
+    other.checkpoint();
+}
+
+template<class Key, class Value, class KeyCodec, class ValueCodec>
+template<typename InputIt>
+void DurableAVLTree<Key, Value, KeyCodec, ValueCodec>::build_parallel(InputIt first, InputIt last, unsigned threads)
+{
+    AVLTree<Key, Value>::build_parallel(first, last, threads);
+    checkpoint();
+}
+
+/**
+* If the write or the sync fails, the log is cut back to where the last
+* good commit ended and the group stays pending, so the next commit writes
+* it again in full instead of after a torn copy, which replay would stop
+* at. Should that truncate fail too, the next commit retries it first.
+*/
+template<class Key, class Value, class KeyCodec, class ValueCodec>
+void DurableAVLTree<Key, Value, KeyCodec, ValueCodec>::commit()
+{
+    if (logFd_ < 0 || pending_.empty()) {
+        return;
+    }
+    std::string log = path_ + ".log";
+    if (logTorn_) {
+        if (::ftruncate(logFd_, static_cast<off_t>(logEnd_)) != 0) {
+            fail("cannot truncate", log);
+        }
+        logTorn_ = false;
+    }
+    logTorn_ = true;
+    try {
+        writeAll(logFd_, pending_, log);
+        if (fsync_) {
+            syncFile(logFd_, log);
+        }
+    }
+    catch (const std::exception&) {
+        if (::ftruncate(logFd_, static_cast<off_t>(logEnd_)) == 0) {
+            logTorn_ = false;
+        }
+        throw;
+    }
+    logTorn_ = false;
+    logEnd_ += pending_.size();
+    pending_.clear();
+    pendingRecords_ = 0;
+}
+
+/**
+* The dump goes to a temporary file that is synced and then renamed over
+* the old checkpoint, so a crash leaves either the old or the new one. A
+* crash before the log is emptied only means its records get replayed
+* over a checkpoint that already has them, which changes nothing.
+*/
+template<class Key, class Value, class KeyCodec, class ValueCodec>
+void DurableAVLTree<Key, Value, KeyCodec, ValueCodec>::checkpoint()
+{
+    if (logFd_ < 0) {
+        return;
+    }
+    commit();
+    std::string body;
+    uint64_t count = 0;
+    for (typename AVLTree<Key, Value>::iterator it = this->begin(); it != this->end(); ++it) {
+        KeyCodec::put(body, it->first);
+        ValueCodec::put(body, it->second);
+        ++count;
+    }
+    std::string data("AVLCKPT1", 8);
+    WalCodec<uint64_t>::put(data, count);
+    data += body;
+    WalCodec<uint32_t>::put(data, checksum(body.data(), body.size()));
+
+    std::string file = path_ + ".ckpt";
+    std::string temp = file + ".tmp";
+    int fd = ::open(temp.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+        fail("cannot create", temp);
+    }
+    writeAll(fd, data, temp);
+    syncFile(fd, temp);
+    ::close(fd);
+    if (std::rename(temp.c_str(), file.c_str()) != 0) {
+        fail("cannot rename", temp);
+    }
+    syncDirectory();
+    std::string log = path_ + ".log";
+    if (::ftruncate(logFd_, 0) != 0) {
+        fail("cannot truncate", log);
+    }
+    logEnd_ = 0;
+    syncFile(logFd_, log);
+    logged_ = 0;
+}
+
+template<class Key, class Value, class KeyCodec, class ValueCodec>
+void DurableAVLTree<Key, Value, KeyCodec, ValueCodec>::checkpointIfDue()
+{
+    if (checkpointEvery_ != 0 && logged_ >= checkpointEvery_) {
+        checkpoint();
+    }
+}
+
+template<class Key, class Value, class KeyCodec, class ValueCodec>
+void DurableAVLTree<Key, Value, KeyCodec, ValueCodec>::setCheckpointInterval(size_t records)
+{
+    checkpointEvery_ = records;
+}
+
+template<class Key, class Value, class KeyCodec, class ValueCodec>
+size_t DurableAVLTree<Key, Value, KeyCodec, ValueCodec>::loggedRecords() const
+{
+    return logged_;
+}
+
+/**
+* A record is its payload length and checksum followed by the payload: the
+* operation, the key and, for an insert, the value; a clear has only the
+* operation. If the record fills a group and the commit throws, the record is taken back out, since the
+* caller never applies the update; the rest of the group stays pending.
+*/
+template<class Key, class Value, class KeyCodec, class ValueCodec>
+void DurableAVLTree<Key, Value, KeyCodec, ValueCodec>::appendRecord(char op, const Key* key, const Value* value)
+{
+    size_t header = pending_.size();
+    pending_.append(2 * sizeof(uint32_t), '\0');
+    size_t start = pending_.size();
+    pending_.push_back(op);
+    if (key != nullptr) {
+        KeyCodec::put(pending_, *key);
+    }
+    if (value != nullptr) {
+        ValueCodec::put(pending_, *value);
+    }
+    uint32_t size = static_cast<uint32_t>(pending_.size() - start);
+    uint32_t sum = checksum(pending_.data() + start, size);
+    std::memcpy(&pending_[header], &size, sizeof(size));
+    std::memcpy(&pending_[header + sizeof(size)], &sum, sizeof(sum));
+    if (++pendingRecords_ >= groupSize_) {
+        try {
+            commit();
+        }
+        catch (const std::exception&) {
+            pending_.resize(header);
+            --pendingRecords_;
+            throw;
+        }
+    }
+    ++logged_;
+}
+
+/**
+* The checkpoint is sorted, so its nodes are linked straight into a
+* balanced tree without comparing any keys.
+*/
+template<class Key, class Value, class KeyCodec, class ValueCodec>
+void DurableAVLTree<Key, Value, KeyCodec, ValueCodec>::loadCheckpoint(const std::string& file)
+{
+    std::string data;
+    if (!readFile(file, data)) {
+        return;
+    }
+    const char* p = data.data();
+    const char* end = p + data.size();
+    uint64_t count;
+    if (data.size() < 8 + sizeof(count) + sizeof(uint32_t) || data.compare(0, 8, "AVLCKPT1") != 0) {
+        throw std::runtime_error("corrupt checkpoint " + file);
+    }
+    p += 8;
+    WalCodec<uint64_t>::get(p, end, count);
+    const char* bodyEnd = end - sizeof(uint32_t);
+    uint32_t sum;
+    std::memcpy(&sum, bodyEnd, sizeof(sum));
+    if (sum != checksum(p, bodyEnd - p)) {
+        throw std::runtime_error("corrupt checkpoint " + file);
+    }
+    std::vector<Node<Key, Value>*> nodes;
+    nodes.reserve(count);
+    for (uint64_t i = 0; i < count; ++i) {
+        Key key;
+        Value value;
+        if (!KeyCodec::get(p, bodyEnd, key) || !ValueCodec::get(p, bodyEnd, value)) {
+            for (size_t j = 0; j < nodes.size(); ++j) {
+                delete nodes[j];
+            }
+            throw std::runtime_error("corrupt checkpoint " + file);
+        }
+        nodes.push_back(this->createNode(key, value, nullptr));
+    }
+    this->rebuildFrom(nodes);
+}
+
+/**
+* Replays records until the first one that does not check out: cut short,
+* a bad checksum, an empty payload, an unknown operation, or a key and
+* value that do not fill the payload exactly. That record and everything
+* after it count as torn. Nothing is applied until a record fully parses.
+*/
+template<class Key, class Value, class KeyCodec, class ValueCodec>
+size_t DurableAVLTree<Key, Value, KeyCodec, ValueCodec>::replayLog(const std::string& file)
+{
+    std::string data;
+    if (!readFile(file, data)) {
+        return 0;
+    }
+    const char* begin = data.data();
+    const char* p = begin;
+    const char* end = begin + data.size();
+    logged_ = 0;
+    while (true) {
+        uint32_t size;
+        uint32_t sum;
+        const char* record = p;
+        if (!WalCodec<uint32_t>::get(p, end, size) || !WalCodec<uint32_t>::get(p, end, sum) ||
+            size < 1 || static_cast<size_t>(end - p) < size || sum != checksum(p, size)) {
+            return record - begin;
+        }
+        const char* payloadEnd = p + size;
+        char op = *p++;
+        if (op != 'I' && op != 'R' && op != 'C') {
+            return record - begin;
+        }
+        Key key;
+        Value value;
+        if ((op != 'C' && !KeyCodec::get(p, payloadEnd, key)) ||
+            (op == 'I' && !ValueCodec::get(p, payloadEnd, value)) || p != payloadEnd) {
+            return record - begin;
+        }
+        if (op == 'C') {
+            AVLTree<Key, Value>::clear();
+        }
+        else if (op == 'I') {
+            AVLTree<Key, Value>::insert(std::make_pair(key, value));
+        }
+        else {
+            AVLTree<Key, Value>::remove(key);
+        }
+        ++logged_;
+    }
+}
+
+template<class Key, class Value, class KeyCodec, class ValueCodec>
+bool DurableAVLTree<Key, Value, KeyCodec, ValueCodec>::readFile(const std::string& file, std::string& out)
+{
+    std::ifstream in(file.c_str(), std::ios::binary);
+    if (!in) {
+        return false;
+    }
+    std::ostringstream contents;
+    contents << in.rdbuf();
+    out = contents.str();
+    return true;
+}
+
+/**
+* 32-bit FNV-1a, enough to tell a torn or garbled record from a good one.
+*/
+template<class Key, class Value, class KeyCodec, class ValueCodec>
+uint32_t DurableAVLTree<Key, Value, KeyCodec, ValueCodec>::checksum(const char* data, size_t size)
+{
+    uint32_t hash = 2166136261u;
+    for (size_t i = 0; i < size; ++i) {
+        hash = (hash ^ static_cast<unsigned char>(data[i])) * 16777619u;
+    }
+    return hash;
+}
+
+template<class Key, class Value, class KeyCodec, class ValueCodec>
+void DurableAVLTree<Key, Value, KeyCodec, ValueCodec>::writeAll(int fd, const std::string& data, const std::string& file)
+{
+    const char* p = data.data();
+    size_t left = data.size();
+    while (left > 0) {
+        ssize_t n = ::write(fd, p, left);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            fail("cannot write", file);
+        }
+        p += n;
+        left -= static_cast<size_t>(n);
+    }
+}
+
+template<class Key, class Value, class KeyCodec, class ValueCodec>
+void DurableAVLTree<Key, Value, KeyCodec, ValueCodec>::syncFile(int fd, const std::string& file)
+{
+    if (::fdatasync(fd) != 0) {
+        fail("cannot sync", file);
+    }
+}
+
+template<class Key, class Value, class KeyCodec, class ValueCodec>
+void DurableAVLTree<Key, Value, KeyCodec, ValueCodec>::syncDirectory() const
+{
+    size_t slash = path_.rfind('/');
+    std::string dir = (slash == std::string::npos) ? "." : path_.substr(0, slash + 1);
+    int fd = ::open(dir.c_str(), O_RDONLY);
+    if (fd < 0) {
+        fail("cannot open", dir);
+    }
+    if (::fsync(fd) != 0) {
+        ::close(fd);
+        fail("cannot sync", dir);
+    }
+    ::close(fd);
+}
+
+template<class Key, class Value, class KeyCodec, class ValueCodec>
+void DurableAVLTree<Key, Value, KeyCodec, ValueCodec>::fail(const std::string& what, const std::string& file)
+{
+    throw std::runtime_error(what + " " + file + ": " + std::strerror(errno));
+}
+
+/*
+----------------------------------------------
+End implementations for the DurableAVLTree class.
+----------------------------------------------
+*/
+
+#endif
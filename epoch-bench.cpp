@@ -0,0 +1,119 @@
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include "avlbst.h"
+#include "epochavlbst.h"
+#include "bench-util.h"
+
+using namespace std;
+
+// Usage: epoch-bench [num_keys] [max_readers] [ms_per_run]
+// One writer keeps replacing, removing and re-inserting keys while the
+// readers look keys up. EpochAVLTree readers take no lock; the baseline
+// wraps a plain AVLTree in one mutex shared by everybody.
+
+struct Result
+{
+    double readsPerMs;
+    double writesPerMs;
+};
+
+template<typename Read, typename Write>
+static Result runMixed(unsigned readers, int ms, Read read, Write write)
+{
+    atomic<bool> stop(false);
+    atomic<long> reads(0);
+    vector<thread> threads;
+    for (unsigned r = 0; r < readers; ++r) {
+        threads.push_back(thread([&, r]() {
+            long n = read(r, stop);
+            reads += n;
+        }));
+    }
+    BenchTimer timer;
+    long writes = 0;
+    while (timer.elapsedMs() < ms) {
+        for (int i = 0; i < 256; ++i) {
+            write(writes++);
+        }
+    }
+    stop.store(true);
+    for (size_t i = 0; i < threads.size(); ++i) {
+        threads[i].join();
+    }
+    double elapsed = timer.elapsedMs();
+    Result result = { reads.load() / elapsed, writes / elapsed };
+    return result;
+}
+
+int main(int argc, char *argv[])
+{
+    int n = (int) benchArg(argc, argv, 1, 1000000);
+    unsigned maxReaders = (unsigned) benchArg(argc, argv, 2, 8);
+    int ms = (int) benchArg(argc, argv, 3, 1000);
+    vector<int> keys = makeShuffledKeys(n, 1);
+    vector<int> trace = makeUniformTrace(n, 1 << 20, 2);
+
+    cout << n << " keys, " << thread::hardware_concurrency() << " hardware threads, " << ms << " ms per run" << endl;
+    cout << fixed << setprecision(0);
+    cout << "readers  tree            reads/ms  writes/ms" << endl;
+    for (unsigned readers = 1; readers <= maxReaders; readers *= 2) {
+        {
+            EpochAVLTree<int, int> tree(readers);
+            for (int i = 0; i < n; ++i) {
+                tree.insert(make_pair(keys[i], keys[i]));
+            }
+            Result r = runMixed(readers, ms,
+                [&](unsigned id, atomic<bool>& stop) {
+                    EpochAVLTree<int, int>::Reader reader(tree.reclaimer());
+                    long count = 0;
+                    size_t i = id * 7919;
+                    int value;
+                    while (!stop.load(memory_order_relaxed)) {
+                        tree.find(trace[i++ & (trace.size() - 1)], value, reader);
+                        ++count;
+                    }
+                    return count;
+                },
+                [&](long w) {
+                    int k = keys[w % n];
+                    if (w % 3 == 0) {
+                        tree.remove(k);
+                    }
+                    tree.insert(make_pair(k, (int) w));
+                });
+            cout << setw(7) << readers << "  EpochAVLTree    " << setw(9) << r.readsPerMs << " " << setw(10) << r.writesPerMs << endl;
+        }
+        {
+            AVLTree<int, int> tree;
+            mutex lock;
+            for (int i = 0; i < n; ++i) {
+                tree.insert(make_pair(keys[i], keys[i]));
+            }
+            Result r = runMixed(readers, ms,
+                [&](unsigned id, atomic<bool>& stop) {
+                    long count = 0;
+                    size_t i = id * 7919;
+                    while (!stop.load(memory_order_relaxed)) {
+                        lock_guard<mutex> guard(lock);
+                        tree.find(trace[i++ & (trace.size() - 1)]);
+                        ++count;
+                    }
+                    return count;
+                },
+                [&](long w) {
+                    int k = keys[w % n];
+                    lock_guard<mutex> guard(lock);
+                    if (w % 3 == 0) {
+                        tree.remove(k);
+                    }
+                    tree.insert(make_pair(k, (int) w));
+                });
+            cout << setw(7) << readers << "  mutex AVLTree   " << setw(9) << r.readsPerMs << " " << setw(10) << r.writesPerMs << endl;
+        }
+    }
+    return 0;
+}
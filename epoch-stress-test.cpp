@@ -0,0 +1,191 @@
+#include <iostream>
+#include <cstdlib>
+#include <map>
+#include <random>
+#include <vector>
+#include <thread>
+#include <atomic>
+#include "bst.h"
+#include "avlbst.h"
+#include "epochavlbst.h"
+#include "bench-util.h"
+
+using namespace std;
+
+// Usage: epoch-stress-test [rounds] [writes_per_round] [readers]
+// Readers call find() while one writer inserts, overwrites and removes,
+// which rotates, unlinks and swaps nodes under them. Even keys are never
+// removed, so every reader lookup of one must hit, and every value must be
+// the one some insert stored, never a mix of two. Build with
+//   make epoch-stress-test CXXFLAGS="-g -std=c++11 -pthread -fsanitize=thread"
+// (or -fsanitize=address) to have the sanitizer check the same runs.
+
+struct Stamp
+{
+    long key;
+    long write;
+    long check; // key ^ write, so a torn value shows up
+};
+
+static Stamp makeStamp(int key, long write)
+{
+    Stamp s = { key, write, key ^ write };
+    return s;
+}
+
+ostream& operator<<(ostream& out, const Stamp& s) // For print()
+{
+    return out << s.key << "@" << s.write;
+}
+
+static bool validStamp(int key, const Stamp& s)
+{
+    return s.key == key && s.check == (s.key ^ s.write);
+}
+
+// Lets the single-threaded pass look at the shape
+class CheckedTree : public EpochAVLTree<int, Stamp>
+{
+public:
+    explicit CheckedTree(size_t maxReaders) : EpochAVLTree<int, Stamp>(maxReaders) {}
+    bool valid() const
+    {
+        return checkedHeight(this->root_, nullptr) >= 0;
+    }
+private:
+    static int checkedHeight(Node<int, Stamp>* n, Node<int, Stamp>* parent)
+    {
+        if (n == nullptr) {
+            return 0;
+        }
+        if (n->getParent() != parent) {
+            return -1;
+        }
+        int left = checkedHeight(n->getLeft(), n);
+        int right = checkedHeight(n->getRight(), n);
+        if (left < 0 || right < 0 || static_cast<AVLNode<int, Stamp>*>(n)->getBalance() != right - left) {
+            return -1;
+        }
+        if (right - left > 1 || left - right > 1) {
+            return -1;
+        }
+        return 1 + max(left, right);
+    }
+};
+
+static bool fail(const char* what, long at)
+{
+    cout << "FAILED: " << what << " at " << at << endl;
+    return false;
+}
+
+// One thread, checked against std::map after every step
+static bool singleThreaded(unsigned seed, int ops)
+{
+    mt19937 rng(seed);
+    CheckedTree tree(1);
+    EpochAVLTree<int, Stamp>::Reader reader(tree.reclaimer());
+    map<int, long> expected;
+    int range = 1 + rng() % 400;
+    for (int i = 0; i < ops; ++i) {
+        int k = rng() % range;
+        unsigned op = rng() % 3;
+        if (op == 0) {
+            tree.remove(k);
+            expected.erase(k);
+        }
+        else if (op == 1) {
+            tree.insert(make_pair(k, makeStamp(k, i)));
+            expected[k] = i;
+        }
+        else {
+            Stamp s;
+            bool hit = tree.find(k, s, reader);
+            map<int, long>::iterator it = expected.find(k);
+            if (hit != (it != expected.end()) || (hit && (!validStamp(k, s) || s.write != it->second))) {
+                return fail("single-threaded find", i);
+            }
+        }
+        if (i % 61 == 0 && !tree.valid()) {
+            return fail("AVL shape", i);
+        }
+    }
+    map<int, long>::iterator e = expected.begin();
+    for (EpochAVLTree<int, Stamp>::iterator it = tree.begin(); it != tree.end(); ++it, ++e) {
+        if (e == expected.end() || it->first != e->first || it->second.write != e->second) {
+            return fail("contents", ops);
+        }
+    }
+    return e == expected.end() || fail("missing items", ops);
+}
+
+static bool concurrent(unsigned seed, long writes, unsigned readers)
+{
+    const int kKeys = 2000;
+    EpochAVLTree<int, Stamp> tree(readers + 1);
+    for (int k = 0; k < kKeys; k += 2) {
+        tree.insert(make_pair(k, makeStamp(k, 0)));
+    }
+    atomic<bool> stop(false);
+    atomic<long> misses(0), torn(0), finds(0);
+    vector<thread> pool;
+    for (unsigned r = 0; r < readers; ++r) {
+        pool.push_back(thread([&, r]() {
+            EpochAVLTree<int, Stamp>::Reader reader(tree.reclaimer());
+            mt19937 rng(seed * 31 + r);
+            long count = 0;
+            while (!stop.load(memory_order_relaxed)) {
+                int k = rng() % kKeys;
+                Stamp s;
+                bool hit = tree.find(k, s, reader);
+                if (!hit && k % 2 == 0) {
+                    ++misses;
+                }
+                if (hit && !validStamp(k, s)) {
+                    ++torn;
+                }
+                ++count;
+            }
+            finds += count;
+        }));
+    }
+    mt19937 rng(seed);
+    for (long i = 1; i <= writes; ++i) {
+        int k = rng() % kKeys;
+        if (k % 2 == 0 || rng() % 2 == 0) {
+            tree.insert(make_pair(k, makeStamp(k, i)));
+        }
+        else {
+            tree.remove(k);
+        }
+    }
+    stop.store(true);
+    for (size_t i = 0; i < pool.size(); ++i) {
+        pool[i].join();
+    }
+    tree.collect();
+    cout << "round " << seed << ": " << finds.load() << " finds, " << misses.load()
+         << " misses on stable keys, " << torn.load() << " torn values" << endl;
+    return misses.load() == 0 && torn.load() == 0;
+}
+
+int main(int argc, char *argv[])
+{
+    int rounds = (int) benchArg(argc, argv, 1, 3);
+    long writes = benchArg(argc, argv, 2, 200000);
+    unsigned readers = (unsigned) benchArg(argc, argv, 3, 3);
+
+    for (unsigned seed = 1; seed <= 20; ++seed) {
+        if (!singleThreaded(seed, 3000)) {
+            return 1;
+        }
+    }
+    for (int round = 1; round <= rounds; ++round) {
+        if (!concurrent(round, writes, readers)) {
+            cout << "FAILED" << endl;
+            return 1;
+        }
+    }
+    cout << "PASSED" << endl;
+    return 0;
+}
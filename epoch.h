@@ -0,0 +1,169 @@
+#ifndef EPOCH_H
+#define EPOCH_H
+
+#include <atomic>
+#include <cstdint>
+#include <stdexcept>
+#include <vector>
+
+/**
+* Epoch-based reclamation for structures that one writer changes while
+* readers walk them without locks. A reader announces the global epoch
+* while it is inside a read; the writer retires unlinked memory instead of
+* freeing it, tagged with the epoch of the moment it was retired.
+* collect() advances the epoch and frees whatever was retired before the
+* oldest epoch a reader still announces, since no reader that could have
+* seen it is left.
+*
+* Readers register once per thread through a Reader object. retire() and
+* collect() belong to a single writer and must not be called concurrently.
+* When several threads unlink memory, each retires through its own Reader
+* instead; those lists live in the reader's slot and outlast the Reader, so
+* whoever claims the slot next frees them.
+*/
+class EpochReclaimer
+{
+public:
+    explicit EpochReclaimer(size_t maxReaders = 64) :
+        epoch_(1), slots_(maxReaders == 0 ? 1 : maxReaders)
+    {
+    }
+
+    ~EpochReclaimer()
+    {
+        freeBefore(retired_, UINT64_MAX);
+        for (size_t i = 0; i < slots_.size(); ++i) {
+            freeBefore(slots_[i].retired, UINT64_MAX);
+        }
+    }
+
+    // A registered reader; one per thread, used by one thread at a time
+    class Reader
+    {
+    public:
+        explicit Reader(EpochReclaimer& owner) : owner_(owner), slot_(owner.claimSlot()) {}
+        ~Reader() { owner_.slots_[slot_].inUse.store(false); }
+
+        void enter() { owner_.slots_[slot_].epoch.store(owner_.epoch_.load()); }
+        void exit() { owner_.slots_[slot_].epoch.store(0, std::memory_order_release); }
+
+        // Like the reclaimer's own retire() and collect(), but safe to call
+        // from every registered thread at once
+        void retire(void* p, void (*deleter)(void*))
+        {
+            Retired r = { p, deleter, owner_.epoch_.load() };
+            owner_.slots_[slot_].retired.push_back(r);
+        }
+        size_t collect() { return freeBefore(owner_.slots_[slot_].retired, owner_.advance()); }
+        size_t pending() const { return owner_.slots_[slot_].retired.size(); }
+
+    private:
+        Reader(const Reader&);            // not copyable, it owns a slot
+        Reader& operator=(const Reader&);
+        EpochReclaimer& owner_;
+        size_t slot_;
+    };
+
+    // Keeps reader inside a read for its lifetime
+    class Guard
+    {
+    public:
+        explicit Guard(Reader& reader) : reader_(reader) { reader_.enter(); }
+        ~Guard() { reader_.exit(); }
+    private:
+        Guard(const Guard&);
+        Guard& operator=(const Guard&);
+        Reader& reader_;
+    };
+
+    /**
+    * Hands p to the reclaimer once it can no longer be reached from the
+    * structure; deleter(p) runs after every read that might still see it.
+    */
+    void retire(void* p, void (*deleter)(void*))
+    {
+        Retired r = { p, deleter, epoch_.load() };
+        retired_.push_back(r);
+    }
+
+    /**
+    * Frees what no reader can still see and returns how many were freed.
+    */
+    size_t collect()
+    {
+        return freeBefore(retired_, advance());
+    }
+
+    size_t pending() const { return retired_.size(); } // Retired but not freed yet
+
+private:
+    struct Retired
+    {
+        void* ptr;
+        void (*deleter)(void*);
+        uint64_t epoch;
+    };
+
+    // Padded to a cache line so readers do not slow each other down
+    struct Slot
+    {
+        Slot() : epoch(0), inUse(false) {}
+        std::atomic<uint64_t> epoch; // 0 outside a read
+        std::atomic<bool> inUse;
+        std::vector<Retired> retired; // Touched only by the reader holding the slot
+        char pad[64 - sizeof(std::atomic<uint64_t>) - sizeof(std::atomic<bool>) - sizeof(std::vector<Retired>)];
+    };
+
+    /**
+    * Moves the epoch on and returns the oldest one a reader still announces.
+    * Whatever was retired before it is unreachable by every reader.
+    */
+    uint64_t advance()
+    {
+        uint64_t oldest = epoch_.fetch_add(1) + 1;
+        for (size_t i = 0; i < slots_.size(); ++i) {
+            uint64_t e = slots_[i].epoch.load();
+            if (e != 0 && e < oldest) {
+                oldest = e;
+            }
+        }
+        return oldest;
+    }
+
+    static size_t freeBefore(std::vector<Retired>& list, uint64_t oldest)
+    {
+        size_t kept = 0;
+        size_t freed = 0;
+        for (size_t i = 0; i < list.size(); ++i) {
+            if (list[i].epoch < oldest) {
+                list[i].deleter(list[i].ptr);
+                ++freed;
+            }
+            else {
+                list[kept++] = list[i];
+            }
+        }
+        list.resize(kept);
+        return freed;
+    }
+
+    size_t claimSlot()
+    {
+        for (size_t i = 0; i < slots_.size(); ++i) {
+            bool expected = false;
+            if (slots_[i].inUse.compare_exchange_strong(expected, true)) {
+                return i;
+            }
+        }
+        throw std::runtime_error("EpochReclaimer: too many readers");
+    }
+
+    EpochReclaimer(const EpochReclaimer&);            // not copyable
+    EpochReclaimer& operator=(const EpochReclaimer&);
+
+    std::atomic<uint64_t> epoch_;
+    std::vector<Slot> slots_;
+    std::vector<Retired> retired_;
+};
+
+#endif
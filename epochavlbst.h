@@ -0,0 +1,275 @@
+#ifndef EPOCHAVLBST_H
+#define EPOCHAVLBST_H
+
+#include <iostream>
+#include <exception>
+#include <cstdlib>
+#include <atomic>
+#include "avlbst.h"
+#include "epoch.h"
+
+/**
+* An AVL tree that one writer changes through insert() and remove() while
+* any number of threads call find() without taking a lock. Removed nodes
+* are retired to an EpochReclaimer rather than deleted, so a reader never
+* touches freed memory. New nodes are fully built before a release store
+* links them in, and overwriting a key swaps in a new node instead of
+* writing the value in place, so a reader sees either the old or the new
+* value and never half of one.
+*
+* Rotations and unlinks move live nodes and can send a reader down the
+* wrong side for a moment. They are bracketed by a version counter, and a
+* find() that misses while one was running is retried. A hit is always
+* correct, so a find() that succeeds never waits. Readers load links
+* with acquire and every link the writer changes, in rotations, unlinks
+* and node swaps alike, goes through a release store (Node::setLeft,
+* setRight and setRoot).
+*
+* Every other mutator (erase, extract, merge, clear, lazy deletion and so
+* on) frees nodes directly and must not run while readers are active.
+*/
+template <class Key, class Value>
+class EpochAVLTree : public AVLTree<Key, Value>
+{
+public:
+    typedef EpochReclaimer::Reader Reader;
+
+    explicit EpochAVLTree(size_t maxReaders = 64);
+    virtual ~EpochAVLTree();
+
+    // Writer side, one thread at a time
+    using AVLTree<Key, Value>::insert;
+    virtual void insert(const std::pair<const Key, Value>& new_item);
+    virtual void remove(const Key& key);
+    size_t collect(); // Frees retired nodes no reader can still see
+
+    // Reader side: each thread registers its own Reader with reclaimer()
+    using AVLTree<Key, Value>::find; // The iterator version is writer side
+    bool find(const Key& key, Value& value, Reader& reader) const; // Copies the value out on a hit
+    EpochReclaimer& reclaimer();
+    size_t retiredCount() const; // Retired nodes waiting for readers to move on
+
+protected:
+    virtual void rotateRight (Node<Key, Value>* g);
+    virtual void rotateLeft (Node<Key, Value>* g);
+
+    void replaceNode(Node<Key, Value>* old, const Value& value); // Copy-on-write overwrite
+    void publish(Node<Key, Value>* parent, Node<Key, Value>* old, Node<Key, Value>* n); // Points parent (or root_) at n
+    void retire(Node<Key, Value>* n);
+    void beginChange();
+    void endChange();
+    static void deleteNode(void* p);
+    static Node<Key, Value>* load(Node<Key, Value>* const* link);
+
+    static const int kMaxDepth = 128; // Deeper than any AVL tree, so a longer walk met a cycle mid-change
+    static const size_t kCollectEvery = 64; // Retired nodes between automatic collect() calls
+
+    mutable EpochReclaimer epochs_;
+    std::atomic<uint64_t> version_; // Odd while nodes are being moved
+    int changeDepth_; // Nesting of beginChange, writer only
+};
+
+/*
+------------------------------------------------
+Begin implementations for the EpochAVLTree class.
+------------------------------------------------
+*/
+
+template<class Key, class Value>
+EpochAVLTree<Key, Value>::EpochAVLTree(size_t maxReaders) :
+    epochs_(maxReaders), version_(0), changeDepth_(0)
+{
+}
+
+template<class Key, class Value>
+EpochAVLTree<Key, Value>::~EpochAVLTree()
+{
+}
+
+/**
+* A new key becomes a leaf that is published in one store; an existing one
+* gets a fresh node. Rebalancing afterwards is bracketed by the rotations.
+*/
+template<class Key, class Value>
+void EpochAVLTree<Key, Value>::insert(const std::pair<const Key, Value>& new_item)
+{
+    Node<Key, Value>* parent;
+    Node<Key, Value>* existing = this->findSlot(new_item.first, parent);
+    if (existing != nullptr) {
+        replaceNode(existing, new_item.second);
+        return;
+    }
+    Node<Key, Value>* n = this->createNode(new_item.first, new_item.second, static_cast<AVLNode<Key, Value>*>(parent));
+    publish(parent, nullptr, n);
+    ++this->size_;
+    if (parent != nullptr) {
+        this->leafAdded(parent);
+    }
+}
+
+template<class Key, class Value>
+void EpochAVLTree<Key, Value>::remove(const Key& key)
+{
+    Node<Key, Value>* parent;
+    Node<Key, Value>* n = this->findSlot(key, parent);
+    if (n == nullptr) {
+        return;
+    }
+    this->evictCached(key);
+    beginChange();
+    this->unlinkNode(n);
+    endChange();
+    retire(n);
+}
+
+template<class Key, class Value>
+size_t EpochAVLTree<Key, Value>::collect()
+{
+    return epochs_.collect();
+}
+
+/**
+* Keys and values of a published node never change, so a hit can be copied
+* out as is. A miss only counts if no node moved during the walk.
+*/
+template<class Key, class Value>
+bool EpochAVLTree<Key, Value>::find(const Key& key, Value& value, Reader& reader) const
+{
+    EpochReclaimer::Guard guard(reader);
+    while (true) {
+        uint64_t before = version_.load(std::memory_order_acquire);
+        Node<Key, Value>* current = load(&this->root_);
+        int depth = 0;
+        while (current != nullptr && depth++ < kMaxDepth) {
+            const Key& k = current->getKey();
+            if (key == k) {
+                value = current->getValue();
+                return true;
+            }
+            current = load(key < k ? &current->left_ : &current->right_);
+        }
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (current == nullptr && (before & 1) == 0 && version_.load(std::memory_order_relaxed) == before) {
+            return false;
+        }
+    }
+}
+
+template<class Key, class Value>
+EpochReclaimer& EpochAVLTree<Key, Value>::reclaimer()
+{
+    return epochs_;
+}
+
+template<class Key, class Value>
+size_t EpochAVLTree<Key, Value>::retiredCount() const
+{
+    return epochs_.pending();
+}
+
+template<class Key, class Value>
+void EpochAVLTree<Key, Value>::rotateRight(Node<Key, Value>* g)
+{
+    beginChange();
+    AVLTree<Key, Value>::rotateRight(g);
+    endChange();
+}
+
+template<class Key, class Value>
+void EpochAVLTree<Key, Value>::rotateLeft(Node<Key, Value>* g)
+{
+    beginChange();
+    AVLTree<Key, Value>::rotateLeft(g);
+    endChange();
+}
+
+/**
+* The copy takes over old's links and balance before it is published, so
+* a reader standing on old still finds valid children below it.
+*/
+template<class Key, class Value>
+void EpochAVLTree<Key, Value>::replaceNode(Node<Key, Value>* old, const Value& value)
+{
+    Node<Key, Value>* parent = old->getParent();
+    AVLNode<Key, Value>* n = this->createNode(old->getKey(), value, static_cast<AVLNode<Key, Value>*>(parent));
+    n->setBalance(static_cast<AVLNode<Key, Value>*>(old)->getBalance());
+    n->setLeft(old->getLeft());
+    n->setRight(old->getRight());
+    this->evictCached(old->getKey());
+    publish(parent, old, n);
+    if (n->getLeft() != nullptr) {
+        n->getLeft()->setParent(n);
+    }
+    if (n->getRight() != nullptr) {
+        n->getRight()->setParent(n);
+    }
+    retire(old);
+}
+
+template<class Key, class Value>
+void EpochAVLTree<Key, Value>::publish(Node<Key, Value>* parent, Node<Key, Value>* old, Node<Key, Value>* n)
+{
+    Node<Key, Value>** link;
+    if (parent == nullptr) {
+        link = &this->root_;
+    }
+    else if (old != nullptr) {
+        link = (parent->left_ == old) ? &parent->left_ : &parent->right_;
+    }
+    else {
+        link = (n->getKey() < parent->getKey()) ? &parent->left_ : &parent->right_;
+    }
+    __atomic_store_n(link, n, __ATOMIC_RELEASE);
+}
+
+template<class Key, class Value>
+void EpochAVLTree<Key, Value>::retire(Node<Key, Value>* n)
+{
+    epochs_.retire(n, &EpochAVLTree<Key, Value>::deleteNode);
+    if (epochs_.pending() >= kCollectEvery) {
+        epochs_.collect();
+    }
+}
+
+/**
+* The first begin makes the version odd and the matching end makes it even
+* again; nested calls only count. The fence keeps the odd version ahead of
+* the link stores that follow, so a reader that saw any of them also sees
+* the change in progress when it checks the version again.
+*/
+template<class Key, class Value>
+void EpochAVLTree<Key, Value>::beginChange()
+{
+    if (changeDepth_++ == 0) {
+        version_.fetch_add(1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+    }
+}
+
+template<class Key, class Value>
+void EpochAVLTree<Key, Value>::endChange()
+{
+    if (--changeDepth_ == 0) {
+        version_.fetch_add(1, std::memory_order_release);
+    }
+}
+
+template<class Key, class Value>
+void EpochAVLTree<Key, Value>::deleteNode(void* p)
+{
+    delete static_cast<Node<Key, Value>*>(p);
+}
+
+template<class Key, class Value>
+Node<Key, Value>* EpochAVLTree<Key, Value>::load(Node<Key, Value>* const* link)
+{
+    return __atomic_load_n(link, __ATOMIC_ACQUIRE);
+}
+
+/*
+----------------------------------------------
+End implementations for the EpochAVLTree class.
+----------------------------------------------
+*/
+
+#endif
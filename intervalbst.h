@@ -0,0 +1,172 @@
+#ifndef INTERVALBST_H
+#define INTERVALBST_H
+
+#include <iostream>
+#include <exception>
+#include <cstdlib>
+#include <vector>
+#include "augmentedavlbst.h"
+
+/**
+* A half-open interval [lo, hi), ordered by lo and then hi. Printable so
+* the tree's print() works.
+*/
+template <typename Point>
+struct Interval
+{
+    Interval() : lo(), hi() {}
+    Interval(const Point& l, const Point& h) : lo(l), hi(h) {}
+    Point lo;
+    Point hi;
+};
+
+template <typename Point>
+bool operator<(const Interval<Point>& a, const Interval<Point>& b)
+{
+    return a.lo < b.lo || (!(b.lo < a.lo) && a.hi < b.hi);
+}
+
+template <typename Point>
+bool operator>(const Interval<Point>& a, const Interval<Point>& b)
+{
+    return b < a;
+}
+
+template <typename Point>
+bool operator==(const Interval<Point>& a, const Interval<Point>& b)
+{
+    return !(a < b) && !(b < a);
+}
+
+template <typename Point>
+bool operator!=(const Interval<Point>& a, const Interval<Point>& b)
+{
+    return !(a == b);
+}
+
+template <typename Point>
+std::ostream& operator<<(std::ostream& os, const Interval<Point>& interval)
+{
+    return os << '[' << interval.lo << ", " << interval.hi << ')';
+}
+
+/**
+* Summarizes a subtree of intervals by its largest end point. The flag is
+* false for an empty subtree, so Point needs nothing beyond operator<.
+*/
+template <typename Point>
+struct MaxEndMonoid
+{
+    typedef std::pair<bool, Point> Summary;
+    static Summary identity() { return Summary(false, Point()); }
+    template<typename Item>
+    static Summary lift(const Item& item) { return Summary(true, item.first.hi); }
+    static Summary combine(const Summary& a, const Summary& b)
+    {
+        if (!a.first) {
+            return b;
+        }
+        if (!b.first) {
+            return a;
+        }
+        return (a.second < b.second) ? b : a;
+    }
+};
+
+/**
+* An AVL tree of half-open intervals [lo, hi), keyed by the whole interval
+* so several intervals may share a start. Every node also knows the largest end point
+* in its subtree, which lets overlap queries skip any subtree that ends
+* before the query starts and, being ordered by start, any right subtree
+* that begins after it ends.
+*/
+template <typename Point, typename Value>
+class IntervalTree : public AugmentedAVLTree<Interval<Point>, Value, MaxEndMonoid<Point> >
+{
+public:
+    typedef AugmentedAVLTree<Interval<Point>, Value, MaxEndMonoid<Point> > Base;
+    typedef typename Base::iterator iterator;
+
+    using Base::insert;
+    using Base::remove;
+    void insert(const Point& lo, const Point& hi, const Value& value);
+    void remove(const Point& lo, const Point& hi);
+
+    // Append the matching intervals to out in key order
+    void overlapping(const Point& lo, const Point& hi, std::vector<iterator>& out) const; // Overlaps [lo, hi)
+    void containing(const Point& point, std::vector<iterator>& out) const; // lo <= point < hi
+
+protected:
+    typedef AugmentedAVLNode<Interval<Point>, Value, MaxEndMonoid<Point> > INode;
+
+    void overlapHelper(Node<Interval<Point>, Value>* node, const Point& lo, const Point& hi,
+                       bool pointQuery, std::vector<iterator>& out) const;
+};
+
+/*
+------------------------------------------------
+Begin implementations for the IntervalTree class.
+------------------------------------------------
+*/
+
+template<class Point, class Value>
+void IntervalTree<Point, Value>::insert(const Point& lo, const Point& hi, const Value& value)
+{
+    Base::insert(std::make_pair(Interval<Point>(lo, hi), value));
+}
+
+template<class Point, class Value>
+void IntervalTree<Point, Value>::remove(const Point& lo, const Point& hi)
+{
+    Base::remove(Interval<Point>(lo, hi));
+}
+
+template<class Point, class Value>
+void IntervalTree<Point, Value>::overlapping(const Point& lo, const Point& hi, std::vector<iterator>& out) const
+{
+    overlapHelper(this->root_, lo, hi, false, out);
+}
+
+template<class Point, class Value>
+void IntervalTree<Point, Value>::containing(const Point& point, std::vector<iterator>& out) const
+{
+    overlapHelper(this->root_, point, point, true, out);
+}
+
+/**
+* In-order walk that prunes a subtree whose largest end is not past lo (or
+* that holds only tombstones), and the right subtree of any node that
+* starts at or after hi. A point query
+* is the same walk with lo == hi, where a start equal to the point is
+* still a match.
+*/
+template<class Point, class Value>
+void IntervalTree<Point, Value>::overlapHelper(Node<Interval<Point>, Value>* node, const Point& lo, const Point& hi,
+                                               bool pointQuery, std::vector<iterator>& out) const
+{
+    if (node == nullptr) {
+        return;
+    }
+    typename MaxEndMonoid<Point>::Summary maxEnd = INode::summaryOf(node);
+    if (!maxEnd.first || !(lo < maxEnd.second)) {
+        return;
+    }
+    overlapHelper(node->left_, lo, hi, pointQuery, out);
+    const Interval<Point>& interval = node->getKey();
+    bool startsInside = pointQuery ? !(hi < interval.lo) : (interval.lo < hi);
+    if (!startsInside) {
+        return;
+    }
+    if (lo < interval.hi && !node->isTombstone()) {
+        out.push_back(this->iteratorAt(node));
+    }
+    overlapHelper(node->right_, lo, hi, pointQuery, out);
+}
+
+/*
+----------------------------------------------
+End implementations for the IntervalTree class.
+----------------------------------------------
+*/
+
+#endif
@@ -0,0 +1,122 @@
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <thread>
+#include <atomic>
+#include <pthread.h>
+#include "bst.h"
+#include "lockfreebst.h"
+#include "bench-util.h"
+
+using namespace std;
+
+// Usage: lockfree-bench [num_keys] [max_threads] [update_percent] [ms_per_run]
+// Every thread runs the same mix of finds, inserts and removes over keys
+// drawn uniformly from [0, 2 * num_keys), starting from a tree holding half
+// of them. LockFreeBST is compared with a BinarySearchTree behind one
+// reader-writer lock; the thread count doubles from 1 up to max_threads.
+
+template<typename Work>
+static double runThreads(unsigned threads, int ms, Work work)
+{
+    atomic<bool> stop(false);
+    atomic<long> ops(0);
+    vector<thread> pool;
+    BenchTimer timer;
+    for (unsigned t = 0; t < threads; ++t) {
+        pool.push_back(thread([&, t]() {
+            ops += work(t, stop);
+        }));
+    }
+    while (timer.elapsedMs() < ms) {
+        this_thread::sleep_for(chrono::milliseconds(1));
+    }
+    stop.store(true);
+    for (size_t i = 0; i < pool.size(); ++i) {
+        pool[i].join();
+    }
+    return ops.load() / timer.elapsedMs();
+}
+
+int main(int argc, char *argv[])
+{
+    int n = (int) benchArg(argc, argv, 1, 1000000);
+    unsigned maxThreads = (unsigned) benchArg(argc, argv, 2, 64);
+    unsigned updates = (unsigned) benchArg(argc, argv, 3, 20);
+    int ms = (int) benchArg(argc, argv, 4, 1000);
+    vector<int> keys = makeShuffledKeys(2 * n, 1);
+    vector<int> trace = makeUniformTrace(2 * n, 1 << 20, 2);
+
+    cout << n << " keys, " << updates << "% updates, " << thread::hardware_concurrency() << " hardware threads, " << ms << " ms per run" << endl;
+    cout << fixed << setprecision(0);
+    cout << "threads  LockFreeBST ops/ms  rwlock BST ops/ms" << endl;
+    for (unsigned threads = 1; threads <= maxThreads; threads *= 2) {
+        double lockFree;
+        {
+            LockFreeBST<int, int> tree(threads + 1);
+            {
+                LockFreeBST<int, int>::Handle handle(tree.reclaimer());
+                for (int i = 0; i < n; ++i) {
+                    tree.insert(make_pair(keys[i], keys[i]), handle);
+                }
+            }
+            lockFree = runThreads(threads, ms, [&](unsigned id, atomic<bool>& stop) {
+                LockFreeBST<int, int>::Handle handle(tree.reclaimer());
+                long count = 0;
+                size_t i = id * 7919;
+                int value;
+                while (!stop.load(memory_order_relaxed)) {
+                    int k = trace[i++ & (trace.size() - 1)];
+                    unsigned roll = (unsigned) (i * 2654435761u) % 100;
+                    if (roll < updates / 2) {
+                        tree.insert(make_pair(k, k), handle);
+                    }
+                    else if (roll < updates) {
+                        tree.remove(k, handle);
+                    }
+                    else {
+                        tree.find(k, value, handle);
+                    }
+                    ++count;
+                }
+                return count;
+            });
+        }
+        double locked;
+        {
+            BinarySearchTree<int, int> tree;
+            pthread_rwlock_t lock;
+            pthread_rwlock_init(&lock, NULL);
+            for (int i = 0; i < n; ++i) {
+                tree.insert(make_pair(keys[i], keys[i]));
+            }
+            locked = runThreads(threads, ms, [&](unsigned id, atomic<bool>& stop) {
+                long count = 0;
+                size_t i = id * 7919;
+                while (!stop.load(memory_order_relaxed)) {
+                    int k = trace[i++ & (trace.size() - 1)];
+                    unsigned roll = (unsigned) (i * 2654435761u) % 100;
+                    if (roll < updates) {
+                        pthread_rwlock_wrlock(&lock);
+                        if (roll < updates / 2) {
+                            tree.insert(make_pair(k, k));
+                        }
+                        else {
+                            tree.remove(k);
+                        }
+                    }
+                    else {
+                        pthread_rwlock_rdlock(&lock);
+                        tree.find(k);
+                    }
+                    pthread_rwlock_unlock(&lock);
+                    ++count;
+                }
+                return count;
+            });
+            pthread_rwlock_destroy(&lock);
+        }
+        cout << setw(7) << threads << "  " << setw(18) << lockFree << "  " << setw(17) << locked << endl;
+    }
+    return 0;
+}
@@ -0,0 +1,345 @@
+#include <iostream>
+#include <cstdlib>
+#include <map>
+#include <random>
+#include <vector>
+#include <thread>
+#include <atomic>
+#include "lockfreebst.h"
+#include "bench-util.h"
+
+using namespace std;
+
+// Usage: lockfree-stress-test [churn_ms] [threads] [rounds]
+// Three checks of LockFreeBST:
+//  - one thread against std::map, including iteration and size();
+//  - threads threads inserting, removing, finding and iterating over the
+//    same keys for churn_ms. Even keys are never removed, so every find or
+//    scan must see them, and every value must belong to its key;
+//  - rounds short rounds of four threads on two keys, with each round's
+//    history checked for linearizability by exhaustive search.
+// Key comparisons sometimes yield, so threads interleave mid-update even
+// on a single core. Build with
+//   make lockfree-stress-test CXXFLAGS="-g -std=c++11 -pthread -fsanitize=thread"
+// (or -fsanitize=address) to have the sanitizer check the same runs.
+
+struct YieldingKey
+{
+    int k;
+    YieldingKey() : k(0) {}
+    YieldingKey(int key) : k(key) {}
+    bool operator<(const YieldingKey& rhs) const { maybeYield(); return k < rhs.k; }
+    bool operator==(const YieldingKey& rhs) const { maybeYield(); return k == rhs.k; }
+    static void maybeYield()
+    {
+        static thread_local unsigned seed = 12345;
+        seed = seed * 1103515245 + 12345;
+        if ((seed >> 16) % 3 == 0) {
+            this_thread::yield();
+        }
+    }
+};
+
+typedef LockFreeBST<YieldingKey, int> Tree;
+
+static bool fail(const char* what)
+{
+    cout << "FAILED: " << what << endl;
+    return false;
+}
+
+static bool singleThreaded()
+{
+    LockFreeBST<int, int> tree;
+    LockFreeBST<int, int>::Handle handle(tree.reclaimer());
+    map<int, int> expected;
+    mt19937 rng(5);
+    for (int i = 0; i < 200000; ++i) {
+        int k = rng() % 500;
+        unsigned op = rng() % 3;
+        if (op == 0) {
+            bool isNew = expected.find(k) == expected.end();
+            expected[k] = i;
+            if (tree.insert(make_pair(k, i), handle) != isNew) {
+                return fail("insert result");
+            }
+        }
+        else if (op == 1) {
+            bool had = expected.erase(k) > 0;
+            if (tree.remove(k, handle) != had) {
+                return fail("remove result");
+            }
+        }
+        else {
+            int value = -1;
+            bool hit = tree.find(k, value, handle);
+            map<int, int>::iterator it = expected.find(k);
+            if (hit != (it != expected.end()) || (hit && value != it->second)) {
+                return fail("find");
+            }
+        }
+        if (i % 5000 == 0) {
+            map<int, int>::iterator e = expected.begin();
+            for (LockFreeBST<int, int>::iterator it = tree.begin(handle); it != tree.end(); ++it, ++e) {
+                if (e == expected.end() || e->first != it->first || e->second != it->second) {
+                    return fail("iteration");
+                }
+            }
+            if (e != expected.end() || tree.size() != expected.size()) {
+                return fail("size");
+            }
+        }
+    }
+    cout << "single thread: ok" << endl;
+    return true;
+}
+
+static bool churn(int ms, unsigned threads)
+{
+    const int kKeys = 2000;
+    Tree tree(threads + 1);
+    {
+        Tree::Handle handle(tree.reclaimer());
+        for (int k = 0; k < kKeys; k += 2) {
+            tree.insert(make_pair(YieldingKey(k), k * 1000), handle);
+        }
+    }
+    atomic<bool> stop(false);
+    atomic<long> finds(0), scans(0), errors(0);
+    vector<thread> pool;
+    for (unsigned id = 0; id < threads; ++id) {
+        pool.push_back(thread([&, id]() {
+            Tree::Handle handle(tree.reclaimer());
+            mt19937 rng(id + 11);
+            while (!stop.load(memory_order_relaxed)) {
+                int k = rng() % kKeys;
+                unsigned op = rng() % 4;
+                if (op == 0) {
+                    tree.insert(make_pair(YieldingKey(k), k * 1000 + (int) (rng() % 1000)), handle);
+                }
+                else if (op == 1) {
+                    if (k % 2 != 0) {
+                        tree.remove(k, handle);
+                    }
+                }
+                else if (op == 2) {
+                    int value;
+                    bool hit = tree.find(k, value, handle);
+                    if ((k % 2 == 0 && !hit) || (hit && value / 1000 != k)) {
+                        ++errors;
+                    }
+                    ++finds;
+                }
+                else if (rng() % 1024 == 0) {
+                    int prev = -1, stable = 0;
+                    for (Tree::iterator it = tree.begin(handle); it != tree.end(); ++it) {
+                        if (it->first.k <= prev || it->second / 1000 != it->first.k) {
+                            ++errors;
+                        }
+                        stable += it->first.k % 2 == 0;
+                        prev = it->first.k;
+                    }
+                    if (stable != kKeys / 2) {
+                        ++errors;
+                    }
+                    ++scans;
+                }
+            }
+        }));
+    }
+    BenchTimer timer;
+    while (timer.elapsedMs() < ms && errors.load() == 0) {
+        this_thread::sleep_for(chrono::milliseconds(10));
+    }
+    stop.store(true);
+    for (size_t i = 0; i < pool.size(); ++i) {
+        pool[i].join();
+    }
+    Tree::Handle handle(tree.reclaimer());
+    size_t count = 0;
+    for (Tree::iterator it = tree.begin(handle); it != tree.end(); ++it) {
+        ++count;
+    }
+    cout << "churn: " << threads << " threads, " << finds.load() << " finds, " << scans.load()
+         << " scans, " << errors.load() << " errors" << endl;
+    if (errors.load() != 0) {
+        return fail("missing key, torn value or bad scan");
+    }
+    return count == tree.size() || fail("size after churn");
+}
+
+/**
+* One completed call in a history. inv and res come from a shared counter
+* read right before the call and right after it returned, so a call must
+* take effect somewhere in between.
+*/
+struct Call
+{
+    enum Type { Insert, Remove, Find };
+    Type type;
+    int key;
+    int arg;   // Value passed to insert
+    bool ok;   // What the call returned
+    int out;   // Value find copied out
+    long inv;
+    long res;
+};
+
+struct KeyState
+{
+    bool present;
+    int value;
+};
+
+// Runs c against s as a sequential map would; false if c's result disagrees
+static bool applyCall(const Call& c, KeyState& s)
+{
+    if (c.type == Call::Insert) {
+        if (c.ok == s.present) {
+            return false;
+        }
+        s.present = true;
+        s.value = c.arg;
+        return true;
+    }
+    if (c.ok != s.present) {
+        return false;
+    }
+    if (c.type == Call::Remove) {
+        s.present = false;
+        return true;
+    }
+    return !c.ok || c.out == s.value;
+}
+
+/**
+* Looks for an order of the remaining calls that a sequential map could
+* have produced. Only calls invoked before every remaining call returned
+* may go next, which is what keeps the order consistent with real time.
+*/
+static bool linearize(const vector<Call>& calls, vector<bool>& done, const KeyState& s, size_t left)
+{
+    if (left == 0) {
+        return true;
+    }
+    long firstReturn = -1;
+    for (size_t i = 0; i < calls.size(); ++i) {
+        if (!done[i] && (firstReturn < 0 || calls[i].res < firstReturn)) {
+            firstReturn = calls[i].res;
+        }
+    }
+    for (size_t i = 0; i < calls.size(); ++i) {
+        KeyState next = s;
+        if (done[i] || calls[i].inv > firstReturn || !applyCall(calls[i], next)) {
+            continue;
+        }
+        done[i] = true;
+        if (linearize(calls, done, next, left - 1)) {
+            return true;
+        }
+        done[i] = false;
+    }
+    return false;
+}
+
+static bool linearizable(int rounds)
+{
+    const int kThreads = 4, kCallsPerRound = 4;
+    Tree tree(kThreads + 1);
+    vector<vector<Call> > logs(kThreads);
+    atomic<long> ticks(0);
+    atomic<int> arrived(0), phase(0), nextValue(1);
+    vector<thread> pool;
+    for (int id = 0; id < kThreads; ++id) {
+        pool.push_back(thread([&, id]() {
+            Tree::Handle handle(tree.reclaimer());
+            mt19937 rng(id * 7 + 1);
+            for (int r = 0; r < rounds; ++r) {
+                while (phase.load() < 2 * r + 1) {
+                    this_thread::yield();
+                }
+                logs[id].clear();
+                for (int i = 0; i < kCallsPerRound; ++i) {
+                    Call c;
+                    c.type = static_cast<Call::Type>(rng() % 3);
+                    c.key = rng() % 2;
+                    c.arg = nextValue++;
+                    c.out = -1;
+                    c.inv = ticks++;
+                    if (c.type == Call::Insert) {
+                        c.ok = tree.insert(make_pair(YieldingKey(c.key), c.arg), handle);
+                    }
+                    else if (c.type == Call::Remove) {
+                        c.ok = tree.remove(c.key, handle);
+                    }
+                    else {
+                        c.ok = tree.find(c.key, c.out, handle);
+                    }
+                    c.res = ticks++;
+                    logs[id].push_back(c);
+                    if (rng() % 2) {
+                        this_thread::yield();
+                    }
+                }
+                ++arrived;
+                while (phase.load() < 2 * r + 2) {
+                    this_thread::yield();
+                }
+            }
+        }));
+    }
+    Tree::Handle handle(tree.reclaimer());
+    long overlapping = 0;
+    for (int r = 0; r < rounds; ++r) {
+        KeyState start[2];
+        for (int k = 0; k < 2; ++k) {
+            start[k].present = tree.find(k, start[k].value, handle);
+        }
+        arrived.store(0);
+        phase.store(2 * r + 1);
+        while (arrived.load() != kThreads) {
+            this_thread::yield();
+        }
+        // Calls on different keys commute, so each key is checked alone
+        for (int k = 0; k < 2; ++k) {
+            vector<Call> calls;
+            for (int id = 0; id < kThreads; ++id) {
+                for (size_t i = 0; i < logs[id].size(); ++i) {
+                    if (logs[id][i].key == k) {
+                        calls.push_back(logs[id][i]);
+                    }
+                }
+            }
+            for (size_t a = 0; a < calls.size(); ++a) {
+                for (size_t b = a + 1; b < calls.size(); ++b) {
+                    overlapping += calls[a].inv < calls[b].res && calls[b].inv < calls[a].res;
+                }
+            }
+            vector<bool> done(calls.size(), false);
+            if (!linearize(calls, done, start[k], calls.size())) {
+                cout << "round " << r << ", key " << k << " has no sequential order" << endl;
+                fail("history not linearizable");
+                exit(1); // The workers are still waiting for the next round
+            }
+        }
+        phase.store(2 * r + 2);
+    }
+    for (size_t i = 0; i < pool.size(); ++i) {
+        pool[i].join();
+    }
+    cout << "linearizability: " << rounds << " rounds, " << overlapping << " overlapping call pairs" << endl;
+    return true;
+}
+
+int main(int argc, char *argv[])
+{
+    int ms = (int) benchArg(argc, argv, 1, 2000);
+    unsigned threads = (unsigned) benchArg(argc, argv, 2, 8);
+    int rounds = (int) benchArg(argc, argv, 3, 20000);
+
+    if (!singleThreaded() || !churn(ms, threads) || !linearizable(rounds)) {
+        return 1;
+    }
+    cout << "PASSED" << endl;
+    return 0;
+}
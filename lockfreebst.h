@@ -0,0 +1,530 @@
+#ifndef LOCKFREEBST_H
+#define LOCKFREEBST_H
+
+#include <iostream>
+#include <exception>
+#include <cstdlib>
+#include <cstdint>
+#include <atomic>
+#include <utility>
+#include "epoch.h"
+
+/**
+* A lock-free external binary search tree after Natarajan and Mittal, "Fast
+* Concurrent Lock-Free Binary Search Trees" (PPoPP 2014). Items live in the
+* leaves; internal nodes only route. Any number of threads may insert,
+* remove and find at once, and a thread stalled in the middle of an update
+* never stops the others.
+*
+* A remove first flags the edge to its leaf, which is the moment the key
+* leaves the map, and then tags the sibling's edge so neither can change.
+* One compare-and-swap at the nearest untagged edge above then cuts out the
+* parent and moves the sibling up. Any thread that runs into a flagged or
+* tagged edge finishes that cut before retrying its own update. Inserting
+* an existing key swaps in a new leaf, so values are never written in
+* place.
+*
+* The tree is not balanced; like BinarySearchTree it relies on keys
+* arriving in no particular order. Nodes that were cut out are retired to
+* an EpochReclaimer, so every thread that touches the tree registers a
+* Handle first and passes it to each call.
+*/
+template <class Key, class Value>
+class LockFreeBST
+{
+public:
+    typedef EpochReclaimer::Reader Handle; // One per thread, from reclaimer()
+
+    explicit LockFreeBST(size_t maxThreads = 64);
+    ~LockFreeBST();
+
+    bool insert(const std::pair<const Key, Value>& keyValuePair, Handle& handle); // True if the key was new; an existing key gets the new value
+    bool remove(const Key& key, Handle& handle); // True if this call removed the key
+    bool find(const Key& key, Value& value, Handle& handle) const; // Copies the value out on a hit
+    size_t size() const; // Exact only while no update is running
+    bool empty() const;
+    EpochReclaimer& reclaimer();
+
+    /**
+    * A weakly consistent iterator over copies of the items in key order.
+    * Each step looks up the next key after the current one, so it never
+    * holds on to a node and never fails because of concurrent updates. An
+    * item that stays in the tree for the whole walk is always visited, one
+    * that comes or goes during it may or may not be, and no key is visited
+    * twice.
+    */
+    class iterator
+    {
+    public:
+        iterator();
+
+        const std::pair<Key, Value>& operator*() const;
+        const std::pair<Key, Value>* operator->() const;
+
+        bool operator==(const iterator& rhs) const;
+        bool operator!=(const iterator& rhs) const;
+
+        iterator& operator++();
+
+    protected:
+        friend class LockFreeBST<Key, Value>;
+        iterator(const LockFreeBST<Key, Value>* tree, Handle* handle);
+        const LockFreeBST<Key, Value>* tree_;
+        Handle* handle_;
+        std::pair<Key, Value> item_;
+        bool end_;
+    };
+
+    iterator begin(Handle& handle) const;
+    iterator end() const;
+
+protected:
+    static const uintptr_t kFlag = 1; // The leaf below is being removed
+    static const uintptr_t kTag = 2;  // The sibling of a flagged leaf; the edge is frozen
+    static const size_t kCollectEvery = 64; // Nodes a handle retires between automatic collects
+
+    /**
+    * inf ranks the three sentinel keys above every real one, so Key needs
+    * no largest value of its own. Internal nodes copy the key of the leaf
+    * that was split and leave value default constructed.
+    */
+    struct Node
+    {
+        Node(const Key& k, const Value& v, int rank) : key(k), value(v), inf(rank), left(0), right(0) {}
+        Node(const Key& k, int rank, Node* l, Node* r) :
+            key(k), value(), inf(rank), left(reinterpret_cast<uintptr_t>(l)), right(reinterpret_cast<uintptr_t>(r)) {}
+        bool isLeaf() const { return left.load(std::memory_order_relaxed) == 0; }
+        Key key;
+        Value value;
+        int inf;
+        std::atomic<uintptr_t> left;  // Child address with kFlag and kTag in the low bits
+        std::atomic<uintptr_t> right;
+    };
+
+    // Where a seek for a key ended, and the last untagged edge on the way
+    struct SeekRecord
+    {
+        Node* ancestor;
+        Node* successor;
+        Node* parent;
+        Node* leaf;
+    };
+
+    void seek(const Key& key, SeekRecord& record) const;
+    bool cleanup(const Key& key, const SeekRecord& record, Handle& handle);
+    void retireExcised(const Key& key, Node* successor, Node* parent, Node* removed, Handle& handle);
+    bool nextItem(const Key* after, std::pair<Key, Value>& item, Handle& handle) const; // Smallest live key greater than *after
+    void retire(Node* n, Handle& handle);
+    void clearHelper(Node* n);
+    static bool goesLeft(const Key& key, const Node* n);
+    static bool isKey(const Key& key, const Node* n);
+    static std::atomic<uintptr_t>& childLink(Node* n, const Key& key);
+    static Node* address(uintptr_t edge);
+    static void deleteNode(void* p);
+
+    // Not copyable
+    LockFreeBST(const LockFreeBST&);
+    LockFreeBST& operator=(const LockFreeBST&);
+
+    EpochReclaimer epochs_;
+    Node* root_; // Sentinel R; real keys all sit below the left child of its left child
+    std::atomic<long> size_;
+};
+
+/*
+------------------------------------------------------
+Begin implementations for the LockFreeBST::iterator class.
+------------------------------------------------------
+*/
+
+template<class Key, class Value>
+LockFreeBST<Key, Value>::iterator::iterator() :
+    tree_(NULL), handle_(NULL), item_(), end_(true)
+{
+}
+
+template<class Key, class Value>
+LockFreeBST<Key, Value>::iterator::iterator(const LockFreeBST<Key, Value>* tree, Handle* handle) :
+    tree_(tree), handle_(handle), item_(), end_(false)
+{
+    end_ = !tree_->nextItem(NULL, item_, *handle_);
+}
+
+template<class Key, class Value>
+const std::pair<Key, Value>& LockFreeBST<Key, Value>::iterator::operator*() const
+{
+    return item_;
+}
+
+template<class Key, class Value>
+const std::pair<Key, Value>* LockFreeBST<Key, Value>::iterator::operator->() const
+{
+    return &item_;
+}
+
+template<class Key, class Value>
+bool LockFreeBST<Key, Value>::iterator::operator==(const iterator& rhs) const
+{
+    if (end_ || rhs.end_) {
+        return end_ == rhs.end_;
+    }
+    return item_.first == rhs.item_.first;
+}
+
+template<class Key, class Value>
+bool LockFreeBST<Key, Value>::iterator::operator!=(const iterator& rhs) const
+{
+    return !(*this == rhs);
+}
+
+template<class Key, class Value>
+typename LockFreeBST<Key, Value>::iterator& LockFreeBST<Key, Value>::iterator::operator++()
+{
+    Key current = item_.first;
+    end_ = !tree_->nextItem(&current, item_, *handle_);
+    return *this;
+}
+
+/*
+----------------------------------------------------
+End implementations for the LockFreeBST::iterator class.
+----------------------------------------------------
+*/
+
+/*
+-----------------------------------------------
+Begin implementations for the LockFreeBST class.
+-----------------------------------------------
+*/
+
+/**
+* R(inf2) has S(inf1) and leaf inf2 below it; S has leaves inf0 and inf1.
+* The first real key splits leaf inf0, so the tree proper always hangs off
+* S's left edge and seek() never runs out of ancestors.
+*/
+template<class Key, class Value>
+LockFreeBST<Key, Value>::LockFreeBST(size_t maxThreads) :
+    epochs_(maxThreads), root_(NULL), size_(0)
+{
+    Node* s = new Node(Key(), 2, new Node(Key(), Value(), 1), new Node(Key(), Value(), 2));
+    root_ = new Node(Key(), 3, s, new Node(Key(), Value(), 3));
+}
+
+template<class Key, class Value>
+LockFreeBST<Key, Value>::~LockFreeBST()
+{
+    clearHelper(root_);
+}
+
+/**
+* A new key replaces its leaf with a router over the old and the new leaf;
+* an existing key gets a fresh leaf. Either way the one CAS only succeeds
+* on a clean edge, and a dirty one is a remove to help along first.
+*/
+template<class Key, class Value>
+bool LockFreeBST<Key, Value>::insert(const std::pair<const Key, Value>& keyValuePair, Handle& handle)
+{
+    EpochReclaimer::Guard guard(handle);
+    const Key& key = keyValuePair.first;
+    SeekRecord record;
+    while (true) {
+        seek(key, record);
+        Node* leaf = record.leaf;
+        Node* fresh = new Node(key, keyValuePair.second, 0);
+        Node* replacement = fresh;
+        bool isNew = !isKey(key, leaf);
+        if (isNew) {
+            replacement = goesLeft(key, leaf) ? new Node(leaf->key, leaf->inf, fresh, leaf)
+                                              : new Node(key, 0, leaf, fresh);
+        }
+        uintptr_t expected = reinterpret_cast<uintptr_t>(leaf);
+        if (childLink(record.parent, key).compare_exchange_strong(expected, reinterpret_cast<uintptr_t>(replacement))) {
+            if (isNew) {
+                ++size_;
+            }
+            else {
+                retire(leaf, handle);
+            }
+            return isNew;
+        }
+        if (replacement != fresh) {
+            delete replacement; // Never published; deleting a node does not touch its children
+        }
+        delete fresh;
+        if (address(expected) == leaf && (expected & (kFlag | kTag))) {
+            cleanup(key, record, handle);
+        }
+    }
+}
+
+/**
+* Flagging the leaf's edge removes the key; whoever's CAS then cuts the
+* leaf out, this call keeps going until it is gone from the tree.
+*/
+template<class Key, class Value>
+bool LockFreeBST<Key, Value>::remove(const Key& key, Handle& handle)
+{
+    EpochReclaimer::Guard guard(handle);
+    SeekRecord record;
+    Node* target = NULL;
+    while (true) {
+        seek(key, record);
+        if (target == NULL) {
+            Node* leaf = record.leaf;
+            if (!isKey(key, leaf)) {
+                return false;
+            }
+            uintptr_t expected = reinterpret_cast<uintptr_t>(leaf);
+            if (childLink(record.parent, key).compare_exchange_strong(expected, expected | kFlag)) {
+                --size_;
+                target = leaf;
+                if (cleanup(key, record, handle)) {
+                    return true;
+                }
+            }
+            else if (address(expected) == leaf && (expected & (kFlag | kTag))) {
+                cleanup(key, record, handle);
+            }
+        }
+        else if (record.leaf != target || cleanup(key, record, handle)) {
+            return true;
+        }
+    }
+}
+
+/**
+* A leaf whose edge is flagged has already been removed, so it is a miss
+* even though it is still reachable.
+*/
+template<class Key, class Value>
+bool LockFreeBST<Key, Value>::find(const Key& key, Value& value, Handle& handle) const
+{
+    EpochReclaimer::Guard guard(handle);
+    Node* n = root_;
+    uintptr_t edge = 0;
+    while (!n->isLeaf()) {
+        edge = childLink(n, key).load(std::memory_order_acquire);
+        n = address(edge);
+    }
+    if (!isKey(key, n) || (edge & kFlag)) {
+        return false;
+    }
+    value = n->value;
+    return true;
+}
+
+template<class Key, class Value>
+size_t LockFreeBST<Key, Value>::size() const
+{
+    long n = size_.load();
+    return n < 0 ? 0 : (size_t) n;
+}
+
+template<class Key, class Value>
+bool LockFreeBST<Key, Value>::empty() const
+{
+    return size() == 0;
+}
+
+template<class Key, class Value>
+EpochReclaimer& LockFreeBST<Key, Value>::reclaimer()
+{
+    return epochs_;
+}
+
+template<class Key, class Value>
+typename LockFreeBST<Key, Value>::iterator LockFreeBST<Key, Value>::begin(Handle& handle) const
+{
+    return iterator(this, &handle);
+}
+
+template<class Key, class Value>
+typename LockFreeBST<Key, Value>::iterator LockFreeBST<Key, Value>::end() const
+{
+    return iterator();
+}
+
+/**
+* Walks to the leaf for key. ancestor -> successor is the last untagged
+* edge on the way down, so everything from successor to parent is what a
+* cleanup there would cut out.
+*/
+template<class Key, class Value>
+void LockFreeBST<Key, Value>::seek(const Key& key, SeekRecord& record) const
+{
+    Node* s = address(root_->left.load(std::memory_order_acquire));
+    record.ancestor = root_;
+    record.successor = s;
+    record.parent = s;
+    uintptr_t parentEdge = s->left.load(std::memory_order_acquire);
+    record.leaf = address(parentEdge);
+    uintptr_t currentEdge = childLink(record.leaf, key).load(std::memory_order_acquire);
+    Node* current = address(currentEdge);
+    while (current != NULL) {
+        if (!(parentEdge & kTag)) {
+            record.ancestor = record.parent;
+            record.successor = record.leaf;
+        }
+        record.parent = record.leaf;
+        record.leaf = current;
+        parentEdge = currentEdge;
+        currentEdge = childLink(current, key).load(std::memory_order_acquire);
+        current = address(currentEdge);
+    }
+}
+
+/**
+* Freezes parent by tagging the edge to the leaf that stays, then swings
+* ancestor's edge from successor straight to that leaf or subtree. It
+* keeps its flag, if it has one, so a remove pending on it still finishes.
+*/
+template<class Key, class Value>
+bool LockFreeBST<Key, Value>::cleanup(const Key& key, const SeekRecord& record, Handle& handle)
+{
+    Node* parent = record.parent;
+    std::atomic<uintptr_t>* keep = goesLeft(key, parent) ? &parent->right : &parent->left;
+    std::atomic<uintptr_t>* gone = goesLeft(key, parent) ? &parent->left : &parent->right;
+    if (!(gone->load() & kFlag)) {
+        std::swap(keep, gone); // The flagged leaf is the other one
+    }
+    keep->fetch_or(kTag);
+    uintptr_t kept = keep->load() & ~kTag;
+    uintptr_t expected = reinterpret_cast<uintptr_t>(record.successor);
+    if (!childLink(record.ancestor, key).compare_exchange_strong(expected, kept)) {
+        return false;
+    }
+    retireExcised(key, record.successor, parent, address(gone->load()), handle);
+    return true;
+}
+
+/**
+* Every edge from successor down to parent is tagged, and a tag is only set
+* beside a flagged leaf, so each router on that path takes one removed
+* leaf with it. All of those edges are frozen, so the path can be walked
+* again after the cut.
+*/
+template<class Key, class Value>
+void LockFreeBST<Key, Value>::retireExcised(const Key& key, Node* successor, Node* parent, Node* removed, Handle& handle)
+{
+    Node* n = successor;
+    while (n != parent) {
+        bool left = goesLeft(key, n);
+        Node* next = address((left ? n->left : n->right).load());
+        retire(address((left ? n->right : n->left).load()), handle);
+        retire(n, handle);
+        n = next;
+    }
+    retire(removed, handle);
+    retire(parent, handle);
+}
+
+/**
+* Goes down towards *after, remembering the right subtree of the last
+* router it turned left at; the answer is the leaf it ends on if that is
+* bigger, else the leftmost leaf of that subtree. A flagged leaf is already
+* gone, so the search moves past it and starts over.
+*/
+template<class Key, class Value>
+bool LockFreeBST<Key, Value>::nextItem(const Key* after, std::pair<Key, Value>& item, Handle& handle) const
+{
+    EpochReclaimer::Guard guard(handle);
+    Key bound;
+    bool bounded = after != NULL;
+    if (bounded) {
+        bound = *after;
+    }
+    while (true) {
+        Node* n = root_;
+        Node* subtree = NULL;
+        uintptr_t edge = 0;
+        while (!n->isLeaf()) {
+            if (!bounded || goesLeft(bound, n)) {
+                subtree = address(n->right.load(std::memory_order_acquire));
+                edge = n->left.load(std::memory_order_acquire);
+            }
+            else {
+                edge = n->right.load(std::memory_order_acquire);
+            }
+            n = address(edge);
+        }
+        if (n->inf == 0 && bounded && !(bound < n->key)) {
+            if (subtree == NULL) {
+                return false;
+            }
+            n = subtree;
+            edge = 0;
+            while (!n->isLeaf()) {
+                edge = n->left.load(std::memory_order_acquire);
+                n = address(edge);
+            }
+        }
+        if (n->inf != 0) {
+            return false;
+        }
+        if (!(edge & kFlag)) {
+            item.first = n->key;
+            item.second = n->value;
+            return true;
+        }
+        bound = n->key;
+        bounded = true;
+    }
+}
+
+template<class Key, class Value>
+void LockFreeBST<Key, Value>::retire(Node* n, Handle& handle)
+{
+    handle.retire(n, &LockFreeBST<Key, Value>::deleteNode);
+    if (handle.pending() >= kCollectEvery) {
+        handle.collect();
+    }
+}
+
+template<class Key, class Value>
+void LockFreeBST<Key, Value>::clearHelper(Node* n)
+{
+    if (n == NULL) {
+        return;
+    }
+    clearHelper(address(n->left.load()));
+    clearHelper(address(n->right.load()));
+    delete n;
+}
+
+template<class Key, class Value>
+bool LockFreeBST<Key, Value>::goesLeft(const Key& key, const Node* n)
+{
+    return n->inf != 0 || key < n->key;
+}
+
+template<class Key, class Value>
+bool LockFreeBST<Key, Value>::isKey(const Key& key, const Node* n)
+{
+    return n->inf == 0 && n->key == key;
+}
+
+template<class Key, class Value>
+std::atomic<uintptr_t>& LockFreeBST<Key, Value>::childLink(Node* n, const Key& key)
+{
+    return goesLeft(key, n) ? n->left : n->right;
+}
+
+template<class Key, class Value>
+typename LockFreeBST<Key, Value>::Node* LockFreeBST<Key, Value>::address(uintptr_t edge)
+{
+    return reinterpret_cast<Node*>(edge & ~(kFlag | kTag));
+}
+
+template<class Key, class Value>
+void LockFreeBST<Key, Value>::deleteNode(void* p)
+{
+    delete static_cast<Node*>(p);
+}
+
+/*
+---------------------------------------------
+End implementations for the LockFreeBST class.
+---------------------------------------------
+*/
+
+#endif
@@ -0,0 +1,294 @@
+#ifndef MERKLEAVLBST_H
+#define MERKLEAVLBST_H
+
+#include <iostream>
+#include <exception>
+#include <cstdlib>
+#include <cstdint>
+#include <functional>
+#include <vector>
+#include "augmentedavlbst.h"
+
+/**
+* The hash of a run of items in key order: a polynomial hash modulo the
+* Mersenne prime 2^61 - 1 together with base^length. Two runs concatenate
+* in O(1), so the digest of a key range does not depend on how the tree
+* holding it happens to be shaped.
+*/
+struct MerkleDigest
+{
+    MerkleDigest() : hash(0), scale(1) {}
+    MerkleDigest(uint64_t h, uint64_t s) : hash(h), scale(s) {}
+    uint64_t hash;
+    uint64_t scale; // base^length, so the empty run is (0, 1)
+};
+
+inline bool operator==(const MerkleDigest& a, const MerkleDigest& b)
+{
+    return a.hash == b.hash && a.scale == b.scale;
+}
+
+inline bool operator!=(const MerkleDigest& a, const MerkleDigest& b)
+{
+    return !(a == b);
+}
+
+/**
+* Monoid for AugmentedAVLTree that digests key/value pairs. Each item is
+* hashed with KeyHash and ValueHash and mixed before it enters the
+* polynomial, so similar items do not give similar digests.
+*/
+template <typename KeyHash, typename ValueHash>
+struct MerkleMonoid
+{
+    typedef MerkleDigest Summary;
+    static const uint64_t kMod = (static_cast<uint64_t>(1) << 61) - 1;
+    static const uint64_t kBase = 0x9e3779b97f4a7c15ull % kMod;
+
+    static Summary identity() { return Summary(); }
+    template<typename Item>
+    static Summary lift(const Item& item)
+    {
+        uint64_t k = KeyHash()(item.first);
+        uint64_t v = ValueHash()(item.second);
+        return Summary(mix(k ^ (v + 0x9e3779b97f4a7c15ull + (k << 6) + (k >> 2))) % kMod, kBase);
+    }
+    static Summary combine(const Summary& a, const Summary& b)
+    {
+        return Summary(addMod(mulMod(a.hash, b.scale), b.hash), mulMod(a.scale, b.scale));
+    }
+
+    // The splitmix64 finalizer
+    static uint64_t mix(uint64_t x)
+    {
+        x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ull;
+        x = (x ^ (x >> 27)) * 0x94d049bb133111ebull;
+        return x ^ (x >> 31);
+    }
+    static uint64_t mulMod(uint64_t a, uint64_t b)
+    {
+        unsigned __int128 p = static_cast<unsigned __int128>(a) * b;
+        uint64_t r = static_cast<uint64_t>(p >> 61) + (static_cast<uint64_t>(p) & kMod);
+        return r >= kMod ? r - kMod : r;
+    }
+    static uint64_t addMod(uint64_t a, uint64_t b)
+    {
+        uint64_t r = a + b;
+        return r >= kMod ? r - kMod : r;
+    }
+};
+
+/**
+* What diff() needs to know about the replica it compares against. A
+* remote replica answers these over the wire; LocalMerklePeer answers them
+* from a tree in the same process. Bounds are exclusive and NULL means
+* unbounded.
+*/
+template <typename Key>
+class MerklePeer
+{
+public:
+    virtual ~MerklePeer() {}
+    virtual MerkleDigest digestBetween(const Key* lo, const Key* hi) const = 0; // Keys strictly between
+    virtual MerkleDigest digestAt(const Key& key) const = 0; // The empty digest if key is absent
+    virtual void keysBetween(const Key* lo, const Key* hi, std::vector<Key>& out) const = 0; // In key order
+};
+
+/**
+* An AVL tree whose nodes carry the Merkle digest of their subtree. Two
+* trees with the same items have the same digest() whatever their shapes,
+* so replicas can be compared in O(1), and diff() only descends into
+* subtrees whose digests disagree.
+*
+* Like any AugmentedAVLTree, values changed in place through operator[] or
+* an iterator are not seen; re-insert the key instead.
+*/
+template <typename Key, typename Value, typename KeyHash = std::hash<Key>, typename ValueHash = std::hash<Value> >
+class MerkleAVLTree : public AugmentedAVLTree<Key, Value, MerkleMonoid<KeyHash, ValueHash> >
+{
+public:
+    typedef MerkleMonoid<KeyHash, ValueHash> Monoid;
+    typedef AugmentedAVLTree<Key, Value, Monoid> Base;
+
+    MerkleDigest digest() const; // Digest of every item, in O(1)
+    bool matches(const MerkleAVLTree& other) const; // Same items, as far as the digests can tell
+
+    // Append the keys that are in only one tree or have different values,
+    // in key order. O(d log n) peer queries for d differences.
+    void diff(const MerkleAVLTree& other, std::vector<Key>& out) const;
+    void diff(const MerklePeer<Key>& peer, std::vector<Key>& out) const;
+
+    // The queries a MerklePeer forwards to its tree
+    MerkleDigest digestBetween(const Key* lo, const Key* hi) const;
+    MerkleDigest digestAt(const Key& key) const;
+    void keysBetween(const Key* lo, const Key* hi, std::vector<Key>& out) const;
+
+protected:
+    typedef AugmentedAVLNode<Key, Value, Monoid> MNode;
+
+    void diffHelper(Node<Key, Value>* node, const Key* lo, const Key* hi,
+                    const MerklePeer<Key>& peer, std::vector<Key>& out) const;
+    static void keysHelper(Node<Key, Value>* node, const Key* lo, const Key* hi, std::vector<Key>& out);
+    static bool above(const Key& key, const Key* lo) { return lo == nullptr || *lo < key; }
+    static bool below(const Key& key, const Key* hi) { return hi == nullptr || key < *hi; }
+};
+
+/**
+* A MerklePeer backed by a tree in this process, for tests and for replicas
+* that share an address space.
+*/
+template <typename Key, typename Value, typename KeyHash = std::hash<Key>, typename ValueHash = std::hash<Value> >
+class LocalMerklePeer : public MerklePeer<Key>
+{
+public:
+    explicit LocalMerklePeer(const MerkleAVLTree<Key, Value, KeyHash, ValueHash>& tree) : tree_(tree) {}
+    virtual MerkleDigest digestBetween(const Key* lo, const Key* hi) const { return tree_.digestBetween(lo, hi); }
+    virtual MerkleDigest digestAt(const Key& key) const { return tree_.digestAt(key); }
+    virtual void keysBetween(const Key* lo, const Key* hi, std::vector<Key>& out) const { tree_.keysBetween(lo, hi, out); }
+
+private:
+    const MerkleAVLTree<Key, Value, KeyHash, ValueHash>& tree_;
+};
+
+/*
+------------------------------------------------
+Begin implementations for the MerkleAVLTree class.
+------------------------------------------------
+*/
+
+template<class Key, class Value, class KeyHash, class ValueHash>
+MerkleDigest MerkleAVLTree<Key, Value, KeyHash, ValueHash>::digest() const
+{
+    return this->summary();
+}
+
+template<class Key, class Value, class KeyHash, class ValueHash>
+bool MerkleAVLTree<Key, Value, KeyHash, ValueHash>::matches(const MerkleAVLTree& other) const
+{
+    return digest() == other.digest();
+}
+
+template<class Key, class Value, class KeyHash, class ValueHash>
+void MerkleAVLTree<Key, Value, KeyHash, ValueHash>::diff(const MerkleAVLTree& other, std::vector<Key>& out) const
+{
+    diff(LocalMerklePeer<Key, Value, KeyHash, ValueHash>(other), out);
+}
+
+template<class Key, class Value, class KeyHash, class ValueHash>
+void MerkleAVLTree<Key, Value, KeyHash, ValueHash>::diff(const MerklePeer<Key>& peer, std::vector<Key>& out) const
+{
+    diffHelper(this->root_, nullptr, nullptr, peer, out);
+}
+
+/**
+* Every key of ours strictly between lo and hi is below node, so the peer
+* agrees on the whole subtree if its digest of (lo, hi) matches. Otherwise
+* the node itself is compared and both sides are searched, with the node's
+* key as the new bound. An empty subtree that still disagrees means every
+* key the peer has in (lo, hi) is missing here.
+*/
+template<class Key, class Value, class KeyHash, class ValueHash>
+void MerkleAVLTree<Key, Value, KeyHash, ValueHash>::diffHelper(Node<Key, Value>* node, const Key* lo, const Key* hi,
+                                                               const MerklePeer<Key>& peer, std::vector<Key>& out) const
+{
+    if (MNode::summaryOf(node) == peer.digestBetween(lo, hi)) {
+        return;
+    }
+    if (node == nullptr) {
+        peer.keysBetween(lo, hi, out);
+        return;
+    }
+    const Key& key = node->getKey();
+    diffHelper(node->left_, lo, &key, peer, out);
+    if (this->lift(node) != peer.digestAt(key)) {
+        out.push_back(key);
+    }
+    diffHelper(node->right_, &key, hi, peer, out);
+}
+
+/**
+* Same descent as AugmentedAVLTree::aggregate, with exclusive and
+* optional bounds.
+*/
+template<class Key, class Value, class KeyHash, class ValueHash>
+MerkleDigest MerkleAVLTree<Key, Value, KeyHash, ValueHash>::digestBetween(const Key* lo, const Key* hi) const
+{
+    Node<Key, Value>* split = this->root_;
+    while (split != nullptr) {
+        if (!above(split->getKey(), lo)) {
+            split = split->right_;
+        }
+        else if (!below(split->getKey(), hi)) {
+            split = split->left_;
+        }
+        else {
+            break;
+        }
+    }
+    if (split == nullptr) {
+        return Monoid::identity();
+    }
+
+    MerkleDigest leftPart = Monoid::identity();
+    for (Node<Key, Value>* n = split->left_; n != nullptr; ) {
+        if (!above(n->getKey(), lo)) {
+            n = n->right_;
+        }
+        else {
+            leftPart = Monoid::combine(Monoid::combine(this->lift(n), MNode::summaryOf(n->right_)), leftPart);
+            n = n->left_;
+        }
+    }
+    MerkleDigest rightPart = Monoid::identity();
+    for (Node<Key, Value>* n = split->right_; n != nullptr; ) {
+        if (below(n->getKey(), hi)) {
+            rightPart = Monoid::combine(rightPart, Monoid::combine(MNode::summaryOf(n->left_), this->lift(n)));
+            n = n->right_;
+        }
+        else {
+            n = n->left_;
+        }
+    }
+    return Monoid::combine(Monoid::combine(leftPart, this->lift(split)), rightPart);
+}
+
+template<class Key, class Value, class KeyHash, class ValueHash>
+MerkleDigest MerkleAVLTree<Key, Value, KeyHash, ValueHash>::digestAt(const Key& key) const
+{
+    Node<Key, Value>* node = this->internalFind(key);
+    return node == nullptr ? Monoid::identity() : this->lift(node);
+}
+
+template<class Key, class Value, class KeyHash, class ValueHash>
+void MerkleAVLTree<Key, Value, KeyHash, ValueHash>::keysBetween(const Key* lo, const Key* hi, std::vector<Key>& out) const
+{
+    keysHelper(this->root_, lo, hi, out);
+}
+
+template<class Key, class Value, class KeyHash, class ValueHash>
+void MerkleAVLTree<Key, Value, KeyHash, ValueHash>::keysHelper(Node<Key, Value>* node, const Key* lo, const Key* hi,
+                                                               std::vector<Key>& out)
+{
+    if (node == nullptr) {
+        return;
+    }
+    bool inLo = above(node->getKey(), lo);
+    bool inHi = below(node->getKey(), hi);
+    if (inLo) {
+        keysHelper(node->left_, lo, hi, out);
+    }
+    if (inLo && inHi && !node->isTombstone()) {
+        out.push_back(node->getKey());
+    }
+    if (inHi) {
+        keysHelper(node->right_, lo, hi, out);
+    }
+}
+
+/*
+----------------------------------------------
+End implementations for the MerkleAVLTree class.
+----------------------------------------------
+*/
+
+#endif
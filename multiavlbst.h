@@ -0,0 +1,355 @@
+#ifndef MULTIAVLBST_H
+#define MULTIAVLBST_H
+
+#include <iostream>
+#include <exception>
+#include <cstdlib>
+#include <cstdint>
+#include <new>
+#include <utility>
+#include <type_traits>
+#include "avlbst.h"
+
+/**
+* The values stored under one key of a MultiAVLTree, in insertion order and
+* contiguous in memory. A single value lives inside the run itself; the
+* second one moves the run to a heap array that grows geometrically. The
+* inline slot and the heap pointer share storage, so a run costs 16 bytes
+* on top of a small Value.
+*/
+template <typename Value>
+class ValueRun
+{
+public:
+    ValueRun();
+    explicit ValueRun(const Value& value);
+    ValueRun(const ValueRun& other);
+    ValueRun& operator=(const ValueRun& other);
+    ~ValueRun();
+
+    void push_back(const Value& value);
+    bool erase(const Value& value); // Removes the first equal value; the rest keep their order
+    void clear();
+    size_t size() const;
+    bool empty() const;
+
+    Value* begin();
+    Value* end();
+    const Value* begin() const;
+    const Value* end() const;
+    Value& operator[](size_t i);
+    const Value& operator[](size_t i) const;
+
+protected:
+    bool isInline() const;
+    void reserve(size_t capacity);
+
+    union {
+        typename std::aligned_storage<sizeof(Value), alignof(Value)>::type inline_;
+        Value* heap_;
+    };
+    uint32_t size_;
+    uint32_t capacity_; // 1 while the run uses the inline slot
+};
+
+/**
+* Prints the run as a comma separated list, so trees of runs can print().
+*/
+template <typename Value>
+std::ostream& operator<<(std::ostream& os, const ValueRun<Value>& run)
+{
+    for (size_t i = 0; i < run.size(); ++i) {
+        if (i != 0) {
+            os << ',';
+        }
+        os << run[i];
+    }
+    return os;
+}
+
+/*
+  -------------------------------------------------
+  Begin implementations for the ValueRun class.
+  -------------------------------------------------
+*/
+
+template<class Value>
+ValueRun<Value>::ValueRun() : size_(0), capacity_(1)
+{
+}
+
+template<class Value>
+ValueRun<Value>::ValueRun(const Value& value) : size_(0), capacity_(1)
+{
+    push_back(value);
+}
+
+template<class Value>
+ValueRun<Value>::ValueRun(const ValueRun& other) : size_(0), capacity_(1)
+{
+    reserve(other.size());
+    for (size_t i = 0; i < other.size(); ++i) {
+        push_back(other[i]);
+    }
+}
+
+template<class Value>
+ValueRun<Value>& ValueRun<Value>::operator=(const ValueRun& other)
+{
+    if (this != &other) {
+        clear();
+        reserve(other.size());
+        for (size_t i = 0; i < other.size(); ++i) {
+            push_back(other[i]);
+        }
+    }
+    return *this;
+}
+
+template<class Value>
+ValueRun<Value>::~ValueRun()
+{
+    clear();
+    if (!isInline()) {
+        ::operator delete(heap_);
+    }
+}
+
+template<class Value>
+void ValueRun<Value>::push_back(const Value& value)
+{
+    if (size_ == capacity_) {
+        reserve(capacity_ < 2 ? 4 : 2 * static_cast<size_t>(capacity_));
+    }
+    new (begin() + size_) Value(value);
+    ++size_;
+}
+
+template<class Value>
+bool ValueRun<Value>::erase(const Value& value)
+{
+    Value* data = begin();
+    for (size_t i = 0; i < size_; ++i) {
+        if (data[i] == value) {
+            for (size_t j = i + 1; j < size_; ++j) {
+                data[j - 1] = std::move(data[j]);
+            }
+            data[size_ - 1].~Value();
+            --size_;
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+* Destroys the values but keeps any heap array for reuse.
+*/
+template<class Value>
+void ValueRun<Value>::clear()
+{
+    Value* data = begin();
+    for (size_t i = 0; i < size_; ++i) {
+        data[i].~Value();
+    }
+    size_ = 0;
+}
+
+template<class Value>
+size_t ValueRun<Value>::size() const
+{
+    return size_;
+}
+
+template<class Value>
+bool ValueRun<Value>::empty() const
+{
+    return size_ == 0;
+}
+
+template<class Value>
+Value* ValueRun<Value>::begin()
+{
+    return isInline() ? reinterpret_cast<Value*>(&inline_) : heap_;
+}
+
+template<class Value>
+Value* ValueRun<Value>::end()
+{
+    return begin() + size_;
+}
+
+template<class Value>
+const Value* ValueRun<Value>::begin() const
+{
+    return isInline() ? reinterpret_cast<const Value*>(&inline_) : heap_;
+}
+
+template<class Value>
+const Value* ValueRun<Value>::end() const
+{
+    return begin() + size_;
+}
+
+template<class Value>
+Value& ValueRun<Value>::operator[](size_t i)
+{
+    return begin()[i];
+}
+
+template<class Value>
+const Value& ValueRun<Value>::operator[](size_t i) const
+{
+    return begin()[i];
+}
+
+template<class Value>
+bool ValueRun<Value>::isInline() const
+{
+    return capacity_ <= 1;
+}
+
+/**
+* Moves the values into a heap array of the given capacity. The inline
+* value is destroyed before heap_ is written, since they share storage.
+*/
+template<class Value>
+void ValueRun<Value>::reserve(size_t capacity)
+{
+    if (capacity <= capacity_) {
+        return;
+    }
+    Value* fresh = static_cast<Value*>(::operator new(capacity * sizeof(Value)));
+    Value* old = begin();
+    for (size_t i = 0; i < size_; ++i) {
+        new (fresh + i) Value(std::move(old[i]));
+        old[i].~Value();
+    }
+    if (!isInline()) {
+        ::operator delete(heap_);
+    }
+    heap_ = fresh;
+    capacity_ = static_cast<uint32_t>(capacity);
+}
+
+/*
+  -----------------------------------------------
+  End implementations for the ValueRun class.
+  -----------------------------------------------
+*/
+
+/**
+* An AVL multimap: each distinct key has one node whose value is the run
+* of everything inserted under it, so duplicates never add height. Adding
+* a value to a key that exists, or erasing one of several values, changes
+* only the run; the tree is touched when a key appears or disappears.
+*/
+template <class Key, class Value>
+class MultiAVLTree : public AVLTree<Key, ValueRun<Value> >
+{
+public:
+    typedef AVLTree<Key, ValueRun<Value> > Base;
+    typedef Value* value_iterator;
+    typedef typename Base::iterator iterator;
+    typedef typename Base::node_type node_type;
+
+    void insert(const std::pair<const Key, Value>& new_item); // Appends to the key's run
+    std::pair<iterator, bool> insert(node_type&& handle); // Moves a whole run; fails if the key exists
+    using Base::erase;
+    size_t erase(const Key& key); // Removes the key and all its values, returns how many
+    bool erase(const Key& key, const Value& value); // Removes the first equal value under key
+
+    size_t count(const Key& key) const;
+    std::pair<value_iterator, value_iterator> equal_range(const Key& key) const; // Empty range if absent
+
+protected:
+    virtual void mergeValue(Node<Key, ValueRun<Value> >* mine, Node<Key, ValueRun<Value> >* theirs);
+};
+
+/*
+------------------------------------------------
+Begin implementations for the MultiAVLTree class.
+------------------------------------------------
+*/
+
+template<class Key, class Value>
+void MultiAVLTree<Key, Value>::insert(const std::pair<const Key, Value>& new_item)
+{
+    Node<Key, ValueRun<Value> >* node = this->internalFind(new_item.first);
+    if (node != nullptr) {
+        node->getValue().push_back(new_item.second);
+        return;
+    }
+    Base::insert(std::make_pair(new_item.first, ValueRun<Value>(new_item.second)));
+}
+
+template<class Key, class Value>
+std::pair<typename MultiAVLTree<Key, Value>::iterator, bool> MultiAVLTree<Key, Value>::insert(node_type&& handle)
+{
+    return Base::insert(std::move(handle));
+}
+
+template<class Key, class Value>
+size_t MultiAVLTree<Key, Value>::erase(const Key& key)
+{
+    size_t removed = count(key);
+    if (removed != 0) {
+        Base::remove(key);
+    }
+    return removed;
+}
+
+/**
+* The node goes away only when its last value does.
+*/
+template<class Key, class Value>
+bool MultiAVLTree<Key, Value>::erase(const Key& key, const Value& value)
+{
+    Node<Key, ValueRun<Value> >* node = this->internalFind(key);
+    if (node == nullptr || !node->getValue().erase(value)) {
+        return false;
+    }
+    if (node->getValue().empty()) {
+        Base::remove(key);
+    }
+    return true;
+}
+
+template<class Key, class Value>
+size_t MultiAVLTree<Key, Value>::count(const Key& key) const
+{
+    Node<Key, ValueRun<Value> >* node = this->internalFind(key);
+    return node == nullptr ? 0 : node->getValue().size();
+}
+
+template<class Key, class Value>
+std::pair<typename MultiAVLTree<Key, Value>::value_iterator, typename MultiAVLTree<Key, Value>::value_iterator>
+MultiAVLTree<Key, Value>::equal_range(const Key& key) const
+{
+    Node<Key, ValueRun<Value> >* node = this->internalFind(key);
+    if (node == nullptr) {
+        return std::make_pair(value_iterator(nullptr), value_iterator(nullptr));
+    }
+    ValueRun<Value>& run = node->getValue();
+    return std::make_pair(run.begin(), run.end());
+}
+
+/**
+* merge() keeps every value: the other tree's run goes after ours.
+*/
+template<class Key, class Value>
+void MultiAVLTree<Key, Value>::mergeValue(Node<Key, ValueRun<Value> >* mine, Node<Key, ValueRun<Value> >* theirs)
+{
+    const ValueRun<Value>& run = theirs->getValue();
+    for (const Value* v = run.begin(); v != run.end(); ++v) {
+        mine->getValue().push_back(*v);
+    }
+}
+
+/*
+----------------------------------------------
+End implementations for the MultiAVLTree class.
+----------------------------------------------
+*/
+
+#endif
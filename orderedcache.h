@@ -0,0 +1,558 @@
+#ifndef ORDEREDCACHE_H
+#define ORDEREDCACHE_H
+
+#include <iostream>
+#include <exception>
+#include <cstdlib>
+#include <chrono>
+#include "avlbst.h"
+
+/**
+* The default Sizer for OrderedCache: what the key and value occupy inline.
+* Supply your own to count heap memory such as the characters of a string.
+*/
+struct CacheItemSize
+{
+    template<typename K, typename V>
+    size_t operator()(const K&, const V&) const { return sizeof(K) + sizeof(V); }
+};
+
+/**
+* A bounded cache kept in key order. Entries are AVL nodes that also sit on
+* two intrusive lists: one from least to most recently used, and one from
+* oldest to newest write. Lookups and inserts stay O(log n); once the cache
+* holds too many entries or bytes, the least recently used entry is picked
+* in O(1) and unlinked from the tree. With a time to live, an entry expires
+* that long after it was last written. Since every entry lives equally
+* long, the oldest write is always the first to expire, so purging walks
+* the write list from the front and stops at the first live entry.
+*
+* Iteration and lower_bound()/upper_bound() go through the tree in key
+* order and leave recency alone. They step over expired entries, including
+* ones that expire partway through a scan. Values changed through an
+* iterator are not re-measured by Sizer; insert the key again instead.
+*/
+template <class Key, class Value, class Sizer = CacheItemSize, class Clock = std::chrono::steady_clock>
+class OrderedCache
+{
+public:
+    typedef typename Clock::duration duration;
+
+    /**
+    * A tree iterator that never stops on an expired entry. It checks the
+    * clock at each step rather than dropping anything, so scanning stays
+    * a read-only walk.
+    */
+    class iterator : public AVLTree<Key, Value>::iterator
+    {
+    public:
+        iterator();
+        iterator& operator++();
+
+    private:
+        friend class OrderedCache;
+        typedef typename AVLTree<Key, Value>::iterator Base;
+        iterator(const Base& it, const OrderedCache* cache);
+        void skipExpired();
+
+        const OrderedCache* cache_;
+    };
+
+    explicit OrderedCache(size_t maxEntries = 0, size_t maxBytes = 0); // 0 means no limit
+    ~OrderedCache();
+
+    void setMaxEntries(size_t maxEntries); // Evicts right away if the cache is now over
+    void setMaxBytes(size_t maxBytes);
+    void setTimeToLive(duration ttl); // Zero turns expiry off; applies to every entry at once
+
+    // The entry becomes the most recently used and the newest write. An
+    // entry bigger than maxBytes on its own is evicted again straight away.
+    void insert(const std::pair<const Key, Value>& keyValuePair);
+    void remove(const Key& key);
+    void clear();
+    bool get(const Key& key, Value& value); // A hit becomes the most recently used
+    iterator find(const Key& key); // Like get(); end() on a miss
+    bool contains(const Key& key) const; // Leaves recency alone
+    size_t purgeExpired(); // Returns how many entries expired
+
+    size_t size() const;
+    bool empty() const;
+    size_t bytes() const; // Sum of Sizer over the entries
+    size_t evictionCount() const; // Entries dropped for capacity since construction
+    size_t expiredCount() const; // Entries dropped because they expired
+
+    // Key order, skipping expired entries. begin() also purges them.
+    iterator begin();
+    iterator end() const;
+    iterator lower_bound(const Key& key) const; // First key not less than key
+    iterator upper_bound(const Key& key) const; // First key greater than key
+
+protected:
+    typedef typename Clock::time_point time_point;
+
+    /**
+    * A tree node on both lists. nodeSwap moves nodes rather than items, so
+    * the links stay with the entry when the tree reshapes.
+    */
+    class Entry : public AVLNode<Key, Value>
+    {
+    public:
+        Entry(const Key& key, const Value& value, AVLNode<Key, Value>* parent) :
+            AVLNode<Key, Value>(key, value, parent), older(NULL), newer(NULL),
+            earlier(NULL), later(NULL), bytes(0) {}
+        Entry* older;   // Recency list
+        Entry* newer;
+        Entry* earlier; // Write list
+        Entry* later;
+        time_point written;
+        size_t bytes;
+    };
+
+    // Opens up the tree helpers the cache builds on
+    class Tree : public AVLTree<Key, Value>
+    {
+    public:
+        Entry* slot(const Key& key, Node<Key, Value>*& parent) const;
+        void attach(Entry* n, Node<Key, Value>* parent); // Hangs n under parent as a new leaf
+        void detach(Entry* n); // Takes n out without freeing it
+        typename AVLTree<Key, Value>::iterator bound(const Key& key, bool inclusive) const;
+        typename AVLTree<Key, Value>::iterator at(Entry* n) const;
+    };
+
+    void touch(Entry* n); // Moves n to the most recently used end
+    void rewrite(Entry* n); // Moves n to the newest write end and restamps it
+    void evictOverflow();
+    void drop(Entry* n); // Unlinks n from both lists and the tree and frees it
+    bool expired(const Entry* n, time_point now) const;
+    Entry* lookup(const Key& key);
+    bool overCapacity() const;
+
+    // Not copyable
+    OrderedCache(const OrderedCache&);
+    OrderedCache& operator=(const OrderedCache&);
+
+    Tree tree_;
+    Entry* lru_; // Least recently used, evicted first
+    Entry* mru_;
+    Entry* oldest_; // Oldest write, expires first
+    Entry* newest_;
+    size_t count_;
+    size_t bytes_;
+    size_t maxEntries_;
+    size_t maxBytes_;
+    duration ttl_;
+    size_t evictions_;
+    size_t expirations_;
+};
+
+/*
+--------------------------------------------------------
+Begin implementations for the OrderedCache::iterator class.
+--------------------------------------------------------
+*/
+
+template<class Key, class Value, class Sizer, class Clock>
+OrderedCache<Key, Value, Sizer, Clock>::iterator::iterator() : cache_(NULL)
+{
+}
+
+template<class Key, class Value, class Sizer, class Clock>
+OrderedCache<Key, Value, Sizer, Clock>::iterator::iterator(const Base& it, const OrderedCache* cache) :
+    Base(it), cache_(cache)
+{
+    skipExpired();
+}
+
+template<class Key, class Value, class Sizer, class Clock>
+typename OrderedCache<Key, Value, Sizer, Clock>::iterator& OrderedCache<Key, Value, Sizer, Clock>::iterator::operator++()
+{
+    Base::operator++();
+    skipExpired();
+    return *this;
+}
+
+template<class Key, class Value, class Sizer, class Clock>
+void OrderedCache<Key, Value, Sizer, Clock>::iterator::skipExpired()
+{
+    if (cache_ == NULL || cache_->ttl_ == duration::zero()) {
+        return;
+    }
+    time_point now = Clock::now();
+    while (this->current_ != nullptr && cache_->expired(static_cast<Entry*>(this->current_), now)) {
+        Base::operator++();
+    }
+}
+
+/*
+------------------------------------------------------
+End implementations for the OrderedCache::iterator class.
+------------------------------------------------------
+*/
+
+/*
+----------------------------------------------------
+Begin implementations for the OrderedCache::Tree class.
+----------------------------------------------------
+*/
+
+template<class Key, class Value, class Sizer, class Clock>
+typename OrderedCache<Key, Value, Sizer, Clock>::Entry* OrderedCache<Key, Value, Sizer, Clock>::Tree::slot(const Key& key, Node<Key, Value>*& parent) const
+{
+    return static_cast<Entry*>(this->findSlot(key, parent));
+}
+
+template<class Key, class Value, class Sizer, class Clock>
+void OrderedCache<Key, Value, Sizer, Clock>::Tree::attach(Entry* n, Node<Key, Value>* parent)
+{
+    n->setParent(static_cast<AVLNode<Key, Value>*>(parent));
+    ++this->size_;
+    if (parent == nullptr) {
+        this->root_ = n;
+        return;
+    }
+    if (n->getKey() < parent->getKey()) {
+        parent->setLeft(n);
+    }
+    else {
+        parent->setRight(n);
+    }
+    this->leafAdded(parent);
+}
+
+template<class Key, class Value, class Sizer, class Clock>
+void OrderedCache<Key, Value, Sizer, Clock>::Tree::detach(Entry* n)
+{
+    this->unlinkNode(n);
+}
+
+/**
+* The last node the walk turned left at is the answer when the walk falls
+* off the tree.
+*/
+template<class Key, class Value, class Sizer, class Clock>
+typename AVLTree<Key, Value>::iterator OrderedCache<Key, Value, Sizer, Clock>::Tree::bound(const Key& key, bool inclusive) const
+{
+    Node<Key, Value>* current = this->root_;
+    Node<Key, Value>* best = nullptr;
+    while (current != nullptr) {
+        if (key < current->getKey() || (inclusive && key == current->getKey())) {
+            best = current;
+            current = current->getLeft();
+        }
+        else {
+            current = current->getRight();
+        }
+    }
+    return this->iteratorAt(best);
+}
+
+template<class Key, class Value, class Sizer, class Clock>
+typename AVLTree<Key, Value>::iterator OrderedCache<Key, Value, Sizer, Clock>::Tree::at(Entry* n) const
+{
+    return this->iteratorAt(n);
+}
+
+/*
+--------------------------------------------------
+End implementations for the OrderedCache::Tree class.
+--------------------------------------------------
+*/
+
+/*
+-----------------------------------------------
+Begin implementations for the OrderedCache class.
+-----------------------------------------------
+*/
+
+template<class Key, class Value, class Sizer, class Clock>
+OrderedCache<Key, Value, Sizer, Clock>::OrderedCache(size_t maxEntries, size_t maxBytes) :
+    lru_(NULL), mru_(NULL), oldest_(NULL), newest_(NULL), count_(0), bytes_(0),
+    maxEntries_(maxEntries), maxBytes_(maxBytes), ttl_(duration::zero()), evictions_(0), expirations_(0)
+{
+}
+
+template<class Key, class Value, class Sizer, class Clock>
+OrderedCache<Key, Value, Sizer, Clock>::~OrderedCache()
+{
+}
+
+template<class Key, class Value, class Sizer, class Clock>
+void OrderedCache<Key, Value, Sizer, Clock>::setMaxEntries(size_t maxEntries)
+{
+    maxEntries_ = maxEntries;
+    evictOverflow();
+}
+
+template<class Key, class Value, class Sizer, class Clock>
+void OrderedCache<Key, Value, Sizer, Clock>::setMaxBytes(size_t maxBytes)
+{
+    maxBytes_ = maxBytes;
+    evictOverflow();
+}
+
+template<class Key, class Value, class Sizer, class Clock>
+void OrderedCache<Key, Value, Sizer, Clock>::setTimeToLive(duration ttl)
+{
+    ttl_ = ttl;
+}
+
+/**
+* One descent finds either the entry or the leaf to hang a new one from.
+*/
+template<class Key, class Value, class Sizer, class Clock>
+void OrderedCache<Key, Value, Sizer, Clock>::insert(const std::pair<const Key, Value>& keyValuePair)
+{
+    Node<Key, Value>* parent;
+    Entry* n = tree_.slot(keyValuePair.first, parent);
+    if (n != NULL) {
+        n->setValue(keyValuePair.second);
+        bytes_ -= n->bytes;
+    }
+    else {
+        n = new Entry(keyValuePair.first, keyValuePair.second, NULL);
+        tree_.attach(n, parent);
+        ++count_;
+    }
+    n->bytes = Sizer()(keyValuePair.first, keyValuePair.second);
+    bytes_ += n->bytes;
+    touch(n);
+    rewrite(n);
+    evictOverflow();
+}
+
+template<class Key, class Value, class Sizer, class Clock>
+void OrderedCache<Key, Value, Sizer, Clock>::remove(const Key& key)
+{
+    Node<Key, Value>* parent;
+    Entry* n = tree_.slot(key, parent);
+    if (n != NULL) {
+        drop(n);
+    }
+}
+
+template<class Key, class Value, class Sizer, class Clock>
+void OrderedCache<Key, Value, Sizer, Clock>::clear()
+{
+    tree_.clear();
+    lru_ = mru_ = oldest_ = newest_ = NULL;
+    count_ = 0;
+    bytes_ = 0;
+}
+
+template<class Key, class Value, class Sizer, class Clock>
+bool OrderedCache<Key, Value, Sizer, Clock>::get(const Key& key, Value& value)
+{
+    Entry* n = lookup(key);
+    if (n == NULL) {
+        return false;
+    }
+    value = n->getValue();
+    return true;
+}
+
+template<class Key, class Value, class Sizer, class Clock>
+typename OrderedCache<Key, Value, Sizer, Clock>::iterator OrderedCache<Key, Value, Sizer, Clock>::find(const Key& key)
+{
+    return iterator(tree_.at(lookup(key)), this);
+}
+
+template<class Key, class Value, class Sizer, class Clock>
+bool OrderedCache<Key, Value, Sizer, Clock>::contains(const Key& key) const
+{
+    Node<Key, Value>* parent;
+    Entry* n = tree_.slot(key, parent);
+    return n != NULL && !expired(n, Clock::now());
+}
+
+template<class Key, class Value, class Sizer, class Clock>
+size_t OrderedCache<Key, Value, Sizer, Clock>::purgeExpired()
+{
+    if (ttl_ == duration::zero()) {
+        return 0;
+    }
+    time_point now = Clock::now();
+    size_t purged = 0;
+    while (oldest_ != NULL && expired(oldest_, now)) {
+        drop(oldest_);
+        ++purged;
+    }
+    expirations_ += purged;
+    return purged;
+}
+
+template<class Key, class Value, class Sizer, class Clock>
+size_t OrderedCache<Key, Value, Sizer, Clock>::size() const
+{
+    return count_;
+}
+
+template<class Key, class Value, class Sizer, class Clock>
+bool OrderedCache<Key, Value, Sizer, Clock>::empty() const
+{
+    return count_ == 0;
+}
+
+template<class Key, class Value, class Sizer, class Clock>
+size_t OrderedCache<Key, Value, Sizer, Clock>::bytes() const
+{
+    return bytes_;
+}
+
+template<class Key, class Value, class Sizer, class Clock>
+size_t OrderedCache<Key, Value, Sizer, Clock>::evictionCount() const
+{
+    return evictions_;
+}
+
+template<class Key, class Value, class Sizer, class Clock>
+size_t OrderedCache<Key, Value, Sizer, Clock>::expiredCount() const
+{
+    return expirations_;
+}
+
+template<class Key, class Value, class Sizer, class Clock>
+typename OrderedCache<Key, Value, Sizer, Clock>::iterator OrderedCache<Key, Value, Sizer, Clock>::begin()
+{
+    purgeExpired();
+    return iterator(tree_.begin(), this);
+}
+
+template<class Key, class Value, class Sizer, class Clock>
+typename OrderedCache<Key, Value, Sizer, Clock>::iterator OrderedCache<Key, Value, Sizer, Clock>::end() const
+{
+    return iterator(tree_.end(), this);
+}
+
+template<class Key, class Value, class Sizer, class Clock>
+typename OrderedCache<Key, Value, Sizer, Clock>::iterator OrderedCache<Key, Value, Sizer, Clock>::lower_bound(const Key& key) const
+{
+    return iterator(tree_.bound(key, true), this);
+}
+
+template<class Key, class Value, class Sizer, class Clock>
+typename OrderedCache<Key, Value, Sizer, Clock>::iterator OrderedCache<Key, Value, Sizer, Clock>::upper_bound(const Key& key) const
+{
+    return iterator(tree_.bound(key, false), this);
+}
+
+template<class Key, class Value, class Sizer, class Clock>
+void OrderedCache<Key, Value, Sizer, Clock>::touch(Entry* n)
+{
+    if (n == mru_) {
+        return;
+    }
+    if (n->older != NULL) {
+        n->older->newer = n->newer;
+    }
+    if (n->newer != NULL) {
+        n->newer->older = n->older;
+    }
+    if (n == lru_) {
+        lru_ = n->newer;
+    }
+    n->older = mru_;
+    n->newer = NULL;
+    if (mru_ != NULL) {
+        mru_->newer = n;
+    }
+    mru_ = n;
+    if (lru_ == NULL) {
+        lru_ = n;
+    }
+}
+
+template<class Key, class Value, class Sizer, class Clock>
+void OrderedCache<Key, Value, Sizer, Clock>::rewrite(Entry* n)
+{
+    n->written = Clock::now();
+    if (n == newest_) {
+        return;
+    }
+    if (n->earlier != NULL) {
+        n->earlier->later = n->later;
+    }
+    if (n->later != NULL) {
+        n->later->earlier = n->earlier;
+    }
+    if (n == oldest_) {
+        oldest_ = n->later;
+    }
+    n->earlier = newest_;
+    n->later = NULL;
+    if (newest_ != NULL) {
+        newest_->later = n;
+    }
+    newest_ = n;
+    if (oldest_ == NULL) {
+        oldest_ = n;
+    }
+}
+
+/**
+* Expired entries go first, since they are leaving anyway.
+*/
+template<class Key, class Value, class Sizer, class Clock>
+void OrderedCache<Key, Value, Sizer, Clock>::evictOverflow()
+{
+    if (!overCapacity()) {
+        return;
+    }
+    purgeExpired();
+    while (overCapacity()) {
+        drop(lru_);
+        ++evictions_;
+    }
+}
+
+template<class Key, class Value, class Sizer, class Clock>
+void OrderedCache<Key, Value, Sizer, Clock>::drop(Entry* n)
+{
+    (n->older != NULL ? n->older->newer : lru_) = n->newer;
+    (n->newer != NULL ? n->newer->older : mru_) = n->older;
+    (n->earlier != NULL ? n->earlier->later : oldest_) = n->later;
+    (n->later != NULL ? n->later->earlier : newest_) = n->earlier;
+    bytes_ -= n->bytes;
+    --count_;
+    tree_.detach(n);
+    delete n;
+}
+
+template<class Key, class Value, class Sizer, class Clock>
+bool OrderedCache<Key, Value, Sizer, Clock>::expired(const Entry* n, time_point now) const
+{
+    return ttl_ != duration::zero() && now - n->written >= ttl_;
+}
+
+/**
+* An expired entry is dropped on the spot and counts as a miss.
+*/
+template<class Key, class Value, class Sizer, class Clock>
+typename OrderedCache<Key, Value, Sizer, Clock>::Entry* OrderedCache<Key, Value, Sizer, Clock>::lookup(const Key& key)
+{
+    Node<Key, Value>* parent;
+    Entry* n = tree_.slot(key, parent);
+    if (n == NULL) {
+        return NULL;
+    }
+    if (expired(n, Clock::now())) {
+        drop(n);
+        ++expirations_;
+        return NULL;
+    }
+    touch(n);
+    return n;
+}
+
+template<class Key, class Value, class Sizer, class Clock>
+bool OrderedCache<Key, Value, Sizer, Clock>::overCapacity() const
+{
+    return count_ > 0 && ((maxEntries_ != 0 && count_ > maxEntries_) || (maxBytes_ != 0 && bytes_ > maxBytes_));
+}
+
+/*
+---------------------------------------------
+End implementations for the OrderedCache class.
+---------------------------------------------
+*/
+
+#endif
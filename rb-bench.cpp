@@ -0,0 +1,83 @@
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include "avlbst.h"
+#include "rbbst.h"
+#include "bench-util.h"
+
+using namespace std;
+
+// Usage: rb-bench [num_keys] [num_ops]
+
+struct Result {
+    double insertMs;
+    double churnMs;
+    double removeMs;
+    double lookupMs;
+};
+
+template<typename Tree>
+Result run(const vector<int>& keys, const vector<int>& churn, const vector<int>& lookups, long& checksum)
+{
+    Result r;
+    Tree tree;
+    BenchTimer timer;
+    for (size_t i = 0; i < keys.size(); ++i) {
+        tree.insert(std::make_pair(keys[i], keys[i]));
+    }
+    r.insertMs = timer.elapsedMs();
+
+    // Delete-heavy churn: every step removes a live key and inserts a fresh one
+    int n = (int) keys.size();
+    timer.reset();
+    for (size_t i = 0; i < churn.size(); ++i) {
+        tree.remove(churn[i]);
+        tree.insert(std::make_pair(churn[i] + n, churn[i]));
+    }
+    r.churnMs = timer.elapsedMs();
+
+    timer.reset();
+    for (size_t i = 0; i < lookups.size(); ++i) {
+        if (tree.find(lookups[i]) != tree.end()) {
+            ++checksum;
+        }
+    }
+    r.lookupMs = timer.elapsedMs();
+
+    timer.reset();
+    for (size_t i = 0; i < keys.size(); ++i) {
+        tree.remove(keys[i]);
+        tree.remove(keys[i] + n);
+    }
+    r.removeMs = timer.elapsedMs();
+    return r;
+}
+
+int main(int argc, char *argv[])
+{
+    int n = (int) benchArg(argc, argv, 1, 1000000);
+    size_t ops = (size_t) benchArg(argc, argv, 2, 1000000);
+
+    vector<int> keys = makeShuffledKeys(n, 1);
+    vector<int> churn = makeShuffledKeys(n, 2);
+    churn.resize(std::min(ops, churn.size()));
+    vector<int> lookups = makeUniformTrace(2 * n, ops, 3);
+
+    cout << "sizeof(Node<int,int>)    = " << sizeof(Node<int, int>) << endl;
+    cout << "sizeof(AVLNode<int,int>) = " << sizeof(AVLNode<int, int>) << endl;
+    cout << "sizeof(RBNode<int,int>)  = " << sizeof(RBNode<int, int>) << endl;
+    cout << n << " keys, " << churn.size() << " churn steps, " << ops << " lookups" << endl;
+
+    long checksum = 0;
+    Result a = run<AVLTree<int, int> >(keys, churn, lookups, checksum);
+    Result r = run<RBTree<int, int> >(keys, churn, lookups, checksum);
+
+    cout << fixed << setprecision(1);
+    cout << "phase     AVLTree(ms)  RBTree(ms)" << endl;
+    cout << "insert    " << setw(11) << a.insertMs << "  " << setw(10) << r.insertMs << endl;
+    cout << "churn     " << setw(11) << a.churnMs << "  " << setw(10) << r.churnMs << endl;
+    cout << "lookup    " << setw(11) << a.lookupMs << "  " << setw(10) << r.lookupMs << endl;
+    cout << "remove    " << setw(11) << a.removeMs << "  " << setw(10) << r.removeMs << endl;
+    cout << "(checksum " << checksum << ")" << endl;
+    return 0;
+}
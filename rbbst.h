@@ -0,0 +1,498 @@
+#ifndef RBBST_H
+#define RBBST_H
+
+#include <iostream>
+#include <exception>
+#include <cstdlib>
+#include <cstdint>
+#include "bst.h"
+
+/**
+* A node for a red-black tree. The color is kept in the low bit of the
+* parent pointer (nodes are at least pointer aligned, so that bit is always
+* zero in a real address), which keeps an RBNode the same size as a plain
+* Node.
+*
+* Because of the packing, the parent must always be read through getParent()
+* and written through RBNode::setParent(), which preserves the color bit.
+* Node::setParent() (e.g. through BinarySearchTree::nodeSwap) clears the
+* color, so RBTree only lets that happen in rebalance() and merge(), which
+* recolor every node afterwards.
+*/
+template <typename Key, typename Value>
+class RBNode : public Node<Key, Value>
+{
+public:
+    // Constructor/destructor.
+    RBNode(const Key& key, const Value& value, RBNode<Key, Value>* parent);
+    virtual ~RBNode();
+
+    // Getter/setter for the node's color.
+    bool isRed() const;
+    void setRed(bool red);
+
+    // Setter for the parent that keeps the packed color bit intact.
+    void setParent(RBNode<Key, Value>* parent);
+
+    // Getters for parent, left, and right. These need to be redefined since they
+    // return pointers to RBNodes - not plain Nodes - and the parent has to have
+    // the color bit masked off.
+    virtual RBNode<Key, Value>* getParent() const override;
+    virtual RBNode<Key, Value>* getLeft() const override;
+    virtual RBNode<Key, Value>* getRight() const override;
+};
+
+/*
+  -------------------------------------------------
+  Begin implementations for the RBNode class.
+  -------------------------------------------------
+*/
+
+/**
+* An explicit constructor to initialize the elements by calling the base class constructor and setting
+* the color to red since every new node will be red when it is first inserted.
+*/
+template<class Key, class Value>
+RBNode<Key, Value>::RBNode(const Key& key, const Value& value, RBNode<Key, Value> *parent) :
+    Node<Key, Value>(key, value, parent)
+{
+    setRed(true);
+}
+
+/**
+* A destructor which does nothing.
+*/
+template<class Key, class Value>
+RBNode<Key, Value>::~RBNode()
+{
+
+}
+
+/**
+* Returns true if the node is red, false if it is black.
+*/
+template<class Key, class Value>
+bool RBNode<Key, Value>::isRed() const
+{
+    return (reinterpret_cast<uintptr_t>(this->parent_) & 1u) != 0;
+}
+
+/**
+* Sets the color bit of the node without touching the parent address.
+*/
+template<class Key, class Value>
+void RBNode<Key, Value>::setRed(bool red)
+{
+    uintptr_t bits = reinterpret_cast<uintptr_t>(this->parent_) & ~static_cast<uintptr_t>(1);
+    this->parent_ = reinterpret_cast<Node<Key, Value>*>(bits | (red ? 1u : 0u));
+}
+
+/**
+* Sets the parent address without touching the color bit.
+*/
+template<class Key, class Value>
+void RBNode<Key, Value>::setParent(RBNode<Key, Value>* parent)
+{
+    uintptr_t color = reinterpret_cast<uintptr_t>(this->parent_) & 1u;
+    this->parent_ = reinterpret_cast<Node<Key, Value>*>(reinterpret_cast<uintptr_t>(parent) | color);
+}
+
+/**
+* An overridden function for getting the parent which masks off the color bit.
+*/
+template<class Key, class Value>
+RBNode<Key, Value> *RBNode<Key, Value>::getParent() const
+{
+    uintptr_t bits = reinterpret_cast<uintptr_t>(this->parent_) & ~static_cast<uintptr_t>(1);
+    return reinterpret_cast<RBNode<Key, Value>*>(bits);
+}
+
+/**
+* Overridden for the same reasons as in AVLNode.
+*/
+template<class Key, class Value>
+RBNode<Key, Value> *RBNode<Key, Value>::getLeft() const
+{
+    return static_cast<RBNode<Key, Value>*>(this->left_);
+}
+
+/**
+* Overridden for the same reasons as in AVLNode.
+*/
+template<class Key, class Value>
+RBNode<Key, Value> *RBNode<Key, Value>::getRight() const
+{
+    return static_cast<RBNode<Key, Value>*>(this->right_);
+}
+
+/*
+  -----------------------------------------------
+  End implementations for the RBNode class.
+  -----------------------------------------------
+*/
+
+/**
+* A red-black tree. Compared to AVLTree it allows a looser balance, which
+* bounds the work done by a remove to at most three rotations (insert needs
+* at most two); the remaining fix-up work is recoloring.
+*/
+template <class Key, class Value>
+class RBTree : public BinarySearchTree<Key, Value>
+{
+public:
+    virtual void insert(const std::pair<const Key, Value>& new_item);
+    virtual void remove(const Key& key);
+    using BinarySearchTree<Key, Value>::insert;
+    void merge(RBTree& other); // See BinarySearchTree::merge
+protected:
+    virtual void afterRebuild();
+    virtual Node<Key, Value>* linkNode(Node<Key, Value>* n);
+    virtual void unlinkNode(Node<Key, Value>* n);
+
+    RBNode<Key, Value>* root() const; // Typed access to root_
+    virtual Node<Key, Value>* cloneNode(const Node<Key, Value>* src, Node<Key, Value>* parent) const;
+    void recolor(RBNode<Key, Value>* n, int depth, int redDepth); // Colors nodes at redDepth red, the rest black
+    static bool isRed(RBNode<Key, Value>* n); // NULL leaves count as black
+    void attachLeaf(RBNode<Key, Value>* n, RBNode<Key, Value>* parent); // Links red leaf n under parent and fixes up
+    void insertFix(RBNode<Key, Value>* n);
+    void removeFix(RBNode<Key, Value>* x, RBNode<Key, Value>* xParent);
+    void transplant(RBNode<Key, Value>* u, RBNode<Key, Value>* v); // Puts v in u's place under u's parent
+    void rotateLeft(RBNode<Key, Value>* x);
+    void rotateRight(RBNode<Key, Value>* x);
+};
+
+/*
+--------------------------------------------
+Begin implementations for the RBTree class.
+--------------------------------------------
+*/
+
+/*
+ * Recall: If key is already in the tree, you should
+ * overwrite the current value with the updated value.
+ */
+template<class Key, class Value>
+void RBTree<Key, Value>::insert(const std::pair<const Key, Value>& new_item)
+{
+    Node<Key, Value>* parent;
+    Node<Key, Value>* current = this->findSlot(new_item.first, parent);
+    if (current != nullptr) { // if its equal overwrite the value
+        current->setValue(new_item.second);
+        return;
+    }
+    RBNode<Key, Value>* rbParent = static_cast<RBNode<Key, Value>*>(parent);
+    attachLeaf(new RBNode<Key, Value>(new_item.first, new_item.second, rbParent), rbParent);
+}
+
+template<class Key, class Value>
+Node<Key, Value>* RBTree<Key, Value>::linkNode(Node<Key, Value>* n)
+{
+    Node<Key, Value>* parent;
+    Node<Key, Value>* existing = this->findSlot(n->getKey(), parent);
+    if (existing == nullptr) {
+        attachLeaf(static_cast<RBNode<Key, Value>*>(n), static_cast<RBNode<Key, Value>*>(parent));
+    }
+    return existing;
+}
+
+template<class Key, class Value>
+void RBTree<Key, Value>::attachLeaf(RBNode<Key, Value>* n, RBNode<Key, Value>* parent)
+{
+    n->setParent(parent);
+    n->setRed(true);
+    if (parent == nullptr) {
+        this->root_ = n;
+    } else if (n->getKey() < parent->getKey()) {
+        parent->setLeft(n);
+    } else {
+        parent->setRight(n);
+    }
+    insertFix(n);
+}
+
+/**
+* Restores the red-black properties after n was inserted red.
+*/
+template<class Key, class Value>
+void RBTree<Key, Value>::insertFix(RBNode<Key, Value>* n)
+{
+    while (isRed(n->getParent())) {
+        RBNode<Key, Value>* p = n->getParent();
+        RBNode<Key, Value>* g = p->getParent(); // a red parent is never the root
+        if (p == g->getLeft()) {
+            RBNode<Key, Value>* uncle = g->getRight();
+            if (isRed(uncle)) { // recolor and continue from g
+                p->setRed(false);
+                uncle->setRed(false);
+                g->setRed(true);
+                n = g;
+            } else {
+                if (n == p->getRight()) { // zig-zag
+                    rotateLeft(p);
+                    n = p;
+                    p = n->getParent();
+                }
+                p->setRed(false);
+                g->setRed(true);
+                rotateRight(g);
+            }
+        } else {
+            RBNode<Key, Value>* uncle = g->getLeft();
+            if (isRed(uncle)) {
+                p->setRed(false);
+                uncle->setRed(false);
+                g->setRed(true);
+                n = g;
+            } else {
+                if (n == p->getLeft()) {
+                    rotateRight(p);
+                    n = p;
+                    p = n->getParent();
+                }
+                p->setRed(false);
+                g->setRed(true);
+                rotateLeft(g);
+            }
+        }
+    }
+    root()->setRed(false);
+}
+
+/*
+ * Recall: The writeup specifies that if a node has 2 children you
+ * should swap with the predecessor and then remove.
+ */
+template<class Key, class Value>
+void RBTree<Key, Value>::remove(const Key& key)
+{
+    Node<Key, Value>* n = this->internalFind(key);
+    if (n == nullptr) {
+        return;
+    }
+    this->evictCached(key);
+    unlinkNode(n);
+    delete n;
+}
+
+/**
+* Colors only make sense for RBNodes, so only another RBTree merges in;
+* afterRebuild() then recolors the merged tree.
+*/
+template<class Key, class Value>
+void RBTree<Key, Value>::merge(RBTree<Key, Value>& other)
+{
+    this->mergeFrom(other);
+}
+
+/**
+* Splices the node out, moving its predecessor into its place if it has two
+* children, and repairs the colors if a black node left its path.
+*/
+template<class Key, class Value>
+void RBTree<Key, Value>::unlinkNode(Node<Key, Value>* node)
+{
+    RBNode<Key, Value>* n = static_cast<RBNode<Key, Value>*>(node);
+    bool removedRed = n->isRed();
+    RBNode<Key, Value>* x = nullptr;       // node that moves into the removed spot
+    RBNode<Key, Value>* xParent = nullptr; // its parent, since x may be NULL
+    if (n->getLeft() == nullptr) {
+        x = n->getRight();
+        xParent = n->getParent();
+        transplant(n, x);
+    } else if (n->getRight() == nullptr) {
+        x = n->getLeft();
+        xParent = n->getParent();
+        transplant(n, x);
+    } else {
+        // Move the predecessor into n's position and take over n's color
+        RBNode<Key, Value>* pred = n->getLeft();
+        while (pred->getRight() != nullptr) {
+            pred = pred->getRight();
+        }
+        removedRed = pred->isRed();
+        x = pred->getLeft();
+        if (pred->getParent() == n) {
+            xParent = pred;
+        } else {
+            xParent = pred->getParent();
+            transplant(pred, x);
+            pred->setLeft(n->getLeft());
+            pred->getLeft()->setParent(pred);
+        }
+        transplant(n, pred);
+        pred->setRight(n->getRight());
+        pred->getRight()->setParent(pred);
+        pred->setRed(n->isRed());
+    }
+    if (!removedRed) {
+        removeFix(x, xParent);
+    }
+}
+
+/**
+* Restores the red-black properties after a black node was unlinked. x carries
+* the extra black and may be NULL, which is why its parent is passed in.
+*/
+template<class Key, class Value>
+void RBTree<Key, Value>::removeFix(RBNode<Key, Value>* x, RBNode<Key, Value>* xParent)
+{
+    while (x != root() && !isRed(x)) {
+        if (x == xParent->getLeft()) {
+            RBNode<Key, Value>* w = xParent->getRight();
+            if (isRed(w)) {
+                w->setRed(false);
+                xParent->setRed(true);
+                rotateLeft(xParent);
+                w = xParent->getRight();
+            }
+            if (!isRed(w->getLeft()) && !isRed(w->getRight())) {
+                w->setRed(true);
+                x = xParent;
+                xParent = x->getParent();
+            } else {
+                if (!isRed(w->getRight())) {
+                    w->getLeft()->setRed(false);
+                    w->setRed(true);
+                    rotateRight(w);
+                    w = xParent->getRight();
+                }
+                w->setRed(xParent->isRed());
+                xParent->setRed(false);
+                w->getRight()->setRed(false);
+                rotateLeft(xParent);
+                x = root();
+            }
+        } else {
+            RBNode<Key, Value>* w = xParent->getLeft();
+            if (isRed(w)) {
+                w->setRed(false);
+                xParent->setRed(true);
+                rotateRight(xParent);
+                w = xParent->getLeft();
+            }
+            if (!isRed(w->getLeft()) && !isRed(w->getRight())) {
+                w->setRed(true);
+                x = xParent;
+                xParent = x->getParent();
+            } else {
+                if (!isRed(w->getLeft())) {
+                    w->getRight()->setRed(false);
+                    w->setRed(true);
+                    rotateLeft(w);
+                    w = xParent->getLeft();
+                }
+                w->setRed(xParent->isRed());
+                xParent->setRed(false);
+                w->getLeft()->setRed(false);
+                rotateRight(xParent);
+                x = root();
+            }
+        }
+    }
+    if (x != nullptr) {
+        x->setRed(false);
+    }
+}
+
+/**
+* Copies keep their color, since the copy has the same shape.
+*/
+template<class Key, class Value>
+Node<Key, Value>* RBTree<Key, Value>::cloneNode(const Node<Key, Value>* src, Node<Key, Value>* parent) const
+{
+    RBNode<Key, Value>* node = new RBNode<Key, Value>(src->getKey(), src->getValue(), static_cast<RBNode<Key, Value>*>(parent));
+    node->setRed(static_cast<const RBNode<Key, Value>*>(src)->isRed());
+    return node;
+}
+
+/**
+* The base class rebuild rewrites parent pointers through Node::setParent
+* and so loses the colors. Its tree has every level full except possibly the
+* bottom one, so that level is colored red and everything else black.
+*/
+template<class Key, class Value>
+void RBTree<Key, Value>::afterRebuild()
+{
+    if (this->root_ == nullptr) {
+        return;
+    }
+    size_t count = this->subtreeSize(this->root_);
+    int fullLevels = 0;
+    for (size_t full = 1; full <= count; full = full * 2 + 1) {
+        ++fullLevels;
+    }
+    recolor(root(), 0, fullLevels);
+}
+
+template<class Key, class Value>
+void RBTree<Key, Value>::recolor(RBNode<Key, Value>* n, int depth, int redDepth)
+{
+    if (n == nullptr) {
+        return;
+    }
+    n->setRed(depth == redDepth);
+    recolor(n->getLeft(), depth + 1, redDepth);
+    recolor(n->getRight(), depth + 1, redDepth);
+}
+
+template<class Key, class Value>
+RBNode<Key, Value>* RBTree<Key, Value>::root() const
+{
+    return static_cast<RBNode<Key, Value>*>(this->root_);
+}
+
+template<class Key, class Value>
+bool RBTree<Key, Value>::isRed(RBNode<Key, Value>* n)
+{
+    return n != nullptr && n->isRed();
+}
+
+template<class Key, class Value>
+void RBTree<Key, Value>::transplant(RBNode<Key, Value>* u, RBNode<Key, Value>* v)
+{
+    RBNode<Key, Value>* p = u->getParent();
+    if (p == nullptr) {
+        this->root_ = v;
+    } else if (u == p->getLeft()) {
+        p->setLeft(v);
+    } else {
+        p->setRight(v);
+    }
+    if (v != nullptr) {
+        v->setParent(p);
+    }
+}
+
+template<class Key, class Value>
+void RBTree<Key, Value>::rotateLeft(RBNode<Key, Value>* x)
+{
+    RBNode<Key, Value>* y = x->getRight();
+    x->setRight(y->getLeft());
+    if (y->getLeft() != nullptr) {
+        y->getLeft()->setParent(x);
+    }
+    transplant(x, y);
+    y->setLeft(x);
+    x->setParent(y);
+}
+
+template<class Key, class Value>
+void RBTree<Key, Value>::rotateRight(RBNode<Key, Value>* x)
+{
+    RBNode<Key, Value>* y = x->getLeft();
+    x->setLeft(y->getRight());
+    if (y->getRight() != nullptr) {
+        y->getRight()->setParent(x);
+    }
+    transplant(x, y);
+    y->setRight(x);
+    x->setParent(y);
+}
+
+/*
+------------------------------------------
+End implementations for the RBTree class.
+------------------------------------------
+*/
+
+#endif
@@ -0,0 +1,46 @@
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include "avlbst.h"
+#include "stackavlbst.h"
+#include "threadedavlbst.h"
+#include "bench-util.h"
+
+using namespace std;
+
+// Usage: scan-bench [num_keys] [num_scans]
+
+template<typename Tree>
+void timeScans(const char* name, const vector<int>& keys, int scans)
+{
+    Tree tree;
+    for (size_t i = 0; i < keys.size(); ++i) {
+        tree.insert(std::make_pair(keys[i], keys[i]));
+    }
+    long checksum = 0;
+    BenchTimer timer;
+    for (int s = 0; s < scans; ++s) {
+        for (typename Tree::iterator it = tree.begin(); it != tree.end(); ++it) {
+            checksum += it->second;
+        }
+    }
+    double ms = timer.elapsedMs();
+    cout << name << setw(9) << ms << "  " << setw(9) << keys.size() * (double) scans / ms / 1000.0
+         << "   (checksum " << checksum << ")" << endl;
+}
+
+int main(int argc, char *argv[])
+{
+    int n = (int) benchArg(argc, argv, 1, 1000000);
+    int scans = (int) benchArg(argc, argv, 2, 20);
+
+    vector<int> keys = makeShuffledKeys(n, 1);
+
+    cout << n << " keys, " << scans << " full in-order scans" << endl;
+    cout << fixed << setprecision(1);
+    cout << "tree              time(ms)  Mitems/s" << endl;
+    timeScans<AVLTree<int, int> >("AVLTree          ", keys, scans);
+    timeScans<StackAVLTree<int, int> >("StackAVLTree     ", keys, scans);
+    timeScans<ThreadedAVLTree<int, int> >("ThreadedAVLTree  ", keys, scans);
+    return 0;
+}
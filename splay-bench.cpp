@@ -0,0 +1,56 @@
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include "avlbst.h"
+#include "splaybst.h"
+#include "bench-util.h"
+
+using namespace std;
+
+// Usage: splay-bench [num_keys] [num_lookups]
+
+template<typename Tree>
+double runLookups(Tree& tree, const vector<int>& trace, long& checksum)
+{
+    BenchTimer timer;
+    for (size_t i = 0; i < trace.size(); ++i) {
+        checksum += tree.find(trace[i])->second;
+    }
+    return timer.elapsedMs();
+}
+
+template<typename Tree>
+void fill(Tree& tree, const vector<int>& keys)
+{
+    for (size_t i = 0; i < keys.size(); ++i) {
+        tree.insert(std::make_pair(keys[i], keys[i]));
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    int n = (int) benchArg(argc, argv, 1, 1000000);
+    size_t lookups = (size_t) benchArg(argc, argv, 2, 2000000);
+
+    vector<int> keys = makeShuffledKeys(n, 1);
+    vector<int> zipf = makeZipfTrace(n, lookups, 0.99, 2);
+    vector<int> uniform = makeUniformTrace(n, lookups, 3);
+
+    AVLTree<int, int> avl;
+    SplayTree<int, int> splay;
+    fill(avl, keys);
+    fill(splay, keys);
+
+    long checksum = 0;
+    cout << n << " keys, " << lookups << " lookups per trace" << endl;
+    cout << fixed << setprecision(1);
+    cout << "trace     AVLTree(ms)  SplayTree(ms)" << endl;
+    double a = runLookups(avl, zipf, checksum);
+    double s = runLookups(splay, zipf, checksum);
+    cout << "zipf      " << setw(11) << a << "  " << setw(13) << s << endl;
+    a = runLookups(avl, uniform, checksum);
+    s = runLookups(splay, uniform, checksum);
+    cout << "uniform   " << setw(11) << a << "  " << setw(13) << s << endl;
+    cout << "(checksum " << checksum << ")" << endl;
+    return 0;
+}
@@ -0,0 +1,278 @@
+#ifndef SPLAYBST_H
+#define SPLAYBST_H
+
+#include <iostream>
+#include <exception>
+#include <cstdlib>
+#include "bst.h"
+
+/**
+* A self-adjusting binary search tree. Every access (insert, remove or
+* a non-const find/operator[]) splays the touched node to the root, so
+* frequently used keys migrate toward the top of the tree. No extra data
+* is stored per node; SplayTree uses the plain Node class from bst.h.
+*
+* Lookups through a const SplayTree do not restructure the tree and behave
+* exactly like BinarySearchTree lookups.
+*/
+template <class Key, class Value>
+class SplayTree : public BinarySearchTree<Key, Value>
+{
+public:
+    virtual void insert(const std::pair<const Key, Value>& keyValuePair);
+    virtual void remove(const Key& key);
+    using BinarySearchTree<Key, Value>::insert;
+    void merge(SplayTree& other); // See BinarySearchTree::merge
+
+    using BinarySearchTree<Key, Value>::find;
+    typename BinarySearchTree<Key, Value>::iterator find(const Key& key);
+    using BinarySearchTree<Key, Value>::operator[];
+    Value& operator[](const Key& key);
+
+protected:
+    virtual Node<Key, Value>* linkNode(Node<Key, Value>* n);
+    virtual void unlinkNode(Node<Key, Value>* n);
+
+    Node<Key, Value>* splayFind(const Key& key); // Splays the last visited node and returns the match or NULL
+    void splay(Node<Key, Value>* x); // Rotates x up until it is the root
+    void rotateUp(Node<Key, Value>* x); // Single rotation of x over its parent
+};
+
+/*
+--------------------------------------------
+Begin implementations for the SplayTree class.
+--------------------------------------------
+*/
+
+/**
+* Inserts the pair as a leaf like a regular BST insert and then splays the
+* new (or overwritten) node to the root.
+*/
+template<class Key, class Value>
+void SplayTree<Key, Value>::insert(const std::pair<const Key, Value>& keyValuePair)
+{
+    if (this->root_ == nullptr) {
+        this->root_ = new Node<Key, Value>(keyValuePair.first, keyValuePair.second, nullptr);
+        return;
+    }
+    Node<Key, Value>* current = this->root_;
+    while (true) {
+        if (keyValuePair.first < current->getKey()) {
+            if (current->getLeft() == nullptr) {
+                Node<Key, Value>* newNode = new Node<Key, Value>(keyValuePair.first, keyValuePair.second, current);
+                current->setLeft(newNode);
+                current = newNode;
+                break;
+            }
+            current = current->getLeft();
+        } else if (current->getKey() < keyValuePair.first) {
+            if (current->getRight() == nullptr) {
+                Node<Key, Value>* newNode = new Node<Key, Value>(keyValuePair.first, keyValuePair.second, current);
+                current->setRight(newNode);
+                current = newNode;
+                break;
+            }
+            current = current->getRight();
+        } else { // if its equal overwrite the value
+            current->setValue(keyValuePair.second);
+            break;
+        }
+    }
+    splay(current);
+}
+
+/**
+* Splays the node with the given key to the root, unlinks it and joins its
+* two subtrees by splaying the largest key of the left subtree to the top
+* of that subtree and hanging the right subtree off of it.
+*/
+template<class Key, class Value>
+void SplayTree<Key, Value>::remove(const Key& key)
+{
+    Node<Key, Value>* nodeToRemove = splayFind(key);
+    if (nodeToRemove == nullptr) {
+        return;
+    }
+    this->evictCached(key);
+    unlinkNode(nodeToRemove);
+    delete nodeToRemove;
+}
+
+template<class Key, class Value>
+void SplayTree<Key, Value>::merge(SplayTree<Key, Value>& other)
+{
+    this->mergeFrom(other);
+}
+
+/**
+* Hangs n in as a leaf and splays it to the root, like insert. A node that
+* already holds the key is splayed instead and returned.
+*/
+template<class Key, class Value>
+Node<Key, Value>* SplayTree<Key, Value>::linkNode(Node<Key, Value>* n)
+{
+    Node<Key, Value>* parent;
+    Node<Key, Value>* existing = this->findSlot(n->getKey(), parent);
+    if (existing != nullptr) {
+        splay(existing);
+        return existing;
+    }
+    n->setParent(parent);
+    if (parent == nullptr) {
+        this->root_ = n;
+        return nullptr;
+    }
+    if (n->getKey() < parent->getKey()) {
+        parent->setLeft(n);
+    } else {
+        parent->setRight(n);
+    }
+    splay(n);
+    return nullptr;
+}
+
+/**
+* Splays n to the root (a no-op after splayFind) and joins its subtrees.
+*/
+template<class Key, class Value>
+void SplayTree<Key, Value>::unlinkNode(Node<Key, Value>* n)
+{
+    splay(n);
+    Node<Key, Value>* left = n->getLeft();
+    Node<Key, Value>* right = n->getRight();
+
+    if (left == nullptr) {
+        this->root_ = right;
+        if (right != nullptr) {
+            right->setParent(nullptr);
+        }
+        return;
+    }
+    left->setParent(nullptr);
+    this->root_ = left;
+    Node<Key, Value>* largest = left;
+    while (largest->getRight() != nullptr) {
+        largest = largest->getRight();
+    }
+    splay(largest); // largest is now the root and has no right child
+    largest->setRight(right);
+    if (right != nullptr) {
+        right->setParent(largest);
+    }
+}
+
+/**
+* Returns an iterator to the item with the given key, or end() if it does
+* not exist. The node that was found (or the last node visited on a miss)
+* is splayed to the root.
+*/
+template<class Key, class Value>
+typename BinarySearchTree<Key, Value>::iterator
+SplayTree<Key, Value>::find(const Key& key)
+{
+    if (splayFind(key) == nullptr) {
+        return this->end();
+    }
+    // The match is now the root, so the base lookup stops immediately
+    return BinarySearchTree<Key, Value>::find(key);
+}
+
+/**
+ * @precondition The key exists in the map
+ * Returns the value associated with the key and splays it to the root
+ */
+template<class Key, class Value>
+Value& SplayTree<Key, Value>::operator[](const Key& key)
+{
+    Node<Key, Value>* curr = splayFind(key);
+    if (curr == NULL) throw std::out_of_range("Invalid key");
+    return curr->getValue();
+}
+
+/**
+* Walks down from the root looking for key. Whatever node the search ends
+* on is splayed to the root; the matching node is returned, or NULL.
+*/
+template<class Key, class Value>
+Node<Key, Value>* SplayTree<Key, Value>::splayFind(const Key& key)
+{
+    Node<Key, Value>* current = this->root_;
+    Node<Key, Value>* last = nullptr;
+    while (current != nullptr) {
+        last = current;
+        if (key < current->getKey()) {
+            current = current->getLeft();
+        } else if (current->getKey() < key) {
+            current = current->getRight();
+        } else {
+            break;
+        }
+    }
+    if (last != nullptr) {
+        splay(last);
+    }
+    return current;
+}
+
+/**
+* Moves x to the root using zig, zig-zig and zig-zag steps.
+*/
+template<class Key, class Value>
+void SplayTree<Key, Value>::splay(Node<Key, Value>* x)
+{
+    while (x->getParent() != nullptr) {
+        Node<Key, Value>* p = x->getParent();
+        Node<Key, Value>* g = p->getParent();
+        if (g == nullptr) { // zig
+            rotateUp(x);
+        } else if ((x == p->getLeft()) == (p == g->getLeft())) { // zig-zig
+            rotateUp(p);
+            rotateUp(x);
+        } else { // zig-zag
+            rotateUp(x);
+            rotateUp(x);
+        }
+    }
+}
+
+/**
+* Rotates x above its parent, rewiring the grandparent (or root_) as well.
+*/
+template<class Key, class Value>
+void SplayTree<Key, Value>::rotateUp(Node<Key, Value>* x)
+{
+    Node<Key, Value>* p = x->getParent();
+    Node<Key, Value>* g = p->getParent();
+    if (x == p->getLeft()) {
+        Node<Key, Value>* middle = x->getRight();
+        p->setLeft(middle);
+        if (middle != nullptr) {
+            middle->setParent(p);
+        }
+        x->setRight(p);
+    } else {
+        Node<Key, Value>* middle = x->getLeft();
+        p->setRight(middle);
+        if (middle != nullptr) {
+            middle->setParent(p);
+        }
+        x->setLeft(p);
+    }
+    p->setParent(x);
+    x->setParent(g);
+    if (g == nullptr) {
+        this->root_ = x;
+    } else if (g->getLeft() == p) {
+        g->setLeft(x);
+    } else {
+        g->setRight(x);
+    }
+}
+
+/*
+------------------------------------------
+End implementations for the SplayTree class.
+------------------------------------------
+*/
+
+#endif
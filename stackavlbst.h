@@ -0,0 +1,662 @@
+#ifndef STACKAVLBST_H
+#define STACKAVLBST_H
+
+#include <iostream>
+#include <exception>
+#include <stdexcept>
+#include <cstdlib>
+#include <cstdint>
+#include <algorithm>
+
+/**
+* An AVL tree whose nodes have no parent pointer (and no vptr): just the
+* item, two children and the balance. Everything that used to walk upward
+* works from a recorded root-to-node path instead: insert and remove keep the
+* path of their descent and rebalance along it, and iterators carry the
+* ancestors they still have to visit on a small fixed-size stack.
+*
+* kMaxHeight bounds the depth of those paths. An AVL tree of height h holds
+* at least Fib(h + 2) - 1 nodes, so 64 levels covers any tree with fewer than
+* about 2.7e13 entries, far more than fits in memory.
+*/
+
+/**
+* A node for StackAVLTree.
+*/
+template <typename Key, typename Value>
+class StackAVLNode
+{
+public:
+    StackAVLNode(const Key& key, const Value& value);
+
+    const std::pair<const Key, Value>& getItem() const;
+    std::pair<const Key, Value>& getItem();
+    const Key& getKey() const;
+    const Value& getValue() const;
+    Value& getValue();
+    void setValue(const Value &value);
+
+    StackAVLNode<Key, Value>* getLeft() const;
+    StackAVLNode<Key, Value>* getRight() const;
+    int8_t getBalance() const;
+    void setBalance(int8_t balance);
+
+    std::pair<const Key, Value> item_;
+    StackAVLNode<Key, Value>* left_;
+    StackAVLNode<Key, Value>* right_;
+    int8_t balance_;
+};
+
+/*
+  ----------------------------------------------
+  Begin implementations for the StackAVLNode class.
+  ----------------------------------------------
+*/
+
+template<typename Key, typename Value>
+StackAVLNode<Key, Value>::StackAVLNode(const Key& key, const Value& value) :
+    item_(key, value),
+    left_(NULL),
+    right_(NULL),
+    balance_(0)
+{
+
+}
+
+template<typename Key, typename Value>
+const std::pair<const Key, Value>& StackAVLNode<Key, Value>::getItem() const
+{
+    return item_;
+}
+
+template<typename Key, typename Value>
+std::pair<const Key, Value>& StackAVLNode<Key, Value>::getItem()
+{
+    return item_;
+}
+
+template<typename Key, typename Value>
+const Key& StackAVLNode<Key, Value>::getKey() const
+{
+    return item_.first;
+}
+
+template<typename Key, typename Value>
+const Value& StackAVLNode<Key, Value>::getValue() const
+{
+    return item_.second;
+}
+
+template<typename Key, typename Value>
+Value& StackAVLNode<Key, Value>::getValue()
+{
+    return item_.second;
+}
+
+template<typename Key, typename Value>
+void StackAVLNode<Key, Value>::setValue(const Value& value)
+{
+    item_.second = value;
+}
+
+template<typename Key, typename Value>
+StackAVLNode<Key, Value>* StackAVLNode<Key, Value>::getLeft() const
+{
+    return left_;
+}
+
+template<typename Key, typename Value>
+StackAVLNode<Key, Value>* StackAVLNode<Key, Value>::getRight() const
+{
+    return right_;
+}
+
+template<typename Key, typename Value>
+int8_t StackAVLNode<Key, Value>::getBalance() const
+{
+    return balance_;
+}
+
+template<typename Key, typename Value>
+void StackAVLNode<Key, Value>::setBalance(int8_t balance)
+{
+    balance_ = balance;
+}
+
+/*
+  --------------------------------------------
+  End implementations for the StackAVLNode class.
+  --------------------------------------------
+*/
+
+template <typename Key, typename Value>
+class StackAVLTree
+{
+public:
+    static const int kMaxHeight = 64;
+
+    StackAVLTree();
+    ~StackAVLTree();
+
+    void insert(const std::pair<const Key, Value>& keyValuePair);
+    void remove(const Key& key);
+    void clear();
+    bool isBalanced() const;
+    void print() const;
+    bool empty() const;
+
+    /**
+    * An iterator that remembers the ancestors it still has to visit: the top
+    * of the stack is the current node, below it every ancestor whose left
+    * subtree contains the current node.
+    */
+    class iterator
+    {
+    public:
+        iterator();
+
+        std::pair<const Key,Value>& operator*() const;
+        std::pair<const Key,Value>* operator->() const;
+
+        bool operator==(const iterator& rhs) const;
+        bool operator!=(const iterator& rhs) const;
+
+        iterator& operator++();
+
+    protected:
+        friend class StackAVLTree<Key, Value>;
+        void pushLeftSpine(StackAVLNode<Key, Value>* node);
+        StackAVLNode<Key, Value>* stack_[kMaxHeight];
+        int depth_;
+    };
+
+    iterator begin() const;
+    iterator end() const;
+    iterator find(const Key& key) const;
+    Value& operator[](const Key& key);
+    Value const & operator[](const Key& key) const;
+
+protected:
+    typedef StackAVLNode<Key, Value> SNode;
+
+    SNode* internalFind(const Key& key) const;
+    SNode*& link(SNode** path, const bool* wentRight, int i); // The pointer that holds path[i]
+    static void rotateLeft(SNode*& link);
+    static void rotateRight(SNode*& link);
+    static void rotateRightLeft(SNode*& link);
+    static void rotateLeftRight(SNode*& link);
+    void clearHelper(SNode* node);
+    int height(SNode* node) const;
+    bool isBalancedHelper(SNode* node) const;
+
+    StackAVLTree(const StackAVLTree&);            // not copyable
+    StackAVLTree& operator=(const StackAVLTree&);
+
+    SNode* root_;
+};
+
+/*
+---------------------------------------------------------
+Begin implementations for the StackAVLTree::iterator class.
+---------------------------------------------------------
+*/
+
+template<class Key, class Value>
+StackAVLTree<Key, Value>::iterator::iterator() : depth_(0)
+{
+}
+
+template<class Key, class Value>
+std::pair<const Key,Value> &
+StackAVLTree<Key, Value>::iterator::operator*() const
+{
+    return stack_[depth_ - 1]->getItem();
+}
+
+template<class Key, class Value>
+std::pair<const Key,Value> *
+StackAVLTree<Key, Value>::iterator::operator->() const
+{
+    return &(stack_[depth_ - 1]->getItem());
+}
+
+/**
+* Two iterators are equal when they point at the same node (or are both end).
+*/
+template<class Key, class Value>
+bool StackAVLTree<Key, Value>::iterator::operator==(const iterator& rhs) const
+{
+    if (depth_ == 0 || rhs.depth_ == 0) {
+        return depth_ == rhs.depth_;
+    }
+    return stack_[depth_ - 1] == rhs.stack_[rhs.depth_ - 1];
+}
+
+template<class Key, class Value>
+bool StackAVLTree<Key, Value>::iterator::operator!=(const iterator& rhs) const
+{
+    return !(*this == rhs);
+}
+
+/**
+* Pops the current node; its successor is the leftmost node of its right
+* subtree if it has one, otherwise the ancestor now on top of the stack.
+*/
+template<class Key, class Value>
+typename StackAVLTree<Key, Value>::iterator&
+StackAVLTree<Key, Value>::iterator::operator++()
+{
+    SNode* current = stack_[--depth_];
+    pushLeftSpine(current->getRight());
+    return *this;
+}
+
+template<class Key, class Value>
+void StackAVLTree<Key, Value>::iterator::pushLeftSpine(StackAVLNode<Key, Value>* node)
+{
+    while (node != nullptr) {
+        stack_[depth_++] = node;
+        node = node->getLeft();
+    }
+}
+
+/*
+-------------------------------------------------------
+End implementations for the StackAVLTree::iterator class.
+-------------------------------------------------------
+*/
+
+/*
+------------------------------------------------
+Begin implementations for the StackAVLTree class.
+------------------------------------------------
+*/
+
+template<class Key, class Value>
+StackAVLTree<Key, Value>::StackAVLTree() : root_(nullptr)
+{
+}
+
+template<class Key, class Value>
+StackAVLTree<Key, Value>::~StackAVLTree()
+{
+    clear();
+}
+
+template<class Key, class Value>
+void StackAVLTree<Key, Value>::clear()
+{
+    clearHelper(root_);
+    root_ = nullptr;
+}
+
+template<class Key, class Value>
+void StackAVLTree<Key, Value>::clearHelper(SNode* node)
+{
+    if (node == nullptr) {
+        return;
+    }
+    clearHelper(node->getLeft());
+    clearHelper(node->getRight());
+    delete node;
+}
+
+template<class Key, class Value>
+bool StackAVLTree<Key, Value>::empty() const
+{
+    return root_ == nullptr;
+}
+
+/**
+* Prints the contents in key order, one entry per line.
+*/
+template<class Key, class Value>
+void StackAVLTree<Key, Value>::print() const
+{
+    for (iterator it = begin(); it != end(); ++it) {
+        std::cout << it->first << " " << it->second << std::endl;
+    }
+}
+
+template<class Key, class Value>
+typename StackAVLTree<Key, Value>::iterator
+StackAVLTree<Key, Value>::begin() const
+{
+    iterator it;
+    it.pushLeftSpine(root_);
+    return it;
+}
+
+template<class Key, class Value>
+typename StackAVLTree<Key, Value>::iterator
+StackAVLTree<Key, Value>::end() const
+{
+    return iterator();
+}
+
+/**
+* Returns an iterator to key, recording every ancestor where the search
+* went left so that ++ can continue from there, or end() on a miss.
+*/
+template<class Key, class Value>
+typename StackAVLTree<Key, Value>::iterator
+StackAVLTree<Key, Value>::find(const Key& key) const
+{
+    iterator it;
+    SNode* current = root_;
+    while (current != nullptr) {
+        if (key == current->getKey()) {
+            it.stack_[it.depth_++] = current;
+            return it;
+        } else if (key < current->getKey()) {
+            it.stack_[it.depth_++] = current;
+            current = current->getLeft();
+        } else {
+            current = current->getRight();
+        }
+    }
+    return end();
+}
+
+/**
+ * @precondition The key exists in the map
+ * Returns the value associated with the key
+ */
+template<class Key, class Value>
+Value& StackAVLTree<Key, Value>::operator[](const Key& key)
+{
+    SNode* curr = internalFind(key);
+    if(curr == NULL) throw std::out_of_range("Invalid key");
+    return curr->getValue();
+}
+template<class Key, class Value>
+Value const & StackAVLTree<Key, Value>::operator[](const Key& key) const
+{
+    SNode* curr = internalFind(key);
+    if(curr == NULL) throw std::out_of_range("Invalid key");
+    return curr->getValue();
+}
+
+template<class Key, class Value>
+typename StackAVLTree<Key, Value>::SNode* StackAVLTree<Key, Value>::internalFind(const Key& key) const
+{
+    SNode* current = root_;
+    while (current != nullptr) {
+        if (key == current->getKey()) {
+            return current;
+        }
+        current = (key < current->getKey()) ? current->getLeft() : current->getRight();
+    }
+    return nullptr;
+}
+
+/*
+ * Recall: If key is already in the tree, you should
+ * overwrite the current value with the updated value.
+ */
+template<class Key, class Value>
+void StackAVLTree<Key, Value>::insert(const std::pair<const Key, Value>& keyValuePair)
+{
+    SNode* path[kMaxHeight + 1];
+    bool wentRight[kMaxHeight + 1];
+    int d = 0;
+    SNode* current = root_;
+    while (current != nullptr) {
+        if (keyValuePair.first == current->getKey()) { // if its equal overwrite the value
+            current->setValue(keyValuePair.second);
+            return;
+        }
+        path[d] = current;
+        wentRight[d] = current->getKey() < keyValuePair.first;
+        current = wentRight[d] ? current->getRight() : current->getLeft();
+        ++d;
+    }
+    SNode* newNode = new SNode(keyValuePair.first, keyValuePair.second);
+    if (d == 0) {
+        root_ = newNode;
+        return;
+    }
+    link(path, wentRight, d) = newNode;
+
+    // Retrace from the new node's parent while subtrees keep getting taller
+    for (int i = d - 1; i >= 0; --i) {
+        SNode* p = path[i];
+        int b = p->getBalance() + (wentRight[i] ? 1 : -1);
+        if (b == 0) {
+            p->setBalance(0);
+            return;
+        }
+        if (b == 1 || b == -1) {
+            p->setBalance(b);
+            continue;
+        }
+        SNode*& top = link(path, wentRight, i);
+        if (b == -2) {
+            if (p->getLeft()->getBalance() > 0) {
+                rotateLeftRight(top);
+            } else {
+                rotateRight(top);
+            }
+        } else {
+            if (p->getRight()->getBalance() < 0) {
+                rotateRightLeft(top);
+            } else {
+                rotateLeft(top);
+            }
+        }
+        return;
+    }
+}
+
+/*
+ * Recall: The writeup specifies that if a node has 2 children you
+ * should swap with the predecessor and then remove.
+ */
+template<class Key, class Value>
+void StackAVLTree<Key, Value>::remove(const Key& key)
+{
+    SNode* path[kMaxHeight + 1];
+    bool wentRight[kMaxHeight + 1];
+    int d = 0;
+    SNode* z = root_;
+    while (z != nullptr && !(key == z->getKey())) {
+        path[d] = z;
+        wentRight[d] = z->getKey() < key;
+        z = wentRight[d] ? z->getRight() : z->getLeft();
+        ++d;
+    }
+    if (z == nullptr) {
+        return;
+    }
+    path[d] = z;
+    int zi = d;
+    if (z->getLeft() != nullptr && z->getRight() != nullptr) {
+        // Extend the path to the predecessor y and relink y into z's place
+        wentRight[d] = false;
+        SNode* y = z->getLeft();
+        path[++d] = y;
+        while (y->getRight() != nullptr) {
+            wentRight[d] = true;
+            y = y->getRight();
+            path[++d] = y;
+        }
+        link(path, wentRight, d) = y->getLeft();
+        y->left_ = z->getLeft();
+        y->right_ = z->getRight();
+        y->setBalance(z->getBalance());
+        link(path, wentRight, zi) = y;
+        path[zi] = y;
+    } else {
+        link(path, wentRight, d) = (z->getLeft() != nullptr) ? z->getLeft() : z->getRight();
+    }
+    delete z;
+
+    // path[d] was unlinked; retrace from its parent while heights keep shrinking
+    for (int i = d - 1; i >= 0; --i) {
+        SNode* p = path[i];
+        int b = p->getBalance() + (wentRight[i] ? -1 : 1);
+        if (b == 1 || b == -1) {
+            p->setBalance(b);
+            return;
+        }
+        if (b == 0) {
+            p->setBalance(0);
+            continue;
+        }
+        SNode*& top = link(path, wentRight, i);
+        if (b == 2) {
+            int br = p->getRight()->getBalance();
+            if (br < 0) {
+                rotateRightLeft(top);
+            } else {
+                rotateLeft(top);
+            }
+            if (br == 0) {
+                return; // height unchanged
+            }
+        } else {
+            int bl = p->getLeft()->getBalance();
+            if (bl > 0) {
+                rotateLeftRight(top);
+            } else {
+                rotateRight(top);
+            }
+            if (bl == 0) {
+                return;
+            }
+        }
+    }
+}
+
+/**
+* Returns the child pointer (or root_) that refers to path[i].
+*/
+template<class Key, class Value>
+typename StackAVLTree<Key, Value>::SNode*&
+StackAVLTree<Key, Value>::link(SNode** path, const bool* wentRight, int i)
+{
+    if (i == 0) {
+        return root_;
+    }
+    return wentRight[i - 1] ? path[i - 1]->right_ : path[i - 1]->left_;
+}
+
+/**
+* Rotates the right child of link up into link. Balances are set for both
+* the insert case and the remove-only case where that child was balanced.
+*/
+template<class Key, class Value>
+void StackAVLTree<Key, Value>::rotateLeft(SNode*& link)
+{
+    SNode* x = link;
+    SNode* z = x->right_;
+    x->right_ = z->left_;
+    z->left_ = x;
+    link = z;
+    if (z->getBalance() == 0) {
+        x->setBalance(1);
+        z->setBalance(-1);
+    } else {
+        x->setBalance(0);
+        z->setBalance(0);
+    }
+}
+
+/**
+* Mirror image of rotateLeft.
+*/
+template<class Key, class Value>
+void StackAVLTree<Key, Value>::rotateRight(SNode*& link)
+{
+    SNode* x = link;
+    SNode* z = x->left_;
+    x->left_ = z->right_;
+    z->right_ = x;
+    link = z;
+    if (z->getBalance() == 0) {
+        x->setBalance(-1);
+        z->setBalance(1);
+    } else {
+        x->setBalance(0);
+        z->setBalance(0);
+    }
+}
+
+/**
+* Double rotation for a right-heavy node whose right child leans left.
+*/
+template<class Key, class Value>
+void StackAVLTree<Key, Value>::rotateRightLeft(SNode*& link)
+{
+    SNode* x = link;
+    SNode* z = x->right_;
+    SNode* y = z->left_;
+    int by = y->getBalance();
+    z->left_ = y->right_;
+    x->right_ = y->left_;
+    y->left_ = x;
+    y->right_ = z;
+    link = y;
+    x->setBalance(by > 0 ? -1 : 0);
+    z->setBalance(by < 0 ? 1 : 0);
+    y->setBalance(0);
+}
+
+/**
+* Mirror image of rotateRightLeft.
+*/
+template<class Key, class Value>
+void StackAVLTree<Key, Value>::rotateLeftRight(SNode*& link)
+{
+    SNode* x = link;
+    SNode* z = x->left_;
+    SNode* y = z->right_;
+    int by = y->getBalance();
+    z->right_ = y->left_;
+    x->left_ = y->right_;
+    y->right_ = x;
+    y->left_ = z;
+    link = y;
+    x->setBalance(by < 0 ? 1 : 0);
+    z->setBalance(by > 0 ? -1 : 0);
+    y->setBalance(0);
+}
+
+/**
+ * Return true iff the tree is height balanced.
+ */
+template<class Key, class Value>
+bool StackAVLTree<Key, Value>::isBalanced() const
+{
+    return isBalancedHelper(root_);
+}
+
+template<class Key, class Value>
+bool StackAVLTree<Key, Value>::isBalancedHelper(SNode* node) const
+{
+    if (node == nullptr) {
+        return true;
+    }
+    int diff = height(node->getLeft()) - height(node->getRight());
+    if (diff > 1 || diff < -1) {
+        return false;
+    }
+    return isBalancedHelper(node->getLeft()) && isBalancedHelper(node->getRight());
+}
+
+template<class Key, class Value>
+int StackAVLTree<Key, Value>::height(SNode* node) const
+{
+    if (node == nullptr) {
+        return 0;
+    }
+    return 1 + std::max(height(node->getLeft()), height(node->getRight()));
+}
+
+/*
+----------------------------------------------
+End implementations for the StackAVLTree class.
+----------------------------------------------
+*/
+
+#endif
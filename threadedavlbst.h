@@ -0,0 +1,733 @@
+#ifndef THREADEDAVLBST_H
+#define THREADEDAVLBST_H
+
+#include <iostream>
+#include <exception>
+#include <stdexcept>
+#include <cstdlib>
+#include <cstdint>
+#include <algorithm>
+
+/**
+* An AVL tree whose empty child links are threads: a node with no left child
+* points at its in-order predecessor and a node with no right child points at
+* its successor, with a tag on each link saying which kind it is. The two
+* ends of the order hold a NULL thread.
+*
+* Iterators are a single node pointer and never climb: ++ follows the right
+* thread, or, when the node has a right subtree, steps into it and runs down
+* its left spine. No node needs a parent pointer, so insert and remove
+* rebalance along their recorded descent path like StackAVLTree does.
+*/
+
+/**
+* A node for ThreadedAVLTree. getLeft() and getRight() return only real
+* children; the raw links (and their thread tags) are public like Node's.
+*/
+template <typename Key, typename Value>
+class ThreadedAVLNode
+{
+public:
+    ThreadedAVLNode(const Key& key, const Value& value);
+
+    const std::pair<const Key, Value>& getItem() const;
+    std::pair<const Key, Value>& getItem();
+    const Key& getKey() const;
+    const Value& getValue() const;
+    Value& getValue();
+    void setValue(const Value &value);
+
+    ThreadedAVLNode<Key, Value>* getLeft() const;
+    ThreadedAVLNode<Key, Value>* getRight() const;
+    int8_t getBalance() const;
+    void setBalance(int8_t balance);
+
+    std::pair<const Key, Value> item_;
+    ThreadedAVLNode<Key, Value>* left_;
+    ThreadedAVLNode<Key, Value>* right_;
+    int8_t balance_;
+    bool leftThread_;
+    bool rightThread_;
+};
+
+/*
+  ----------------------------------------------
+  Begin implementations for the ThreadedAVLNode class.
+  ----------------------------------------------
+*/
+
+template<typename Key, typename Value>
+ThreadedAVLNode<Key, Value>::ThreadedAVLNode(const Key& key, const Value& value) :
+    item_(key, value),
+    left_(NULL),
+    right_(NULL),
+    balance_(0),
+    leftThread_(true),
+    rightThread_(true)
+{
+
+}
+
+template<typename Key, typename Value>
+const std::pair<const Key, Value>& ThreadedAVLNode<Key, Value>::getItem() const
+{
+    return item_;
+}
+
+template<typename Key, typename Value>
+std::pair<const Key, Value>& ThreadedAVLNode<Key, Value>::getItem()
+{
+    return item_;
+}
+
+template<typename Key, typename Value>
+const Key& ThreadedAVLNode<Key, Value>::getKey() const
+{
+    return item_.first;
+}
+
+template<typename Key, typename Value>
+const Value& ThreadedAVLNode<Key, Value>::getValue() const
+{
+    return item_.second;
+}
+
+template<typename Key, typename Value>
+Value& ThreadedAVLNode<Key, Value>::getValue()
+{
+    return item_.second;
+}
+
+template<typename Key, typename Value>
+void ThreadedAVLNode<Key, Value>::setValue(const Value& value)
+{
+    item_.second = value;
+}
+
+template<typename Key, typename Value>
+ThreadedAVLNode<Key, Value>* ThreadedAVLNode<Key, Value>::getLeft() const
+{
+    return leftThread_ ? NULL : left_;
+}
+
+template<typename Key, typename Value>
+ThreadedAVLNode<Key, Value>* ThreadedAVLNode<Key, Value>::getRight() const
+{
+    return rightThread_ ? NULL : right_;
+}
+
+template<typename Key, typename Value>
+int8_t ThreadedAVLNode<Key, Value>::getBalance() const
+{
+    return balance_;
+}
+
+template<typename Key, typename Value>
+void ThreadedAVLNode<Key, Value>::setBalance(int8_t balance)
+{
+    balance_ = balance;
+}
+
+/*
+  --------------------------------------------
+  End implementations for the ThreadedAVLNode class.
+  --------------------------------------------
+*/
+
+template <typename Key, typename Value>
+class ThreadedAVLTree
+{
+public:
+    static const int kMaxHeight = 64; // See StackAVLTree
+
+    ThreadedAVLTree();
+    ~ThreadedAVLTree();
+
+    void insert(const std::pair<const Key, Value>& keyValuePair);
+    void remove(const Key& key);
+    void clear();
+    bool isBalanced() const;
+    void print() const;
+    bool empty() const;
+
+    class iterator
+    {
+    public:
+        iterator();
+
+        std::pair<const Key,Value>& operator*() const;
+        std::pair<const Key,Value>* operator->() const;
+
+        bool operator==(const iterator& rhs) const;
+        bool operator!=(const iterator& rhs) const;
+
+        iterator& operator++();
+
+    protected:
+        friend class ThreadedAVLTree<Key, Value>;
+        iterator(ThreadedAVLNode<Key, Value>* ptr);
+        ThreadedAVLNode<Key, Value>* current_;
+    };
+
+    iterator begin() const;
+    iterator end() const;
+    iterator find(const Key& key) const;
+    Value& operator[](const Key& key);
+    Value const & operator[](const Key& key) const;
+
+protected:
+    typedef ThreadedAVLNode<Key, Value> TNode;
+
+    TNode* internalFind(const Key& key) const;
+    TNode*& link(TNode** path, const bool* wentRight, int i); // The pointer that holds path[i]
+    void unlink(TNode** path, const bool* wentRight, int i);
+    static TNode* leftmost(TNode* node);
+    static TNode* rightmost(TNode* node);
+    static void rotateLeft(TNode*& link);
+    static void rotateRight(TNode*& link);
+    static void rotateRightLeft(TNode*& link);
+    static void rotateLeftRight(TNode*& link);
+    static void rotateLeftLinks(TNode*& link);
+    static void rotateRightLinks(TNode*& link);
+    void clearHelper(TNode* node);
+    int height(TNode* node) const;
+    bool isBalancedHelper(TNode* node) const;
+
+    ThreadedAVLTree(const ThreadedAVLTree&);            // not copyable
+    ThreadedAVLTree& operator=(const ThreadedAVLTree&);
+
+    TNode* root_;
+};
+
+/*
+---------------------------------------------------------
+Begin implementations for the ThreadedAVLTree::iterator class.
+---------------------------------------------------------
+*/
+
+template<class Key, class Value>
+ThreadedAVLTree<Key, Value>::iterator::iterator(ThreadedAVLNode<Key, Value>* ptr) : current_(ptr)
+{
+}
+
+template<class Key, class Value>
+ThreadedAVLTree<Key, Value>::iterator::iterator() : current_(NULL)
+{
+}
+
+template<class Key, class Value>
+std::pair<const Key,Value> &
+ThreadedAVLTree<Key, Value>::iterator::operator*() const
+{
+    return current_->getItem();
+}
+
+template<class Key, class Value>
+std::pair<const Key,Value> *
+ThreadedAVLTree<Key, Value>::iterator::operator->() const
+{
+    return &(current_->getItem());
+}
+
+template<class Key, class Value>
+bool ThreadedAVLTree<Key, Value>::iterator::operator==(const iterator& rhs) const
+{
+    return current_ == rhs.current_;
+}
+
+template<class Key, class Value>
+bool ThreadedAVLTree<Key, Value>::iterator::operator!=(const iterator& rhs) const
+{
+    return current_ != rhs.current_;
+}
+
+/**
+* A right thread is the successor itself; otherwise the successor is the
+* leftmost node of the right subtree.
+*/
+template<class Key, class Value>
+typename ThreadedAVLTree<Key, Value>::iterator&
+ThreadedAVLTree<Key, Value>::iterator::operator++()
+{
+    if (current_->rightThread_) {
+        current_ = current_->right_;
+    } else {
+        current_ = leftmost(current_->right_);
+    }
+    return *this;
+}
+
+/*
+-------------------------------------------------------
+End implementations for the ThreadedAVLTree::iterator class.
+-------------------------------------------------------
+*/
+
+/*
+------------------------------------------------
+Begin implementations for the ThreadedAVLTree class.
+------------------------------------------------
+*/
+
+template<class Key, class Value>
+ThreadedAVLTree<Key, Value>::ThreadedAVLTree() : root_(nullptr)
+{
+}
+
+template<class Key, class Value>
+ThreadedAVLTree<Key, Value>::~ThreadedAVLTree()
+{
+    clear();
+}
+
+template<class Key, class Value>
+void ThreadedAVLTree<Key, Value>::clear()
+{
+    clearHelper(root_);
+    root_ = nullptr;
+}
+
+template<class Key, class Value>
+void ThreadedAVLTree<Key, Value>::clearHelper(TNode* node)
+{
+    if (node == nullptr) {
+        return;
+    }
+    clearHelper(node->getLeft());
+    clearHelper(node->getRight());
+    delete node;
+}
+
+template<class Key, class Value>
+bool ThreadedAVLTree<Key, Value>::empty() const
+{
+    return root_ == nullptr;
+}
+
+/**
+* Prints the contents in key order, one entry per line.
+*/
+template<class Key, class Value>
+void ThreadedAVLTree<Key, Value>::print() const
+{
+    for (iterator it = begin(); it != end(); ++it) {
+        std::cout << it->first << " " << it->second << std::endl;
+    }
+}
+
+template<class Key, class Value>
+typename ThreadedAVLTree<Key, Value>::iterator
+ThreadedAVLTree<Key, Value>::begin() const
+{
+    return iterator(root_ == nullptr ? nullptr : leftmost(root_));
+}
+
+template<class Key, class Value>
+typename ThreadedAVLTree<Key, Value>::iterator
+ThreadedAVLTree<Key, Value>::end() const
+{
+    return iterator(nullptr);
+}
+
+template<class Key, class Value>
+typename ThreadedAVLTree<Key, Value>::iterator
+ThreadedAVLTree<Key, Value>::find(const Key& key) const
+{
+    return iterator(internalFind(key));
+}
+
+/**
+ * @precondition The key exists in the map
+ * Returns the value associated with the key
+ */
+template<class Key, class Value>
+Value& ThreadedAVLTree<Key, Value>::operator[](const Key& key)
+{
+    TNode* curr = internalFind(key);
+    if(curr == NULL) throw std::out_of_range("Invalid key");
+    return curr->getValue();
+}
+template<class Key, class Value>
+Value const & ThreadedAVLTree<Key, Value>::operator[](const Key& key) const
+{
+    TNode* curr = internalFind(key);
+    if(curr == NULL) throw std::out_of_range("Invalid key");
+    return curr->getValue();
+}
+
+template<class Key, class Value>
+typename ThreadedAVLTree<Key, Value>::TNode* ThreadedAVLTree<Key, Value>::internalFind(const Key& key) const
+{
+    TNode* current = root_;
+    while (current != nullptr) {
+        if (key == current->getKey()) {
+            return current;
+        }
+        current = (key < current->getKey()) ? current->getLeft() : current->getRight();
+    }
+    return nullptr;
+}
+
+template<class Key, class Value>
+typename ThreadedAVLTree<Key, Value>::TNode* ThreadedAVLTree<Key, Value>::leftmost(TNode* node)
+{
+    while (!node->leftThread_) {
+        node = node->left_;
+    }
+    return node;
+}
+
+template<class Key, class Value>
+typename ThreadedAVLTree<Key, Value>::TNode* ThreadedAVLTree<Key, Value>::rightmost(TNode* node)
+{
+    while (!node->rightThread_) {
+        node = node->right_;
+    }
+    return node;
+}
+
+/*
+ * Recall: If key is already in the tree, you should
+ * overwrite the current value with the updated value.
+ */
+template<class Key, class Value>
+void ThreadedAVLTree<Key, Value>::insert(const std::pair<const Key, Value>& keyValuePair)
+{
+    TNode* path[kMaxHeight + 1];
+    bool wentRight[kMaxHeight + 1];
+    int d = 0;
+    TNode* current = root_;
+    while (current != nullptr) {
+        if (keyValuePair.first == current->getKey()) { // if its equal overwrite the value
+            current->setValue(keyValuePair.second);
+            return;
+        }
+        path[d] = current;
+        wentRight[d] = current->getKey() < keyValuePair.first;
+        current = wentRight[d] ? current->getRight() : current->getLeft();
+        ++d;
+    }
+    TNode* newNode = new TNode(keyValuePair.first, keyValuePair.second);
+    if (d == 0) {
+        root_ = newNode;
+        return;
+    }
+    // The new leaf inherits its parent's thread on one side and threads
+    // back to the parent on the other
+    TNode* p = path[d - 1];
+    if (wentRight[d - 1]) {
+        newNode->right_ = p->right_;
+        newNode->left_ = p;
+        p->right_ = newNode;
+        p->rightThread_ = false;
+    } else {
+        newNode->left_ = p->left_;
+        newNode->right_ = p;
+        p->left_ = newNode;
+        p->leftThread_ = false;
+    }
+
+    // Retrace from the new node's parent while subtrees keep getting taller
+    for (int i = d - 1; i >= 0; --i) {
+        p = path[i];
+        int b = p->getBalance() + (wentRight[i] ? 1 : -1);
+        if (b == 0) {
+            p->setBalance(0);
+            return;
+        }
+        if (b == 1 || b == -1) {
+            p->setBalance(b);
+            continue;
+        }
+        TNode*& top = link(path, wentRight, i);
+        if (b == -2) {
+            if (p->left_->getBalance() > 0) {
+                rotateLeftRight(top);
+            } else {
+                rotateRight(top);
+            }
+        } else {
+            if (p->right_->getBalance() < 0) {
+                rotateRightLeft(top);
+            } else {
+                rotateLeft(top);
+            }
+        }
+        return;
+    }
+}
+
+/*
+ * Recall: The writeup specifies that if a node has 2 children you
+ * should swap with the predecessor and then remove.
+ */
+template<class Key, class Value>
+void ThreadedAVLTree<Key, Value>::remove(const Key& key)
+{
+    TNode* path[kMaxHeight + 1];
+    bool wentRight[kMaxHeight + 1];
+    int d = 0;
+    TNode* z = root_;
+    while (z != nullptr && !(key == z->getKey())) {
+        path[d] = z;
+        wentRight[d] = z->getKey() < key;
+        z = wentRight[d] ? z->getRight() : z->getLeft();
+        ++d;
+    }
+    if (z == nullptr) {
+        return;
+    }
+    path[d] = z;
+    int zi = d;
+    if (!z->leftThread_ && !z->rightThread_) {
+        // Extend the path to the predecessor y, which moves into z's place
+        wentRight[d] = false;
+        TNode* y = z->left_;
+        path[++d] = y;
+        while (!y->rightThread_) {
+            wentRight[d] = true;
+            y = y->right_;
+            path[++d] = y;
+        }
+        leftmost(z->right_)->left_ = y;
+        // y's successor once it sits where z was is y itself, so anything
+        // that inherits y's right thread while unlinking it must point at y
+        y->right_ = y;
+        unlink(path, wentRight, d);
+        y->left_ = z->left_;
+        y->leftThread_ = z->leftThread_;
+        y->right_ = z->right_;
+        y->rightThread_ = false;
+        y->setBalance(z->getBalance());
+        link(path, wentRight, zi) = y;
+        path[zi] = y;
+    } else {
+        unlink(path, wentRight, d);
+    }
+    delete z;
+
+    // path[d] was unlinked; retrace from its parent while heights keep shrinking
+    for (int i = d - 1; i >= 0; --i) {
+        TNode* p = path[i];
+        int b = p->getBalance() + (wentRight[i] ? -1 : 1);
+        if (b == 1 || b == -1) {
+            p->setBalance(b);
+            return;
+        }
+        if (b == 0) {
+            p->setBalance(0);
+            continue;
+        }
+        TNode*& top = link(path, wentRight, i);
+        if (b == 2) {
+            int br = p->right_->getBalance();
+            if (br < 0) {
+                rotateRightLeft(top);
+            } else {
+                rotateLeft(top);
+            }
+            if (br == 0) {
+                return; // height unchanged
+            }
+        } else {
+            int bl = p->left_->getBalance();
+            if (bl > 0) {
+                rotateLeftRight(top);
+            } else {
+                rotateRight(top);
+            }
+            if (bl == 0) {
+                return;
+            }
+        }
+    }
+}
+
+/**
+* Takes path[i], which has at most one child, out of the tree. A lone child
+* takes its place and the threads that pointed at path[i] from inside that
+* child's subtree are redirected; a leaf is replaced by the thread it held
+* on the side it hangs from.
+*/
+template<class Key, class Value>
+void ThreadedAVLTree<Key, Value>::unlink(TNode** path, const bool* wentRight, int i)
+{
+    TNode* z = path[i];
+    if (!z->leftThread_) {
+        rightmost(z->left_)->right_ = z->right_;
+        link(path, wentRight, i) = z->left_;
+    } else if (!z->rightThread_) {
+        leftmost(z->right_)->left_ = z->left_;
+        link(path, wentRight, i) = z->right_;
+    } else if (i == 0) {
+        root_ = nullptr;
+    } else if (wentRight[i - 1]) {
+        path[i - 1]->right_ = z->right_;
+        path[i - 1]->rightThread_ = true;
+    } else {
+        path[i - 1]->left_ = z->left_;
+        path[i - 1]->leftThread_ = true;
+    }
+}
+
+/**
+* Returns the child pointer (or root_) that refers to path[i].
+*/
+template<class Key, class Value>
+typename ThreadedAVLTree<Key, Value>::TNode*&
+ThreadedAVLTree<Key, Value>::link(TNode** path, const bool* wentRight, int i)
+{
+    if (i == 0) {
+        return root_;
+    }
+    return wentRight[i - 1] ? path[i - 1]->right_ : path[i - 1]->left_;
+}
+
+/**
+* Rotates the right child z of link up into link. When z had no left child
+* its left link was a thread back to x, which becomes x's right thread.
+*/
+template<class Key, class Value>
+void ThreadedAVLTree<Key, Value>::rotateLeftLinks(TNode*& link)
+{
+    TNode* x = link;
+    TNode* z = x->right_;
+    if (z->leftThread_) {
+        x->right_ = z;
+        x->rightThread_ = true;
+        z->leftThread_ = false;
+    } else {
+        x->right_ = z->left_;
+    }
+    z->left_ = x;
+    link = z;
+}
+
+/**
+* Mirror image of rotateLeftLinks.
+*/
+template<class Key, class Value>
+void ThreadedAVLTree<Key, Value>::rotateRightLinks(TNode*& link)
+{
+    TNode* x = link;
+    TNode* z = x->left_;
+    if (z->rightThread_) {
+        x->left_ = z;
+        x->leftThread_ = true;
+        z->rightThread_ = false;
+    } else {
+        x->left_ = z->right_;
+    }
+    z->right_ = x;
+    link = z;
+}
+
+/**
+* Single left rotation. Balances are set for both the insert case and the
+* remove-only case where the right child was balanced.
+*/
+template<class Key, class Value>
+void ThreadedAVLTree<Key, Value>::rotateLeft(TNode*& link)
+{
+    TNode* x = link;
+    TNode* z = x->right_;
+    rotateLeftLinks(link);
+    if (z->getBalance() == 0) {
+        x->setBalance(1);
+        z->setBalance(-1);
+    } else {
+        x->setBalance(0);
+        z->setBalance(0);
+    }
+}
+
+/**
+* Mirror image of rotateLeft.
+*/
+template<class Key, class Value>
+void ThreadedAVLTree<Key, Value>::rotateRight(TNode*& link)
+{
+    TNode* x = link;
+    TNode* z = x->left_;
+    rotateRightLinks(link);
+    if (z->getBalance() == 0) {
+        x->setBalance(-1);
+        z->setBalance(1);
+    } else {
+        x->setBalance(0);
+        z->setBalance(0);
+    }
+}
+
+/**
+* Double rotation for a right-heavy node whose right child leans left.
+*/
+template<class Key, class Value>
+void ThreadedAVLTree<Key, Value>::rotateRightLeft(TNode*& link)
+{
+    TNode* x = link;
+    TNode* z = x->right_;
+    TNode* y = z->left_;
+    int by = y->getBalance();
+    rotateRightLinks(x->right_);
+    rotateLeftLinks(link);
+    x->setBalance(by > 0 ? -1 : 0);
+    z->setBalance(by < 0 ? 1 : 0);
+    y->setBalance(0);
+}
+
+/**
+* Mirror image of rotateRightLeft.
+*/
+template<class Key, class Value>
+void ThreadedAVLTree<Key, Value>::rotateLeftRight(TNode*& link)
+{
+    TNode* x = link;
+    TNode* z = x->left_;
+    TNode* y = z->right_;
+    int by = y->getBalance();
+    rotateLeftLinks(x->left_);
+    rotateRightLinks(link);
+    x->setBalance(by < 0 ? 1 : 0);
+    z->setBalance(by > 0 ? -1 : 0);
+    y->setBalance(0);
+}
+
+/**
+ * Return true iff the tree is height balanced.
+ */
+template<class Key, class Value>
+bool ThreadedAVLTree<Key, Value>::isBalanced() const
+{
+    return isBalancedHelper(root_);
+}
+
+template<class Key, class Value>
+bool ThreadedAVLTree<Key, Value>::isBalancedHelper(TNode* node) const
+{
+    if (node == nullptr) {
+        return true;
+    }
+    int diff = height(node->getLeft()) - height(node->getRight());
+    if (diff > 1 || diff < -1) {
+        return false;
+    }
+    return isBalancedHelper(node->getLeft()) && isBalancedHelper(node->getRight());
+}
+
+template<class Key, class Value>
+int ThreadedAVLTree<Key, Value>::height(TNode* node) const
+{
+    if (node == nullptr) {
+        return 0;
+    }
+    return 1 + std::max(height(node->getLeft()), height(node->getRight()));
+}
+
+/*
+----------------------------------------------
+End implementations for the ThreadedAVLTree class.
+----------------------------------------------
+*/
+
+#endif
@@ -0,0 +1,104 @@
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <thread>
+#include "avlbst.h"
+#include "treapbst.h"
+#include "bench-util.h"
+
+using namespace std;
+
+// Usage: treap-bench [num_keys] [batch_size] [threads]
+
+int main(int argc, char *argv[])
+{
+    int n = (int) benchArg(argc, argv, 1, 1000000);
+    int batch = (int) benchArg(argc, argv, 2, 100000);
+    unsigned threads = (unsigned) benchArg(argc, argv, 3, std::thread::hardware_concurrency());
+
+    // Unsorted initial load plus batches of fresh inserts and deletes
+    vector<int> keys = makeShuffledKeys(2 * n, 1);
+    vector<pair<int, int> > initial;
+    for (int i = 0; i < n; ++i) {
+        initial.push_back(std::make_pair(keys[i], i));
+    }
+    vector<vector<pair<int, int> > > insertBatches;
+    vector<vector<int> > removeBatches;
+    for (int start = 0; start + batch <= n; start += batch) {
+        vector<pair<int, int> > ins;
+        vector<int> rem;
+        for (int i = start; i < start + batch; ++i) {
+            ins.push_back(std::make_pair(keys[n + i], i));
+            rem.push_back(keys[i]);
+        }
+        insertBatches.push_back(ins);
+        removeBatches.push_back(rem);
+    }
+
+    cout << n << " keys, " << insertBatches.size() << " batches of " << batch
+         << ", " << threads << " thread(s)" << endl;
+    cout << fixed << setprecision(1);
+    cout << "phase           AVLTree(ms)  Treap(ms)" << endl;
+
+    AVLTree<int, int> avl;
+    Treap<int, int> treap;
+
+    BenchTimer timer;
+    for (size_t i = 0; i < initial.size(); ++i) {
+        avl.insert(initial[i]);
+    }
+    double a = timer.elapsedMs();
+    timer.reset();
+    treap.build_parallel(initial.begin(), initial.end(), threads);
+    double t = timer.elapsedMs();
+    cout << "build           " << setw(11) << a << "  " << setw(9) << t << endl;
+
+    timer.reset();
+    for (size_t b = 0; b < insertBatches.size(); ++b) {
+        for (size_t i = 0; i < insertBatches[b].size(); ++i) {
+            avl.insert(insertBatches[b][i]);
+        }
+    }
+    a = timer.elapsedMs();
+    timer.reset();
+    for (size_t b = 0; b < insertBatches.size(); ++b) {
+        treap.insert_bulk(insertBatches[b].begin(), insertBatches[b].end(), threads);
+    }
+    t = timer.elapsedMs();
+    cout << "batch insert    " << setw(11) << a << "  " << setw(9) << t << endl;
+
+    timer.reset();
+    for (size_t b = 0; b < removeBatches.size(); ++b) {
+        for (size_t i = 0; i < removeBatches[b].size(); ++i) {
+            avl.remove(removeBatches[b][i]);
+        }
+    }
+    a = timer.elapsedMs();
+    timer.reset();
+    for (size_t b = 0; b < removeBatches.size(); ++b) {
+        treap.remove_bulk(removeBatches[b].begin(), removeBatches[b].end(), threads);
+    }
+    t = timer.elapsedMs();
+    cout << "batch remove    " << setw(11) << a << "  " << setw(9) << t << endl;
+
+    // Range delete of the lower quarter of the key space
+    timer.reset();
+    for (int k = 0; k < n / 2; ++k) {
+        avl.remove(k);
+    }
+    a = timer.elapsedMs();
+    timer.reset();
+    treap.remove_range(0, n / 2, threads);
+    t = timer.elapsedMs();
+    cout << "range remove    " << setw(11) << a << "  " << setw(9) << t << endl;
+
+    long count = 0;
+    for (AVLTree<int, int>::iterator it = avl.begin(); it != avl.end(); ++it) {
+        ++count;
+    }
+    for (Treap<int, int>::iterator it = treap.begin(); it != treap.end(); ++it) {
+        --count;
+    }
+    cout << "(size difference " << count << ")" << endl;
+    return 0;
+}
@@ -0,0 +1,707 @@
+#ifndef TREAPBST_H
+#define TREAPBST_H
+
+#include <iostream>
+#include <exception>
+#include <cstdlib>
+#include <cstdint>
+#include <vector>
+#include <random>
+#include <thread>
+#include <algorithm>
+#include "bst.h"
+
+/**
+* A node for a treap. Besides the key it carries a random priority and the
+* tree is kept in max-heap order on priorities, which makes the shape that of
+* a random BST no matter what order the keys arrive in.
+*/
+template <typename Key, typename Value>
+class TreapNode : public Node<Key, Value>
+{
+public:
+    // Constructor/destructor.
+    TreapNode(const Key& key, const Value& value, TreapNode<Key, Value>* parent, uint32_t priority);
+    virtual ~TreapNode();
+
+    // Getter for the node's heap priority.
+    uint32_t getPriority() const;
+
+    // Getters for parent, left, and right. These need to be redefined since they
+    // return pointers to TreapNodes - not plain Nodes. See the Node class in bst.h
+    // for more information.
+    virtual TreapNode<Key, Value>* getParent() const override;
+    virtual TreapNode<Key, Value>* getLeft() const override;
+    virtual TreapNode<Key, Value>* getRight() const override;
+
+protected:
+    uint32_t priority_;
+};
+
+/*
+  -------------------------------------------------
+  Begin implementations for the TreapNode class.
+  -------------------------------------------------
+*/
+
+/**
+* An explicit constructor to initialize the elements by calling the base class constructor and setting
+* the priority that was drawn for this node.
+*/
+template<class Key, class Value>
+TreapNode<Key, Value>::TreapNode(const Key& key, const Value& value, TreapNode<Key, Value> *parent, uint32_t priority) :
+    Node<Key, Value>(key, value, parent), priority_(priority)
+{
+
+}
+
+/**
+* A destructor which does nothing.
+*/
+template<class Key, class Value>
+TreapNode<Key, Value>::~TreapNode()
+{
+
+}
+
+/**
+* A getter for the priority of a TreapNode.
+*/
+template<class Key, class Value>
+uint32_t TreapNode<Key, Value>::getPriority() const
+{
+    return priority_;
+}
+
+/**
+* Overridden for the same reasons as in AVLNode.
+*/
+template<class Key, class Value>
+TreapNode<Key, Value> *TreapNode<Key, Value>::getParent() const
+{
+    return static_cast<TreapNode<Key, Value>*>(this->parent_);
+}
+
+/**
+* Overridden for the same reasons as in AVLNode.
+*/
+template<class Key, class Value>
+TreapNode<Key, Value> *TreapNode<Key, Value>::getLeft() const
+{
+    return static_cast<TreapNode<Key, Value>*>(this->left_);
+}
+
+/**
+* Overridden for the same reasons as in AVLNode.
+*/
+template<class Key, class Value>
+TreapNode<Key, Value> *TreapNode<Key, Value>::getRight() const
+{
+    return static_cast<TreapNode<Key, Value>*>(this->right_);
+}
+
+/*
+  -----------------------------------------------
+  End implementations for the TreapNode class.
+  -----------------------------------------------
+*/
+
+/**
+* A randomized balanced search tree. All updates are expressed with split
+* (cut a tree into keys < k and keys >= k) and merge (join two trees whose key
+* ranges do not overlap), each expected O(log n).
+*
+* Because disjoint key ranges live in disjoint trees after a split, the bulk
+* operations cut the tree into one piece per thread, let every thread work on
+* its own piece and merge the pieces back together at the end.
+*/
+template <class Key, class Value>
+class Treap : public BinarySearchTree<Key, Value>
+{
+public:
+    Treap();
+
+    virtual void insert(const std::pair<const Key, Value>& new_item);
+    virtual void remove(const Key& key);
+    using BinarySearchTree<Key, Value>::insert;
+    void merge(Treap& other); // See BinarySearchTree::merge
+    using BinarySearchTree<Key, Value>::erase;
+    typename BinarySearchTree<Key, Value>::iterator erase(typename BinarySearchTree<Key, Value>::iterator first,
+                                                          typename BinarySearchTree<Key, Value>::iterator last);
+
+    // Bulk operations. threads == 0 means std::thread::hardware_concurrency().
+    // Input ranges do not need to be sorted; for repeated keys the last one wins.
+    template<typename InputIt>
+    void insert_bulk(InputIt first, InputIt last, unsigned threads = 0);
+    template<typename InputIt>
+    void remove_bulk(InputIt first, InputIt last, unsigned threads = 0);
+    void remove_range(const Key& lo, const Key& hi, unsigned threads = 0); // removes keys in [lo, hi)
+    template<typename InputIt>
+    void build_parallel(InputIt first, InputIt last, unsigned threads = 0); // replaces the contents
+
+protected:
+    typedef TreapNode<Key, Value> TNode;
+    typedef std::pair<Key, Value> Item;
+
+    static void split(TNode* t, const Key& key, TNode*& l, TNode*& r); // l gets keys < key
+    static TNode* merge(TNode* l, TNode* r); // every key of l must be smaller than every key of r
+    static void insertInto(TNode*& root, const Key& key, const Value& value, std::mt19937& rng);
+    static void removeFrom(TNode*& root, const Key& key);
+    TNode* cutRange(const Key& lo, const Key* hi); // Detaches [lo, hi), or [lo, ...) if hi is NULL
+    static void linkInto(TNode*& root, TNode* n); // n's key must not be in the tree yet
+    static void unlinkFrom(TNode*& root, TNode* n);
+    virtual Node<Key, Value>* linkNode(Node<Key, Value>* n);
+    virtual void unlinkNode(Node<Key, Value>* n);
+    static TNode* buildSorted(const Item* first, const Item* last, std::mt19937& rng); // O(n) Cartesian build
+    static void pushSpine(std::vector<TNode*>& spine, TNode* n); // Appends the next in-order node to a Cartesian build
+    virtual Node<Key, Value>* cloneNode(const Node<Key, Value>* src, Node<Key, Value>* parent) const;
+    virtual void afterRebuild();
+    using BinarySearchTree<Key, Value>::workerCount;
+    using BinarySearchTree<Key, Value>::sortAndDedupe;
+    void splitPieces(const std::vector<Key>& pivots, std::vector<TNode*>& pieces);
+    void mergePieces(std::vector<TNode*>& pieces);
+    void destroyParallel(TNode* t, unsigned threads);
+    TNode* root() const;
+
+    std::mt19937 rng_;
+};
+
+/*
+--------------------------------------------
+Begin implementations for the Treap class.
+--------------------------------------------
+*/
+
+/**
+* Default constructor; priorities come from a per-tree generator.
+*/
+template<class Key, class Value>
+Treap<Key, Value>::Treap() : BinarySearchTree<Key, Value>(), rng_(std::random_device()())
+{
+}
+
+/*
+ * Recall: If key is already in the tree, you should
+ * overwrite the current value with the updated value.
+ */
+template<class Key, class Value>
+void Treap<Key, Value>::insert(const std::pair<const Key, Value>& new_item)
+{
+    TNode* r = root();
+    insertInto(r, new_item.first, new_item.second, rng_);
+    this->root_ = r;
+}
+
+template<class Key, class Value>
+void Treap<Key, Value>::remove(const Key& key)
+{
+    this->evictCached(key);
+    TNode* r = root();
+    removeFrom(r, key);
+    this->root_ = r;
+}
+
+/**
+* Merged nodes keep their priorities, which only TreapNodes have, so the
+* other tree must be a Treap too.
+*/
+template<class Key, class Value>
+void Treap<Key, Value>::merge(Treap<Key, Value>& other)
+{
+    this->mergeFrom(other);
+}
+
+/**
+* Inserts every pair in [first, last). The pairs are sorted in parallel, the
+* tree is split at the quantiles of the batch and each thread inserts its
+* share into its own piece.
+*/
+template<class Key, class Value>
+template<typename InputIt>
+void Treap<Key, Value>::insert_bulk(InputIt first, InputIt last, unsigned threads)
+{
+    std::vector<Item> items(first, last);
+    unsigned t = workerCount(threads, items.size());
+    sortAndDedupe(items, t);
+    if (items.empty()) {
+        return;
+    }
+    t = workerCount(t, items.size());
+
+    // Piece i receives items [bounds[i], bounds[i+1])
+    std::vector<size_t> bounds(t + 1);
+    std::vector<Key> pivots;
+    for (unsigned i = 0; i <= t; ++i) {
+        bounds[i] = items.size() * i / t;
+        if (i > 0 && i < t) {
+            pivots.push_back(items[bounds[i]].first);
+        }
+    }
+    std::vector<TNode*> pieces;
+    splitPieces(pivots, pieces);
+
+    std::vector<uint32_t> seeds(t);
+    for (unsigned i = 0; i < t; ++i) {
+        seeds[i] = rng_();
+    }
+    std::vector<std::thread> workers;
+    for (unsigned i = 0; i < t; ++i) {
+        workers.push_back(std::thread([&, i]() {
+            std::mt19937 rng(seeds[i]);
+            for (size_t j = bounds[i]; j < bounds[i + 1]; ++j) {
+                insertInto(pieces[i], items[j].first, items[j].second, rng);
+            }
+        }));
+    }
+    for (size_t i = 0; i < workers.size(); ++i) {
+        workers[i].join();
+    }
+    mergePieces(pieces);
+}
+
+/**
+* Removes every key in [first, last), one piece of the tree per thread.
+*/
+template<class Key, class Value>
+template<typename InputIt>
+void Treap<Key, Value>::remove_bulk(InputIt first, InputIt last, unsigned threads)
+{
+    std::vector<Key> keys(first, last);
+    if (keys.empty() || this->root_ == nullptr) {
+        return;
+    }
+    std::sort(keys.begin(), keys.end());
+    keys.erase(std::unique(keys.begin(), keys.end()), keys.end());
+    unsigned t = workerCount(threads, keys.size());
+
+    std::vector<size_t> bounds(t + 1);
+    std::vector<Key> pivots;
+    for (unsigned i = 0; i <= t; ++i) {
+        bounds[i] = keys.size() * i / t;
+        if (i > 0 && i < t) {
+            pivots.push_back(keys[bounds[i]]);
+        }
+    }
+    std::vector<TNode*> pieces;
+    splitPieces(pivots, pieces);
+
+    std::vector<std::thread> workers;
+    for (unsigned i = 0; i < t; ++i) {
+        workers.push_back(std::thread([&, i]() {
+            for (size_t j = bounds[i]; j < bounds[i + 1]; ++j) {
+                removeFrom(pieces[i], keys[j]);
+            }
+        }));
+    }
+    for (size_t i = 0; i < workers.size(); ++i) {
+        workers[i].join();
+    }
+    mergePieces(pieces);
+    if (this->cache_) {
+        this->cache_->reset(); // cheaper than evicting key by key
+    }
+}
+
+/**
+* Cuts the keys in [lo, hi) out with two splits, joins what is left with one
+* merge and frees the cut-out subtree in parallel.
+*/
+template<class Key, class Value>
+void Treap<Key, Value>::remove_range(const Key& lo, const Key& hi, unsigned threads)
+{
+    if (!(lo < hi)) {
+        return;
+    }
+    destroyParallel(cutRange(lo, &hi), threads);
+}
+
+/**
+* The same two splits and a merge as remove_range, so only the nodes in the
+* range are visited. last is not in the cut-out part and stays valid.
+*/
+template<class Key, class Value>
+typename BinarySearchTree<Key, Value>::iterator Treap<Key, Value>::erase(typename BinarySearchTree<Key, Value>::iterator first,
+                                                                         typename BinarySearchTree<Key, Value>::iterator last)
+{
+    if (first == last) {
+        return last;
+    }
+    const Key* hi = (last == this->end()) ? nullptr : &last->first;
+    this->clearHelper(cutRange(first->first, hi));
+    return last;
+}
+
+template<class Key, class Value>
+typename Treap<Key, Value>::TNode* Treap<Key, Value>::cutRange(const Key& lo, const Key* hi)
+{
+    TNode* left;
+    TNode* middle;
+    TNode* right = nullptr;
+    split(root(), lo, left, middle);
+    if (hi != nullptr) {
+        split(middle, *hi, middle, right);
+    }
+    TNode* joined = merge(left, right);
+    if (joined != nullptr) {
+        joined->setParent(nullptr);
+    }
+    this->root_ = joined;
+    if (this->cache_) {
+        this->cache_->reset();
+    }
+    return middle;
+}
+
+/**
+* Replaces the contents with the pairs in [first, last). The input is sorted
+* in parallel, each thread builds a treap over its slice in linear time and
+* the slices are merged in key order.
+*/
+template<class Key, class Value>
+template<typename InputIt>
+void Treap<Key, Value>::build_parallel(InputIt first, InputIt last, unsigned threads)
+{
+    this->clear();
+    std::vector<Item> items(first, last);
+    unsigned t = workerCount(threads, items.size());
+    sortAndDedupe(items, t);
+    if (items.empty()) {
+        return;
+    }
+    t = workerCount(t, items.size());
+
+    std::vector<TNode*> pieces(t, nullptr);
+    std::vector<uint32_t> seeds(t);
+    for (unsigned i = 0; i < t; ++i) {
+        seeds[i] = rng_();
+    }
+    std::vector<std::thread> workers;
+    for (unsigned i = 0; i < t; ++i) {
+        workers.push_back(std::thread([&, i]() {
+            std::mt19937 rng(seeds[i]);
+            const Item* data = &items[0];
+            pieces[i] = buildSorted(data + items.size() * i / t, data + items.size() * (i + 1) / t, rng);
+        }));
+    }
+    for (size_t i = 0; i < workers.size(); ++i) {
+        workers[i].join();
+    }
+    mergePieces(pieces);
+}
+
+/**
+* Splits t into the keys smaller than key (l) and the rest (r). Parent
+* pointers inside both results are kept valid; the parents of l and r
+* themselves are left for the caller to set.
+*/
+template<class Key, class Value>
+void Treap<Key, Value>::split(TNode* t, const Key& key, TNode*& l, TNode*& r)
+{
+    if (t == nullptr) {
+        l = r = nullptr;
+        return;
+    }
+    if (t->getKey() < key) {
+        TNode* rest;
+        split(t->getRight(), key, rest, r);
+        t->setRight(rest);
+        if (rest != nullptr) {
+            rest->setParent(t);
+        }
+        l = t;
+    } else {
+        TNode* rest;
+        split(t->getLeft(), key, l, rest);
+        t->setLeft(rest);
+        if (rest != nullptr) {
+            rest->setParent(t);
+        }
+        r = t;
+    }
+}
+
+/**
+* Joins l and r, keeping the higher priority of the two roots on top.
+*/
+template<class Key, class Value>
+typename Treap<Key, Value>::TNode* Treap<Key, Value>::merge(TNode* l, TNode* r)
+{
+    if (l == nullptr) {
+        return r;
+    }
+    if (r == nullptr) {
+        return l;
+    }
+    if (l->getPriority() > r->getPriority()) {
+        TNode* m = merge(l->getRight(), r);
+        l->setRight(m);
+        m->setParent(l);
+        return l;
+    } else {
+        TNode* m = merge(l, r->getLeft());
+        r->setLeft(m);
+        m->setParent(r);
+        return r;
+    }
+}
+
+/**
+* Overwrites the value if key exists, otherwise splits root around key and
+* merges a new single node tree in between the halves.
+*/
+template<class Key, class Value>
+void Treap<Key, Value>::insertInto(TNode*& root, const Key& key, const Value& value, std::mt19937& rng)
+{
+    TNode* current = root;
+    while (current != nullptr) {
+        if (key < current->getKey()) {
+            current = current->getLeft();
+        } else if (current->getKey() < key) {
+            current = current->getRight();
+        } else { // if its equal overwrite the value
+            current->setValue(value);
+            return;
+        }
+    }
+    linkInto(root, new TNode(key, value, nullptr, static_cast<uint32_t>(rng())));
+}
+
+template<class Key, class Value>
+void Treap<Key, Value>::linkInto(TNode*& root, TNode* n)
+{
+    TNode* l;
+    TNode* r;
+    split(root, n->getKey(), l, r);
+    root = merge(merge(l, n), r);
+    root->setParent(nullptr);
+}
+
+/**
+* Replaces the node holding key with the merge of its two subtrees.
+*/
+template<class Key, class Value>
+void Treap<Key, Value>::removeFrom(TNode*& root, const Key& key)
+{
+    TNode* current = root;
+    while (current != nullptr) {
+        if (key < current->getKey()) {
+            current = current->getLeft();
+        } else if (current->getKey() < key) {
+            current = current->getRight();
+        } else {
+            break;
+        }
+    }
+    if (current == nullptr) {
+        return;
+    }
+    unlinkFrom(root, current);
+    delete current;
+}
+
+/**
+* Replaces n by the merge of its two subtrees.
+*/
+template<class Key, class Value>
+void Treap<Key, Value>::unlinkFrom(TNode*& root, TNode* n)
+{
+    TNode* parent = n->getParent();
+    TNode* joined = merge(n->getLeft(), n->getRight());
+    if (joined != nullptr) {
+        joined->setParent(parent);
+    }
+    if (parent == nullptr) {
+        root = joined;
+    } else if (parent->getLeft() == n) {
+        parent->setLeft(joined);
+    } else {
+        parent->setRight(joined);
+    }
+}
+
+/**
+* The node keeps the priority it was given when first inserted.
+*/
+template<class Key, class Value>
+Node<Key, Value>* Treap<Key, Value>::linkNode(Node<Key, Value>* n)
+{
+    Node<Key, Value>* existing = this->internalFind(n->getKey());
+    if (existing == nullptr) {
+        TNode* r = root();
+        linkInto(r, static_cast<TNode*>(n));
+        this->root_ = r;
+    }
+    return existing;
+}
+
+template<class Key, class Value>
+void Treap<Key, Value>::unlinkNode(Node<Key, Value>* n)
+{
+    TNode* r = root();
+    unlinkFrom(r, static_cast<TNode*>(n));
+    this->root_ = r;
+}
+
+/**
+* Builds a treap over sorted, duplicate free items in linear time by keeping
+* the right spine of the tree built so far on a stack.
+*/
+template<class Key, class Value>
+typename Treap<Key, Value>::TNode*
+Treap<Key, Value>::buildSorted(const Item* first, const Item* last, std::mt19937& rng)
+{
+    std::vector<TNode*> spine;
+    for (const Item* it = first; it != last; ++it) {
+        pushSpine(spine, new TNode(it->first, it->second, nullptr, static_cast<uint32_t>(rng())));
+    }
+    return spine.empty() ? nullptr : spine.front();
+}
+
+/**
+* spine holds the right spine of the treap built so far. n has the largest
+* key yet, so it goes at the bottom of the spine after every spine node of
+* lower priority has been popped into its left subtree.
+*/
+template<class Key, class Value>
+void Treap<Key, Value>::pushSpine(std::vector<TNode*>& spine, TNode* n)
+{
+    TNode* lastPopped = nullptr;
+    while (!spine.empty() && spine.back()->getPriority() < n->getPriority()) {
+        lastPopped = spine.back();
+        spine.pop_back();
+    }
+    n->setLeft(lastPopped);
+    if (lastPopped != nullptr) {
+        lastPopped->setParent(n);
+    }
+    if (!spine.empty()) {
+        spine.back()->setRight(n);
+        n->setParent(spine.back());
+    }
+    spine.push_back(n);
+}
+
+/**
+* A treap's shape follows from its keys and priorities, so the balanced
+* shape the base class rebuilt breaks the heap order. The nodes are relinked
+* into the treap their priorities define, in O(n) from the in-order list;
+* rebalance() therefore leaves a treap as it was.
+*/
+template<class Key, class Value>
+void Treap<Key, Value>::afterRebuild()
+{
+    size_t count = 0;
+    Node<Key, Value>* node = this->treeToVine(this->root_, count);
+    std::vector<TNode*> spine;
+    spine.reserve(64);
+    while (node != nullptr) {
+        TNode* n = static_cast<TNode*>(node);
+        node = node->getRight();
+        n->setRight(nullptr);
+        n->setParent(nullptr);
+        pushSpine(spine, n);
+    }
+    this->root_ = spine.empty() ? nullptr : spine.front();
+}
+
+template<class Key, class Value>
+Node<Key, Value>* Treap<Key, Value>::cloneNode(const Node<Key, Value>* src, Node<Key, Value>* parent) const
+{
+    return new TNode(src->getKey(), src->getValue(), static_cast<TNode*>(parent),
+                     static_cast<const TNode*>(src)->getPriority());
+}
+
+/**
+* Cuts the whole tree at the sorted pivots into pivots.size() + 1 pieces.
+* The tree is left empty until mergePieces() puts it back together.
+*/
+template<class Key, class Value>
+void Treap<Key, Value>::splitPieces(const std::vector<Key>& pivots, std::vector<TNode*>& pieces)
+{
+    pieces.clear();
+    TNode* rest = root();
+    for (size_t i = 0; i < pivots.size(); ++i) {
+        TNode* l;
+        split(rest, pivots[i], l, rest);
+        if (l != nullptr) {
+            l->setParent(nullptr);
+        }
+        pieces.push_back(l);
+    }
+    if (rest != nullptr) {
+        rest->setParent(nullptr);
+    }
+    pieces.push_back(rest);
+    this->root_ = nullptr;
+}
+
+/**
+* Merges pieces, which must be in ascending key order, into root_.
+*/
+template<class Key, class Value>
+void Treap<Key, Value>::mergePieces(std::vector<TNode*>& pieces)
+{
+    TNode* joined = nullptr;
+    for (size_t i = 0; i < pieces.size(); ++i) {
+        joined = merge(joined, pieces[i]);
+    }
+    if (joined != nullptr) {
+        joined->setParent(nullptr);
+    }
+    this->root_ = joined;
+}
+
+/**
+* Deletes every node of t. The top of the tree is peeled off until there is
+* roughly one subtree per thread, then each thread frees its subtrees.
+*/
+template<class Key, class Value>
+void Treap<Key, Value>::destroyParallel(TNode* t, unsigned threads)
+{
+    if (t == nullptr) {
+        return;
+    }
+    unsigned count = workerCount(threads, static_cast<size_t>(-1));
+    std::vector<TNode*> frontier(1, t);
+    while (frontier.size() < count) {
+        std::vector<TNode*> next;
+        for (size_t i = 0; i < frontier.size(); ++i) {
+            if (frontier[i]->getLeft() != nullptr) {
+                next.push_back(frontier[i]->getLeft());
+            }
+            if (frontier[i]->getRight() != nullptr) {
+                next.push_back(frontier[i]->getRight());
+            }
+            delete frontier[i];
+        }
+        frontier.swap(next);
+        if (frontier.empty()) {
+            return;
+        }
+    }
+    std::vector<std::thread> workers;
+    for (unsigned i = 0; i < count; ++i) {
+        workers.push_back(std::thread([&, i]() {
+            for (size_t j = i; j < frontier.size(); j += count) {
+                this->clearHelper(frontier[j]);
+            }
+        }));
+    }
+    for (size_t i = 0; i < workers.size(); ++i) {
+        workers[i].join();
+    }
+}
+
+template<class Key, class Value>
+typename Treap<Key, Value>::TNode* Treap<Key, Value>::root() const
+{
+    return static_cast<TNode*>(this->root_);
+}
+
+/*
+------------------------------------------
+End implementations for the Treap class.
+------------------------------------------
+*/
+
+#endif
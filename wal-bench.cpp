@@ -0,0 +1,91 @@
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <cstdio>
+#include <string>
+#include "durableavlbst.h"
+#include "bench-util.h"
+
+using namespace std;
+
+// Usage: wal-bench [num_updates] [path]
+// Inserts num_updates shuffled keys, every fourth update being a remove,
+// with the write-ahead log off and on at several group sizes, then times a
+// checkpoint and the recovery from it plus a log tail. The log files are
+// written next to path and removed at the end.
+
+static void removeFiles(const string& path)
+{
+    std::remove((path + ".log").c_str());
+    std::remove((path + ".ckpt").c_str());
+}
+
+static double runUpdates(DurableAVLTree<int, int>& tree, const vector<int>& keys)
+{
+    BenchTimer timer;
+    for (size_t i = 0; i < keys.size(); ++i) {
+        if (i % 4 == 3) {
+            tree.remove(keys[i - 1]);
+        }
+        else {
+            tree.insert(std::make_pair(keys[i], (int) i));
+        }
+    }
+    tree.commit();
+    return timer.elapsedMs();
+}
+
+int main(int argc, char *argv[])
+{
+    int n = (int) benchArg(argc, argv, 1, 200000);
+    string path = argc > 2 ? argv[2] : "wal-bench-data";
+    vector<int> keys = makeShuffledKeys(n, 1);
+
+    cout << n << " updates (3 inserts : 1 remove)" << endl;
+    cout << fixed << setprecision(1);
+    cout << "mode                    time(ms)   Kops/s" << endl;
+    {
+        DurableAVLTree<int, int> tree;
+        double ms = runUpdates(tree, keys);
+        cout << "log off                 " << setw(8) << ms << " " << setw(8) << n / ms << endl;
+    }
+    const size_t groups[] = { 1, 16, 256, 4096 };
+    for (size_t g = 0; g < sizeof(groups) / sizeof(groups[0]); ++g) {
+        if (groups[g] == 1 && n > 20000) {
+            continue; // One fdatasync per update takes minutes on a real disk
+        }
+        removeFiles(path);
+        DurableAVLTree<int, int> tree;
+        tree.open(path, groups[g], true);
+        double ms = runUpdates(tree, keys);
+        cout << "fsync, group " << setw(5) << groups[g] << "      " << setw(8) << ms << " " << setw(8) << n / ms << endl;
+    }
+    removeFiles(path);
+    {
+        DurableAVLTree<int, int> tree;
+        tree.open(path, 256, false);
+        double ms = runUpdates(tree, keys);
+        cout << "no fsync, group   256   " << setw(8) << ms << " " << setw(8) << n / ms << endl;
+
+        BenchTimer timer;
+        tree.checkpoint();
+        cout << "checkpoint              " << setw(8) << timer.elapsedMs() << endl;
+        for (int i = 0; i < n / 10; ++i) {
+            tree.insert(std::make_pair(keys[i], -i));
+        }
+        tree.close();
+    }
+    {
+        BenchTimer timer;
+        DurableAVLTree<int, int> tree;
+        tree.open(path);
+        cout << "recover (ckpt + 10% log)" << setw(8) << timer.elapsedMs() << endl;
+        long checksum = 0;
+        for (DurableAVLTree<int, int>::iterator it = tree.begin(); it != tree.end(); ++it) {
+            checksum += it->second;
+        }
+        cout << "(checksum " << checksum << ")" << endl;
+    }
+    removeFiles(path);
+    return 0;
+}
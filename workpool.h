@@ -0,0 +1,157 @@
+#ifndef WORKPOOL_H
+#define WORKPOOL_H
+
+#include <atomic>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/**
+* A small fork-join pool for the parallel traversals in bst.h. Each worker
+* owns a deque of tasks: it pushes and pops at the back, and idle workers
+* steal from the front of the others'. A thread waiting on a TaskGroup runs
+* queued tasks instead of blocking, so nested spawn/wait cannot deadlock.
+*
+* The pool only lives for the duration of run(): the calling thread acts as
+* worker 0 and the helper threads exit once the root task returns.
+*/
+class WorkStealingPool
+{
+public:
+    // Counts the tasks spawned into it that have not finished yet
+    class TaskGroup
+    {
+    public:
+        TaskGroup() : pending_(0) {}
+    private:
+        friend class WorkStealingPool;
+        std::atomic<size_t> pending_;
+    };
+
+    explicit WorkStealingPool(unsigned threads) :
+        queues_(threads == 0 ? 1 : threads),
+        done_(false)
+    {
+    }
+
+    /**
+    * Runs root on the calling thread with threads - 1 helpers stealing the
+    * work it spawns. Returns once root has returned.
+    */
+    void run(const std::function<void()>& root)
+    {
+        unsigned saved = workerIndex();
+        std::vector<std::thread> helpers;
+        for (unsigned i = 1; i < queues_.size(); ++i) {
+            helpers.push_back(std::thread([this, i]() { helperLoop(i); }));
+        }
+        workerIndex() = 0;
+        root();
+        done_.store(true);
+        for (size_t i = 0; i < helpers.size(); ++i) {
+            helpers[i].join();
+        }
+        workerIndex() = saved;
+    }
+
+    /**
+    * Queues task on the calling worker's deque as part of group. Must be
+    * called from inside run().
+    */
+    void spawn(TaskGroup& group, const std::function<void()>& task)
+    {
+        group.pending_.fetch_add(1);
+        Queue& q = queues_[workerIndex()];
+        std::lock_guard<std::mutex> lock(q.mutex);
+        q.tasks.push_back(Task(task, &group));
+    }
+
+    /**
+    * Returns once every task spawned into group has finished, running
+    * queued or stolen tasks in the meantime.
+    */
+    void wait(TaskGroup& group)
+    {
+        unsigned self = workerIndex();
+        while (group.pending_.load() != 0) {
+            if (!runOne(self)) {
+                std::this_thread::yield();
+            }
+        }
+    }
+
+private:
+    struct Task
+    {
+        Task() : group(nullptr) {}
+        Task(const std::function<void()>& f, TaskGroup* g) : fn(f), group(g) {}
+        std::function<void()> fn;
+        TaskGroup* group;
+    };
+
+    struct Queue
+    {
+        std::mutex mutex;
+        std::deque<Task> tasks;
+    };
+
+    static unsigned& workerIndex()
+    {
+        static thread_local unsigned index = 0;
+        return index;
+    }
+
+    void helperLoop(unsigned self)
+    {
+        workerIndex() = self;
+        while (!done_.load()) {
+            if (!runOne(self)) {
+                std::this_thread::yield();
+            }
+        }
+    }
+
+    /**
+    * Runs the newest task of our own deque, or else the oldest task of
+    * the first other deque that has one. Returns false if all were empty.
+    */
+    bool runOne(unsigned self)
+    {
+        Task task;
+        bool found = false;
+        {
+            Queue& own = queues_[self];
+            std::lock_guard<std::mutex> lock(own.mutex);
+            if (!own.tasks.empty()) {
+                task = own.tasks.back();
+                own.tasks.pop_back();
+                found = true;
+            }
+        }
+        for (size_t i = 1; !found && i < queues_.size(); ++i) {
+            Queue& victim = queues_[(self + i) % queues_.size()];
+            std::lock_guard<std::mutex> lock(victim.mutex);
+            if (!victim.tasks.empty()) {
+                task = victim.tasks.front();
+                victim.tasks.pop_front();
+                found = true;
+            }
+        }
+        if (!found) {
+            return false;
+        }
+        task.fn();
+        task.group->pending_.fetch_sub(1);
+        return true;
+    }
+
+    WorkStealingPool(const WorkStealingPool&);            // not copyable
+    WorkStealingPool& operator=(const WorkStealingPool&);
+
+    std::vector<Queue> queues_;
+    std::atomic<bool> done_;
+};
+
+#endif